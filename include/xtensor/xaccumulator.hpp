@@ -10,36 +10,957 @@
 #define XTENSOR_ACCUMULATOR_HPP
 
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
 #include <numeric>
+#include <stdexcept>
 #include <type_traits>
-#include <cstddef>
+#include <utility>
+#include <vector>
+
+#ifdef XTENSOR_USE_THREADS
+#include <atomic>
+#include <mutex>
+#endif
+
+#include "xtl/xsequence.hpp"
 
 #include "xtensor_forward.hpp"
-#include "xstrides.hpp"
+#include "xassign.hpp"
 #include "xexpression.hpp"
-#include <iostream>
+#include "xiterable.hpp"
+#include "xoperation.hpp"
+#include "xparallel.hpp"
+#include "xreducer.hpp"
+#include "xstrides.hpp"
+#include "xtensor_simd.hpp"
+#include "xutils.hpp"
 
 namespace xt
 {
 
 #define DEFAULT_STRATEGY_ACCUMULATORS evaluation_strategy::immediate
 
+    /****************
+     * xaccumulator *
+     ****************/
+
+    template <class F, class CT, class S>
+    class xaccumulator;
+
+    template <class F, class CT, class S>
+    struct xiterable_inner_types<xaccumulator<F, CT, S>>
+    {
+        using inner_shape_type = S;
+        using const_stepper = xindexed_stepper<xaccumulator<F, CT, S>>;
+        using stepper = const_stepper;
+    };
+
+    namespace detail
+    {
+        template <class T>
+        class xaccumulator_cache;
+    }
+
+    /**
+     * @class xaccumulator
+     * @brief Lazy accumulating expression.
+     *
+     * The xaccumulator class implements the cumulative application of a
+     * binary function along an axis of an expression, or along its flattened
+     * elements. The elements are computed on demand: the prefix of each line
+     * along the accumulated axis is computed up to the accessed element and
+     * cached, so that accessing the elements of a line in any order costs
+     * the length of the line, and that accessing the beginning of the lines
+     * does not read their end. The whole expression assigned to a container
+     * is computed into the container, without the cache.
+     *
+     * Since the computed values are cached, changes made to the accumulated
+     * expression after its first access are not reflected by the xaccumulator.
+     *
+     * @tparam F the function type
+     * @tparam CT the closure type of the \ref xexpression to accumulate
+     * @tparam S the shape type of the xaccumulator
+     */
+    template <class F, class CT, class S>
+    class xaccumulator : public xexpression<xaccumulator<F, CT, S>>,
+                         public xconst_iterable<xaccumulator<F, CT, S>>
+    {
+    public:
+
+        using self_type = xaccumulator<F, CT, S>;
+        using functor_type = std::decay_t<F>;
+        using xexpression_type = std::decay_t<CT>;
+
+        using value_type = typename functor_type::result_type;
+        using reference = value_type;
+        using const_reference = value_type;
+        using pointer = value_type*;
+        using const_pointer = const value_type*;
+        using size_type = typename xexpression_type::size_type;
+        using difference_type = typename xexpression_type::difference_type;
+
+        using iterable_base = xconst_iterable<self_type>;
+        using inner_shape_type = typename iterable_base::inner_shape_type;
+        using shape_type = inner_shape_type;
+
+        using stepper = typename iterable_base::stepper;
+        using const_stepper = typename iterable_base::const_stepper;
+
+        static constexpr layout_type static_layout = layout_type::any;
+        static constexpr bool contiguous_layout = false;
+
+        template <class Func, class CTA>
+        xaccumulator(Func&& f, CTA&& e, size_type axis);
+
+        template <class Func, class CTA>
+        xaccumulator(Func&& f, CTA&& e);
+
+        size_type size() const noexcept;
+        size_type dimension() const noexcept;
+        const inner_shape_type& shape() const noexcept;
+        layout_type layout() const noexcept;
+
+        template <class... Args>
+        const_reference operator()(Args... args) const;
+        template <class... Args>
+        const_reference at(Args... args) const;
+        template <class OS>
+        disable_integral_t<OS, const_reference> operator[](const OS& index) const;
+        template <class I>
+        const_reference operator[](std::initializer_list<I> index) const;
+        const_reference operator[](size_type i) const;
+
+        template <class It>
+        const_reference element(It first, It last) const;
+
+        template <class O>
+        bool broadcast_shape(O& shape) const;
+
+        template <class O>
+        bool is_trivial_broadcast(const O& /*strides*/) const noexcept;
+
+        template <class O>
+        const_stepper stepper_begin(const O& shape) const noexcept;
+        template <class O>
+        const_stepper stepper_end(const O& shape, layout_type) const noexcept;
+
+        template <class E>
+        bool assign_to(E& e) const;
+
+    private:
+
+        using input_stepper = typename xexpression_type::const_stepper;
+        using input_index = xindex_type_t<typename xexpression_type::shape_type>;
+
+        template <class E>
+        bool assign_inplace(E& e, std::false_type) const;
+        template <class E>
+        bool assign_inplace(E& e, std::true_type) const;
+
+        template <class It>
+        input_stepper line_stepper(It index) const;
+        input_index unravel(size_type i) const;
+        void compute_line(value_type* values, size_type first, size_type last, input_stepper& in, input_index& index) const;
+
+        CT m_e;
+        functor_type m_f;
+        size_type m_axis;
+        bool m_flat;
+        inner_shape_type m_shape;
+        size_type m_extent;
+        mutable detail::xaccumulator_cache<value_type> m_cache;
+    };
+
+    /**********************************
+     * xaccumulator_cache declaration *
+     **********************************/
+
+    namespace detail
+    {
+        // Values of the lines of an xaccumulator computed so far. The buffer
+        // is allocated on first use, copies start with an empty cache.
+        template <class T>
+        class xaccumulator_cache
+        {
+        public:
+
+            using size_type = std::size_t;
+
+            xaccumulator_cache(size_type nb_lines, size_type extent) noexcept;
+            ~xaccumulator_cache() = default;
+
+            xaccumulator_cache(const xaccumulator_cache& rhs) noexcept;
+            xaccumulator_cache& operator=(const xaccumulator_cache& rhs) noexcept;
+
+            xaccumulator_cache(xaccumulator_cache&& rhs) noexcept;
+            xaccumulator_cache& operator=(xaccumulator_cache&& rhs) noexcept;
+
+            template <class G>
+            T value(size_type line, size_type pos, G&& compute);
+
+        private:
+
+            void allocate();
+
+            size_type m_nb_lines;
+            size_type m_extent;
+            std::unique_ptr<T[]> m_values;
+            // number of values computed in each line
+            std::unique_ptr<size_type[]> m_computed;
+#ifdef XTENSOR_USE_THREADS
+            std::atomic<bool> m_allocated;
+            std::mutex m_allocation_mutex;
+            // lines are locked by stripes
+            std::array<std::mutex, 16> m_line_mutexes;
+#endif
+        };
+    }
+
+    /*************************************
+     * xaccumulator_cache implementation *
+     *************************************/
+
+    namespace detail
+    {
+        template <class T>
+        inline xaccumulator_cache<T>::xaccumulator_cache(size_type nb_lines, size_type extent) noexcept
+            : m_nb_lines(nb_lines), m_extent(extent)
+#ifdef XTENSOR_USE_THREADS
+              , m_allocated(false)
+#endif
+        {
+        }
+
+        template <class T>
+        inline xaccumulator_cache<T>::xaccumulator_cache(const xaccumulator_cache& rhs) noexcept
+            : xaccumulator_cache(rhs.m_nb_lines, rhs.m_extent)
+        {
+        }
+
+        template <class T>
+        inline auto xaccumulator_cache<T>::operator=(const xaccumulator_cache& rhs) noexcept -> xaccumulator_cache&
+        {
+            m_nb_lines = rhs.m_nb_lines;
+            m_extent = rhs.m_extent;
+            m_values.reset();
+            m_computed.reset();
+#ifdef XTENSOR_USE_THREADS
+            m_allocated = false;
+#endif
+            return *this;
+        }
+
+        template <class T>
+        inline xaccumulator_cache<T>::xaccumulator_cache(xaccumulator_cache&& rhs) noexcept
+            : m_nb_lines(rhs.m_nb_lines), m_extent(rhs.m_extent),
+              m_values(std::move(rhs.m_values)), m_computed(std::move(rhs.m_computed))
+#ifdef XTENSOR_USE_THREADS
+              , m_allocated(m_values != nullptr)
+#endif
+        {
+        }
+
+        template <class T>
+        inline auto xaccumulator_cache<T>::operator=(xaccumulator_cache&& rhs) noexcept -> xaccumulator_cache&
+        {
+            m_nb_lines = rhs.m_nb_lines;
+            m_extent = rhs.m_extent;
+            m_values = std::move(rhs.m_values);
+            m_computed = std::move(rhs.m_computed);
+#ifdef XTENSOR_USE_THREADS
+            m_allocated = m_values != nullptr;
+#endif
+            return *this;
+        }
+
+        // Returns the value at position pos of the line, after calling
+        // compute(values, first, last) to compute the values [first, last)
+        // of the line if they are not computed yet.
+        template <class T>
+        template <class G>
+        inline T xaccumulator_cache<T>::value(size_type line, size_type pos, G&& compute)
+        {
+#ifdef XTENSOR_USE_THREADS
+            if (!m_allocated.load(std::memory_order_acquire))
+            {
+                std::lock_guard<std::mutex> lock(m_allocation_mutex);
+                if (!m_allocated.load(std::memory_order_relaxed))
+                {
+                    allocate();
+                    m_allocated.store(true, std::memory_order_release);
+                }
+            }
+            std::lock_guard<std::mutex> lock(m_line_mutexes[line % m_line_mutexes.size()]);
+#else
+            if (m_values == nullptr)
+            {
+                allocate();
+            }
+#endif
+            T* values = m_values.get() + line * m_extent;
+            size_type& computed = m_computed[line];
+            if (pos >= computed)
+            {
+                compute(values, computed, pos + 1);
+                computed = pos + 1;
+            }
+            return values[pos];
+        }
+
+        template <class T>
+        inline void xaccumulator_cache<T>::allocate()
+        {
+            // values are not initialized, so that pages which are never
+            // accessed are not touched
+            m_values = std::unique_ptr<T[]>(new T[m_nb_lines * m_extent]);
+            m_computed = std::unique_ptr<size_type[]>(new size_type[m_nb_lines]());
+        }
+    }
+
+    /****************
+     * scan kernels *
+     ****************/
+
+    namespace detail
+    {
+        // Tells whether values of type T can be combined with the
+        // simd_apply method of F.
+        template <class F, class T>
+        struct simd_scan
+        {
+            static constexpr bool value = xsimd::simd_traits<T>::size > 1 &&
+                has_simd_apply<F>::value && std::is_same<typename F::result_type, T>::value;
+        };
+
+        template <class F, class T, class S>
+        inline std::size_t scan_combine_simd(F&, T*, const S&, std::size_t, std::false_type)
+        {
+            return 0;
+        }
+
+        template <class F, class T, class S>
+        inline std::size_t scan_combine_simd(F& f, T* dst, const S& src, std::size_t size, std::true_type)
+        {
+            using simd_type = xsimd::simd_type<T>;
+            constexpr std::size_t simd_size = xsimd::simd_traits<T>::size;
+            std::size_t simd_last = size & ~(simd_size - 1);
+            for (std::size_t i = 0; i != simd_last; i += simd_size)
+            {
+                simd_type res = f.simd_apply(src.load(i), xsimd::load_simd<T>(dst + i, unaligned_mode()));
+                xsimd::store_simd<T>(dst + i, res, unaligned_mode());
+            }
+            return simd_last;
+        }
+
+        template <class T>
+        struct scan_row
+        {
+            const T* m_data;
+
+            xsimd::simd_type<T> load(std::size_t i) const
+            {
+                return xsimd::load_simd<T>(m_data + i, unaligned_mode());
+            }
+
+            const T& operator[](std::size_t i) const
+            {
+                return m_data[i];
+            }
+        };
+
+        template <class T>
+        struct scan_carry
+        {
+            T m_value;
+
+            xsimd::simd_type<T> load(std::size_t) const
+            {
+                return xsimd::set_simd(m_value);
+            }
+
+            const T& operator[](std::size_t) const
+            {
+                return m_value;
+            }
+        };
+
+        // dst[i] = f(src[i], dst[i]) for i in [0, size), src being either
+        // a row or a carry broadcast to the whole row.
+        template <class F, class T, class S>
+        inline void scan_combine(F& f, T* dst, const S& src, std::size_t size)
+        {
+            using simd = std::integral_constant<bool, simd_scan<std::decay_t<F>, T>::value>;
+            std::size_t i = scan_combine_simd(f, dst, src, size, simd());
+            for (; i != size; ++i)
+            {
+                dst[i] = f(src[i], dst[i]);
+            }
+        }
+
+        template <class F, class T>
+        inline void scan_line(F& f, T* data, std::size_t size)
+        {
+            for (std::size_t i = 1; i < size; ++i)
+            {
+                data[i] = f(data[i - 1], data[i]);
+            }
+        }
+
+        // Scans a line by blocks of XTENSOR_REDUCE_BLOCK_SIZE elements:
+        // the blocks are scanned independently, then the last value of the
+        // previous blocks is combined with their elements. The blocks are
+        // split across threads when possible; the result only depends on
+        // the size of the line.
+        template <class F, class T>
+        inline void scan_blocks(F& f, T* data, std::size_t size)
+        {
+            const std::size_t block_size = XTENSOR_REDUCE_BLOCK_SIZE;
+            std::size_t nb_blocks = (size + block_size - 1) / block_size;
+            auto block_length = [size, block_size](std::size_t b) {
+                return std::min(block_size, size - b * block_size);
+            };
+
+            if (parallel_concurrency() < 2)
+            {
+                // same operations, while each block is in cache
+                for (std::size_t b = 0; b != nb_blocks; ++b)
+                {
+                    T* block = data + b * block_size;
+                    scan_line(f, block, block_length(b));
+                    if (b != 0)
+                    {
+                        scan_combine(f, block, scan_carry<T>{block[-1]}, block_length(b));
+                    }
+                }
+                return;
+            }
+
+            parallel_for(nb_blocks, 1, [&f, data, block_size, &block_length](std::size_t first, std::size_t last) {
+                for (std::size_t b = first; b != last; ++b)
+                {
+                    scan_line(f, data + b * block_size, block_length(b));
+                }
+            });
+            std::vector<T> carries(nb_blocks);
+            for (std::size_t b = 1; b != nb_blocks; ++b)
+            {
+                const T& last = data[b * block_size - 1];
+                carries[b] = b == 1 ? last : f(carries[b - 1], last);
+            }
+            parallel_for(nb_blocks - 1, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t b = first + 1; b != last + 1; ++b)
+                {
+                    scan_combine(f, data + b * block_size, scan_carry<T>{carries[b]}, block_length(b));
+                }
+            });
+        }
+
+        // Scans in place the lines of a contiguous buffer made of outer_size
+        // blocks of extent rows of inner_size elements, the lines running
+        // across the rows of each block. When the lines are not contiguous,
+        // whole rows are combined with SIMD instructions; long contiguous
+        // lines of associative functions are scanned by blocks.
+        template <class F, class T>
+        inline void scan_inplace(F& f, T* data, std::size_t outer_size, std::size_t extent, std::size_t inner_size)
+        {
+            if (extent < 2 || outer_size == 0 || inner_size == 0)
+            {
+                return;
+            }
+
+            if (inner_size == 1)
+            {
+                if (is_associative<std::decay_t<F>>::value && extent >= 2 * std::size_t(XTENSOR_REDUCE_BLOCK_SIZE))
+                {
+                    for (std::size_t i = 0; i != outer_size; ++i)
+                    {
+                        scan_blocks(f, data + i * extent, extent);
+                    }
+                }
+                else
+                {
+                    parallel_for(outer_size, assign_grain(outer_size, extent), [&f, data, extent](std::size_t first, std::size_t last) {
+                        for (std::size_t i = first; i != last; ++i)
+                        {
+                            scan_line(f, data + i * extent, extent);
+                        }
+                    });
+                }
+                return;
+            }
+
+            // the columns are the lines, split across threads
+            std::size_t nb_columns = outer_size * inner_size;
+            parallel_for(nb_columns, assign_grain(nb_columns, extent), [&f, data, extent, inner_size](std::size_t first, std::size_t last) {
+                while (first != last)
+                {
+                    std::size_t column = first % inner_size;
+                    std::size_t size = std::min(inner_size - column, last - first);
+                    T* row = data + (first / inner_size) * extent * inner_size + column;
+                    for (std::size_t k = 1; k != extent; ++k, row += inner_size)
+                    {
+                        scan_combine(f, row + inner_size, scan_row<T>{row}, size);
+                    }
+                    first += size;
+                }
+            });
+        }
+
+        // Scans in place the lines along an axis of a row-major or
+        // column-major container.
+        template <class F, class E>
+        inline void scan_container(F& f, E& e, std::size_t axis)
+        {
+            const auto& shape = e.shape();
+            std::size_t before = std::accumulate(shape.cbegin(), shape.cbegin() + static_cast<std::ptrdiff_t>(axis),
+                                                 std::size_t(1), std::multiplies<std::size_t>());
+            std::size_t after = std::accumulate(shape.cbegin() + static_cast<std::ptrdiff_t>(axis + 1), shape.cend(),
+                                                std::size_t(1), std::multiplies<std::size_t>());
+            std::size_t extent = shape[axis];
+            if (e.layout() == layout_type::column_major)
+            {
+                std::swap(before, after);
+            }
+            scan_inplace(f, e.raw_data(), before, extent, after);
+        }
+    }
+
+    /*******************************
+     * xaccumulator implementation *
+     *******************************/
+
+    /**
+     * @name Constructors
+     */
+    //@{
+    /**
+     * Constructs an xaccumulator applying the specified function along the
+     * given axis of the given expression.
+     * @param f the function to apply
+     * @param e the expression to accumulate
+     * @param axis the axis along which the function is applied
+     */
+    template <class F, class CT, class S>
+    template <class Func, class CTA>
+    inline xaccumulator<F, CT, S>::xaccumulator(Func&& f, CTA&& e, size_type axis)
+        : m_e(std::forward<CTA>(e)), m_f(std::forward<Func>(f)), m_axis(axis), m_flat(false),
+          m_shape(xtl::forward_sequence<inner_shape_type>(m_e.shape())),
+          m_extent(axis < m_e.dimension() ? m_e.shape()[axis] : 0),
+          m_cache(m_extent == 0 ? 0 : compute_size(m_e.shape()) / m_extent, m_extent)
+    {
+        if (axis >= m_e.dimension())
+        {
+            throw std::runtime_error("Axis larger than expression dimension in accumulator.");
+        }
+    }
+
+    /**
+     * Constructs an xaccumulator applying the specified function along the
+     * flattened elements of the given expression, in the default layout.
+     * @param f the function to apply
+     * @param e the expression to accumulate
+     */
+    template <class F, class CT, class S>
+    template <class Func, class CTA>
+    inline xaccumulator<F, CT, S>::xaccumulator(Func&& f, CTA&& e)
+        : m_e(std::forward<CTA>(e)), m_f(std::forward<Func>(f)), m_axis(0), m_flat(true),
+          m_shape(xtl::make_sequence<inner_shape_type>(1, compute_size(m_e.shape()))),
+          m_extent(m_shape[0]), m_cache(1, m_extent)
+    {
+    }
+    //@}
+
+    /**
+     * @name Size and shape
+     */
+    //@{
+    /**
+     * Returns the size of the expression.
+     */
+    template <class F, class CT, class S>
+    inline auto xaccumulator<F, CT, S>::size() const noexcept -> size_type
+    {
+        return compute_size(shape());
+    }
+
+    /**
+     * Returns the number of dimensions of the expression.
+     */
+    template <class F, class CT, class S>
+    inline auto xaccumulator<F, CT, S>::dimension() const noexcept -> size_type
+    {
+        return m_shape.size();
+    }
+
+    /**
+     * Returns the shape of the expression.
+     */
+    template <class F, class CT, class S>
+    inline auto xaccumulator<F, CT, S>::shape() const noexcept -> const inner_shape_type&
+    {
+        return m_shape;
+    }
+
+    template <class F, class CT, class S>
+    inline layout_type xaccumulator<F, CT, S>::layout() const noexcept
+    {
+        return static_layout;
+    }
+    //@}
+
+    /**
+     * @name Data
+     */
+    //@{
+    /**
+     * Returns the element at the specified position in the expression.
+     * @param args a list of indices specifying the position in the expression. Indices
+     * must be unsigned integers, the number of indices should be equal to the number of
+     * dimensions of the expression.
+     */
+    template <class F, class CT, class S>
+    template <class... Args>
+    inline auto xaccumulator<F, CT, S>::operator()(Args... args) const -> const_reference
+    {
+        std::array<size_type, sizeof...(Args)> arg_array = {{static_cast<size_type>(args)...}};
+        return element(arg_array.cbegin(), arg_array.cend());
+    }
+
+    /**
+     * Returns the element at the specified position in the expression,
+     * after dimension and bounds checking.
+     * @param args a list of indices specifying the position in the expression. Indices
+     * must be unsigned integers, the number of indices should be equal to the number of
+     * dimensions of the expression.
+     * @exception std::out_of_range if the number of argument is greater than the number of dimensions
+     * or if indices are out of bounds.
+     */
+    template <class F, class CT, class S>
+    template <class... Args>
+    inline auto xaccumulator<F, CT, S>::at(Args... args) const -> const_reference
+    {
+        check_access(shape(), args...);
+        return this->operator()(args...);
+    }
+
+    template <class F, class CT, class S>
+    template <class OS>
+    inline auto xaccumulator<F, CT, S>::operator[](const OS& index) const
+        -> disable_integral_t<OS, const_reference>
+    {
+        return element(index.cbegin(), index.cend());
+    }
+
+    template <class F, class CT, class S>
+    template <class I>
+    inline auto xaccumulator<F, CT, S>::operator[](std::initializer_list<I> index) const
+        -> const_reference
+    {
+        return element(index.begin(), index.end());
+    }
+
+    template <class F, class CT, class S>
+    inline auto xaccumulator<F, CT, S>::operator[](size_type i) const -> const_reference
+    {
+        return operator()(i);
+    }
+
+    /**
+     * Returns the element at the specified position in the expression.
+     * @param first iterator starting the sequence of indices
+     * @param last iterator ending the sequence of indices
+     * The number of indices in the sequence should be equal to the number of
+     * dimensions of the expression.
+     */
+    template <class F, class CT, class S>
+    template <class It>
+    inline auto xaccumulator<F, CT, S>::element(It first, It last) const -> const_reference
+    {
+        XTENSOR_ASSERT(check_element_index(shape(), first, last));
+        auto nb_indices = static_cast<size_type>(std::distance(first, last));
+        if (nb_indices > dimension())
+        {
+            std::advance(first, static_cast<difference_type>(nb_indices - dimension()));
+        }
+
+        if (m_flat)
+        {
+            return m_cache.value(0, static_cast<size_type>(*first), [this](value_type* values, size_type f, size_type l) {
+                size_type start = f == 0 ? 0 : f - 1;
+                input_index index = unravel(start);
+                input_stepper in = line_stepper(index.cbegin());
+                compute_line(values, f, l, in, index);
+            });
+        }
+
+        size_type line = 0;
+        size_type pos = 0;
+        It it = first;
+        for (size_type d = 0; d < dimension(); ++d, ++it)
+        {
+            if (d == m_axis)
+            {
+                pos = static_cast<size_type>(*it);
+            }
+            else
+            {
+                line = line * m_shape[d] + static_cast<size_type>(*it);
+            }
+        }
+        return m_cache.value(line, pos, [this, first](value_type* values, size_type f, size_type l) {
+            input_index index = xtl::make_sequence<input_index>(dimension(), size_type(0));
+            std::copy(first, std::next(first, static_cast<difference_type>(dimension())), index.begin());
+            index[m_axis] = f == 0 ? 0 : f - 1;
+            input_stepper in = line_stepper(index.cbegin());
+            compute_line(values, f, l, in, index);
+        });
+    }
+    //@}
+
+    /**
+     * @name Broadcasting
+     */
+    //@{
+    /**
+     * Broadcast the shape of the expression to the specified parameter.
+     * @param shape the result shape
+     * @return a boolean indicating whether the broadcasting is trivial
+     */
+    template <class F, class CT, class S>
+    template <class O>
+    inline bool xaccumulator<F, CT, S>::broadcast_shape(O& shape) const
+    {
+        return xt::broadcast_shape(m_shape, shape);
+    }
+
+    /**
+     * Compares the specified strides with those of the container to see whether
+     * the broadcasting is trivial.
+     * @return a boolean indicating whether the broadcasting is trivial
+     */
+    template <class F, class CT, class S>
+    template <class O>
+    inline bool xaccumulator<F, CT, S>::is_trivial_broadcast(const O& /*strides*/) const noexcept
+    {
+        return false;
+    }
+    //@}
+
+    template <class F, class CT, class S>
+    template <class O>
+    inline auto xaccumulator<F, CT, S>::stepper_begin(const O& shape) const noexcept -> const_stepper
+    {
+        size_type offset = shape.size() - dimension();
+        return const_stepper(this, offset);
+    }
+
+    template <class F, class CT, class S>
+    template <class O>
+    inline auto xaccumulator<F, CT, S>::stepper_end(const O& shape, layout_type) const noexcept -> const_stepper
+    {
+        size_type offset = shape.size() - dimension();
+        return const_stepper(this, offset, true);
+    }
+
+    /**
+     * Computes the whole expression into \c e, which must have the same shape,
+     * without filling the cache. A row-major or column-major container of
+     * the value type of the expression receives a copy of the input, which
+     * is scanned in place; other expressions are computed line by line. The
+     * work is split across threads when \c XTENSOR_USE_THREADS is defined.
+     * @return false if the shapes differ and the expression has to be assigned
+     * element-wise
+     */
+    template <class F, class CT, class S>
+    template <class E>
+    inline bool xaccumulator<F, CT, S>::assign_to(E& e) const
+    {
+        if (e.dimension() != dimension() || !std::equal(m_shape.cbegin(), m_shape.cend(), e.shape().cbegin()))
+        {
+            return false;
+        }
+        if (size() == 0)
+        {
+            return true;
+        }
+        if (assign_inplace(e, std::integral_constant<bool, std::is_same<typename E::value_type, value_type>::value &&
+                                                              E::contiguous_layout && has_raw_data_interface<E>::value>()))
+        {
+            return true;
+        }
+
+        // The lines are computed into a buffer and copied, so that the
+        // values are read in the order of the input whatever the layout
+        // of e.
+        auto assign_lines = [this, &e](size_type first, size_type last) {
+            std::unique_ptr<value_type[]> values(new value_type[m_extent]);
+            input_index index = xtl::make_sequence<input_index>(m_e.dimension(), size_type(0));
+            for (size_type line = first; line != last; ++line)
+            {
+                input_stepper in = m_e.stepper_begin(m_e.shape());
+                if (!m_flat)
+                {
+                    size_type l = line;
+                    for (size_type d = dimension(); d != 0; --d)
+                    {
+                        if (d - 1 != m_axis)
+                        {
+                            index[d - 1] = l % m_shape[d - 1];
+                            l /= m_shape[d - 1];
+                            in.step(d - 1, index[d - 1]);
+                        }
+                    }
+                }
+                compute_line(values.get(), 0, m_extent, in, index);
+
+                auto out = e.stepper_begin(e.shape());
+                for (size_type d = 0; d < dimension(); ++d)
+                {
+                    out.step(d, d == m_axis ? size_type(0) : index[d]);
+                }
+                for (size_type k = 0; k != m_extent; ++k)
+                {
+                    *out = values[k];
+                    if (k + 1 != m_extent)
+                    {
+                        out.step(m_axis);
+                    }
+                }
+            }
+        };
+        size_type nb_lines = size() / m_extent;
+        if (m_flat)
+        {
+            assign_lines(0, 1);
+        }
+        else if (!detail::is_splittable<xexpression_type>::value)
+        {
+            assign_lines(0, nb_lines);
+        }
+        else
+        {
+            parallel_for(nb_lines, detail::assign_grain(nb_lines, m_extent), assign_lines);
+        }
+        return true;
+    }
+
+    template <class F, class CT, class S>
+    template <class E>
+    inline bool xaccumulator<F, CT, S>::assign_inplace(E&, std::false_type) const
+    {
+        return false;
+    }
+
+    // Copies the input into a row-major or column-major container and
+    // scans it in place.
+    template <class F, class CT, class S>
+    template <class E>
+    inline bool xaccumulator<F, CT, S>::assign_inplace(E& e, std::true_type) const
+    {
+        if (e.layout() != layout_type::row_major && e.layout() != layout_type::column_major)
+        {
+            return false;
+        }
+        if (m_flat)
+        {
+            std::copy(m_e.template cbegin<DEFAULT_LAYOUT>(), m_e.template cend<DEFAULT_LAYOUT>(), e.raw_data());
+            detail::scan_inplace(m_f, e.raw_data(), 1, m_extent, 1);
+        }
+        else
+        {
+            xt::assign_data(e, m_e, true);
+            detail::scan_container(m_f, e, m_axis);
+        }
+        return true;
+    }
+
+    // Returns a stepper on the input positioned at the given index.
+    template <class F, class CT, class S>
+    template <class It>
+    inline auto xaccumulator<F, CT, S>::line_stepper(It index) const -> input_stepper
+    {
+        input_stepper in = m_e.stepper_begin(m_e.shape());
+        for (size_type d = 0; d < m_e.dimension(); ++d, ++index)
+        {
+            in.step(d, static_cast<size_type>(*index));
+        }
+        return in;
+    }
+
+    // Index in the input of the i-th element in the default layout.
+    template <class F, class CT, class S>
+    inline auto xaccumulator<F, CT, S>::unravel(size_type i) const -> input_index
+    {
+        const auto& shape = m_e.shape();
+        input_index index = xtl::make_sequence<input_index>(shape.size(), size_type(0));
+        for (size_type k = 0; k < shape.size(); ++k)
+        {
+            size_type d = DEFAULT_LAYOUT == layout_type::row_major ? shape.size() - 1 - k : k;
+            index[d] = i % shape[d];
+            i /= shape[d];
+        }
+        return index;
+    }
+
+    // Computes the values [first, last) of a line, the stepper being
+    // positioned on the input element first - 1 (or 0 if first is 0). In
+    // flat mode, index is the index of the stepper in the input.
+    template <class F, class CT, class S>
+    inline void xaccumulator<F, CT, S>::compute_line(value_type* values, size_type first, size_type last,
+                                                     input_stepper& in, input_index& index) const
+    {
+        if (first == 0)
+        {
+            values[0] = static_cast<value_type>(*in);
+            ++first;
+        }
+        for (size_type k = first; k != last; ++k)
+        {
+            if (m_flat)
+            {
+                stepper_tools<DEFAULT_LAYOUT>::increment_stepper(in, index, m_e.shape());
+            }
+            else
+            {
+                in.step(m_axis);
+            }
+            values[k] = m_f(values[k - 1], *in);
+        }
+    }
+
+    namespace detail
+    {
+        template <class E1, class F, class CT, class S>
+        inline bool assign_accumulator(E1& e1, const xaccumulator<F, CT, S>& e2)
+        {
+            return e2.assign_to(e1);
+        }
+    }
+
     /**************
      * accumulate *
      **************/
 
     namespace detail
     {
-        template <class F, class E, class ES>
-        xarray<typename std::decay_t<E>::value_type> accumulator_impl(F&&, E&&, std::size_t, ES)
+        template <class F, class E>
+        inline auto accumulator_impl(F&& f, E&& e, std::size_t axis, evaluation_strategy::lazy)
         {
-            static_assert(!std::is_same<evaluation_strategy::lazy, ES>::value, "Lazy accumulators not yet implemented.");
+            using shape_type = typename std::decay_t<E>::shape_type;
+            using type = xaccumulator<F, const_xclosure_t<E>, shape_type>;
+            return type(std::forward<F>(f), std::forward<E>(e), axis);
         }
 
-        template <class F, class E, class ES>
-        xarray<typename std::decay_t<E>::value_type> accumulator_impl(F&&, E&&, ES)
+        template <class F, class E>
+        inline auto accumulator_impl(F&& f, E&& e, evaluation_strategy::lazy)
         {
-            static_assert(!std::is_same<evaluation_strategy::lazy, ES>::value, "Lazy accumulators not yet implemented.");
+            using shape_type = std::array<std::size_t, 1>;
+            using type = xaccumulator<F, const_xclosure_t<E>, shape_type>;
+            return type(std::forward<F>(f), std::forward<E>(e));
         }
 
         template <class T, class R>
@@ -69,45 +990,7 @@ namespace xt
             }
 
             result_type result = e;  // assign + make a copy, we need it anyways
-
-            std::size_t inner_stride = result.strides()[axis];
-            std::size_t outer_stride = 1; // this is either going row- or column-wise (strides.back / strides.front)
-            std::size_t outer_loop_size = 0;
-            std::size_t inner_loop_size = 0;
-
-            auto set_loop_sizes = [&outer_loop_size, &inner_loop_size](auto first, auto last, ptrdiff_t ax)
-            {
-                outer_loop_size = std::accumulate(first,
-                                                  first + ax,
-                                                  std::size_t(1), std::multiplies<std::size_t>());
-
-                inner_loop_size = std::accumulate(first + ax,
-                                                  last,
-                                                  std::size_t(1), std::multiplies<std::size_t>());
-            };
-
-            if (result_type::static_layout == layout_type::row_major)
-            {
-                set_loop_sizes(result.shape().cbegin(), result.shape().cend(), static_cast<ptrdiff_t>(axis));
-            }
-            else
-            {
-                set_loop_sizes(result.shape().cbegin(), result.shape().cend(), static_cast<ptrdiff_t>(axis + 1));
-                std::swap(inner_loop_size, outer_loop_size);
-            }
-            inner_loop_size = inner_loop_size - inner_stride;
-
-            std::size_t pos = 0;
-            for (std::size_t i = 0; i < outer_loop_size; ++i)
-            {
-                for (std::size_t j = 0; j < inner_loop_size; ++j)
-                {
-                    result.data()[pos + inner_stride] = f(result.data()[pos],
-                                                          result.data()[pos + inner_stride]);
-                    pos += outer_stride;
-                }
-                pos += inner_stride;
-            }
+            scan_container(f, result, axis);
             return result;
         }
 
@@ -118,30 +1001,22 @@ namespace xt
             using result_type = xtensor<T, 1>;
             std::size_t sz = e.size();
             auto result = result_type::from_shape({sz});
-
-            auto it = e.template begin<DEFAULT_LAYOUT>();
-
-            result.data()[0] = *it;
-            ++it;
-
-            for (std::size_t idx = 0; it != e.template end<DEFAULT_LAYOUT>(); ++it)
-            {
-                result.data()[idx + 1] = f(result.data()[idx], *it);
-                ++idx;
-            }
+            std::copy(e.template begin<DEFAULT_LAYOUT>(), e.template end<DEFAULT_LAYOUT>(), result.raw_data());
+            scan_inplace(f, result.raw_data(), 1, sz, 1);
             return result;
         }
     }
 
     /**
-     * Accumulate and flatten array
-     * **NOTE** This function is not lazy!
+     * Accumulate and flatten array. The result is a 1-D container with the
+     * immediate evaluation strategy (the default), and an \ref xaccumulator
+     * with the lazy one.
      *
      * @param f functor to use for accumulation
      * @param e xexpression to be accumulated
      * @param evaluation_strategy evaluation strategy of the accumulation
      *
-     * @return returns xarray<T> filled with accumulated values
+     * @return a container filled with the accumulated values, or an \ref xaccumulator
      */
     template <class F, class E, class ES = DEFAULT_STRATEGY_ACCUMULATORS,
               typename std::enable_if_t<!std::is_integral<ES>::value, int> = 0>
@@ -153,15 +1028,16 @@ namespace xt
     }
 
     /**
-     * Accumulate over axis
-     * **NOTE** This function is not lazy!
+     * Accumulate over axis. The result is a container with the immediate
+     * evaluation strategy (the default), and an \ref xaccumulator with the
+     * lazy one.
      *
      * @param f Functor to use for accumulation
      * @param e xexpression to accumulate
      * @param axis Axis to perform accumulation over
      * @param evaluation_strategy evaluation strategy of the accumulation
      *
-     * @return returns xarray<T> filled with accumulated values
+     * @return a container filled with the accumulated values, or an \ref xaccumulator
      */
     template <class F, class E, class ES = DEFAULT_STRATEGY_ACCUMULATORS>
     inline auto accumulate(F&& f, E&& e, std::size_t axis, ES evaluation_strategy = ES())
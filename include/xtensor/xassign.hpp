@@ -16,6 +16,7 @@
 #include "xconcepts.hpp"
 #include "xexpression.hpp"
 #include "xiterator.hpp"
+#include "xparallel.hpp"
 #include "xtensor_forward.hpp"
 #include "xutils.hpp"
 
@@ -100,6 +101,7 @@ namespace xt
         data_assigner(E1& e1, const E2& e2);
 
         void run();
+        void run(size_type dim, size_type first, size_type last);
 
         void step(size_type i);
         void reset(size_type i);
@@ -108,7 +110,10 @@ namespace xt
 
     private:
 
+        void increment_inner(size_type dim);
+
         E1& m_e1;
+        const E2& m_e2;
 
         lhs_iterator m_lhs;
         rhs_iterator m_rhs;
@@ -185,6 +190,109 @@ namespace xt
             return false;
         }
 
+        // Output-major assignment of reducers, implemented in xreducer.hpp.
+        // Returns false when e2 has to be assigned element-wise.
+        template <class E1, class E2>
+        inline bool assign_reducer(E1&, const E2&)
+        {
+            return false;
+        }
+
+        template <class E1, class F, class CT, class X>
+        bool assign_reducer(E1& e1, const xreducer<F, CT, X>& e2);
+
+        // Line by line assignment of accumulators, implemented in
+        // xaccumulator.hpp. Returns false when e2 has to be assigned
+        // element-wise.
+        template <class E1, class E2>
+        inline bool assign_accumulator(E1&, const E2&)
+        {
+            return false;
+        }
+
+        template <class E1, class F, class CT, class S>
+        bool assign_accumulator(E1& e1, const xaccumulator<F, CT, S>& e2);
+
+        // Bulk assignment of generators whose functor fills ranges of
+        // elements, implemented in xgenerator.hpp. Returns false when e2
+        // has to be assigned element-wise.
+        template <class E1, class E2>
+        inline bool assign_generator(E1&, const E2&)
+        {
+            return false;
+        }
+
+        template <class E1, class F, class R, class S>
+        bool assign_generator(E1& e1, const xgenerator<F, R, S>& e2);
+
+        // Estimates the number of operations required to compute an element
+        // of an expression, relative to reading an element of a container.
+        template <class E>
+        inline std::size_t element_cost(const E&) noexcept
+        {
+            return 1;
+        }
+
+        template <class F, class R, class... CT>
+        std::size_t element_cost(const xfunction<F, R, CT...>& e) noexcept;
+
+        template <class F, class CT, class X>
+        std::size_t element_cost(const xreducer<F, CT, X>& e) noexcept;
+
+        template <class F, class R, class... CT>
+        inline std::size_t element_cost(const xfunction<F, R, CT...>& e) noexcept
+        {
+            auto func = [](std::size_t c, const auto& arg) { return c + element_cost(arg); };
+            return xt::accumulate(func, std::size_t(0), e.arguments());
+        }
+
+        template <class... CT>
+        class concatenate_impl;
+
+        template <class... CT>
+        class stack_impl;
+
+        // Tells whether the elements of an expression can be computed
+        // concurrently and in any order. Generators whose functor draws
+        // from a shared stateful engine are not splittable: they must be
+        // computed in order, on a single thread, to be reproducible.
+        // Expressions and functors wrapping another expression, which
+        // they expose as xexpression_type (views, broadcasts, reducers,
+        // functors of builders...), are splittable if it is.
+        template <class E, class = void_t<>>
+        struct is_splittable : std::true_type
+        {
+        };
+
+        template <class E>
+        struct is_splittable<E, void_t<typename E::xexpression_type>>
+            : is_splittable<std::decay_t<typename E::xexpression_type>>
+        {
+        };
+
+        template <class F, class R, class... CT>
+        struct is_splittable<xfunction<F, R, CT...>>
+            : xtl::conjunction<is_splittable<std::decay_t<CT>>...>
+        {
+        };
+
+        template <class F, class R, class S>
+        struct is_splittable<xgenerator<F, R, S>> : is_splittable<std::decay_t<F>>
+        {
+        };
+
+        template <class... CT>
+        struct is_splittable<concatenate_impl<CT...>>
+            : xtl::conjunction<is_splittable<std::decay_t<CT>>...>
+        {
+        };
+
+        template <class... CT>
+        struct is_splittable<stack_impl<CT...>>
+            : xtl::conjunction<is_splittable<std::decay_t<CT>>...>
+        {
+        };
+
         template <class E, class = void_t<>>
         struct forbid_simd_assign
         {
@@ -197,6 +305,31 @@ namespace xt
         {
             static constexpr bool value = false;
         };
+
+        template <class E, class = void_t<>>
+        struct has_data_element : std::false_type
+        {
+        };
+
+        template <class E>
+        struct has_data_element<E, void_t<decltype(std::declval<E>().data_element(typename E::size_type(0)))>>
+            : std::true_type
+        {
+        };
+
+        // Returns the grain used to split a range of size units of unit_size
+        // elements across threads. Ranges holding less than
+        // XTENSOR_PARALLEL_ASSIGN_THRESHOLD elements get a grain bigger than
+        // their size and are therefore assigned on the calling thread.
+        inline std::size_t assign_grain(std::size_t size, std::size_t unit_size) noexcept
+        {
+            std::size_t threshold = XTENSOR_PARALLEL_ASSIGN_THRESHOLD;
+            if (size * unit_size < threshold || parallel_concurrency() < 2)
+            {
+                return size + 1;
+            }
+            return std::max(threshold / (unit_size * parallel_concurrency()), std::size_t(1));
+        }
     }
 
     template <class E1, class E2>
@@ -215,7 +348,8 @@ namespace xt
             constexpr bool simd_assign = contiguous_layout && same_type && simd_size && !forbid_simd;
             trivial_assigner<simd_assign>::run(de1, de2);
         }
-        else
+        else if (!detail::assign_reducer(de1, de2) && !detail::assign_accumulator(de1, de2) &&
+                 !detail::assign_generator(de1, de2))
         {
             data_assigner<E1, E2, default_assignable_layout(E1::static_layout)> assigner(de1, de2);
             assigner.run();
@@ -302,7 +436,7 @@ namespace xt
 
     template <class E1, class E2, layout_type L>
     inline data_assigner<E1, E2, L>::data_assigner(E1& e1, const E2& e2)
-        : m_e1(e1), m_lhs(e1.stepper_begin(e1.shape())),
+        : m_e1(e1), m_e2(e2), m_lhs(e1.stepper_begin(e1.shape())),
           m_rhs(e2.stepper_begin(e1.shape())), m_rhs_end(e2.stepper_end(e1.shape(), L)),
           m_index(xtl::make_sequence<index_type>(e1.shape().size(), size_type(0)))
     {
@@ -315,6 +449,51 @@ namespace xt
         using result_type = std::decay_t<decltype(*m_lhs)>;
         constexpr bool is_narrowing = is_narrowing_conversion<argument_type, result_type>::value;
 
+        // The outermost dimension with an extent greater than 1 is split
+        // across threads when the assignment is big enough. Elements
+        // accessed through proxies (e.g. bits of a bitset) may share
+        // memory, and random expressions must be drawn in order: both
+        // are always assigned on the calling thread.
+        constexpr bool parallel_assignable = std::is_lvalue_reference<typename E1::reference>::value &&
+            detail::is_splittable<E2>::value;
+        const auto& shape = m_e1.shape();
+        size_type dim_size = shape.size();
+        size_type dim = 0;
+        if (L == layout_type::row_major)
+        {
+            while (dim < dim_size && shape[dim] == 1)
+            {
+                ++dim;
+            }
+        }
+        else
+        {
+            dim = dim_size;
+            while (dim != 0 && shape[dim - 1] == 1)
+            {
+                --dim;
+            }
+            dim = dim != 0 ? dim - 1 : dim_size;
+        }
+
+        // empty assignments take the serial loop, which does nothing
+        if (parallel_assignable && dim != dim_size && m_e1.size() != 0)
+        {
+            size_type split_size = shape[dim];
+            size_type slice_cost = (m_e1.size() / split_size) * detail::element_cost(m_e2);
+            size_type grain = detail::assign_grain(split_size, slice_cost);
+            if (grain <= split_size)
+            {
+                E1& e1 = m_e1;
+                const E2& e2 = m_e2;
+                parallel_for(split_size, grain, [&e1, &e2, dim](size_type first, size_type last) {
+                    data_assigner<E1, E2, L> assigner(e1, e2);
+                    assigner.run(dim, first, last);
+                });
+                return;
+            }
+        }
+
         while (m_rhs != m_rhs_end)
         {
             *m_lhs = conditional_cast<is_narrowing, result_type>(*m_rhs);
@@ -322,6 +501,42 @@ namespace xt
         }
     }
 
+    /**
+     * Assigns the slices [first, last) of the dimension \c dim, where every
+     * dimension outer to \c dim (in the sense of the layout L) has an extent
+     * of 1.
+     */
+    template <class E1, class E2, layout_type L>
+    inline void data_assigner<E1, E2, L>::run(size_type dim, size_type first, size_type last)
+    {
+        using argument_type = std::decay_t<decltype(*m_rhs)>;
+        using result_type = std::decay_t<decltype(*m_lhs)>;
+        constexpr bool is_narrowing = is_narrowing_conversion<argument_type, result_type>::value;
+
+        if (first == last)
+        {
+            return;
+        }
+        size_type slice_size = m_e1.size() / m_e1.shape()[dim];
+        if (first != 0)
+        {
+            m_lhs.step(dim, first);
+            m_rhs.step(dim, first);
+        }
+        for (size_type i = first; i != last; ++i)
+        {
+            for (size_type j = 0; j != slice_size; ++j)
+            {
+                *m_lhs = conditional_cast<is_narrowing, result_type>(*m_rhs);
+                increment_inner(dim);
+            }
+            if (i + 1 != last)
+            {
+                step(dim);
+            }
+        }
+    }
+
     template <class E1, class E2, layout_type L>
     inline void data_assigner<E1, E2, L>::step(size_type i)
     {
@@ -343,6 +558,42 @@ namespace xt
         m_rhs.to_end(l);
     }
 
+    // Increments the steppers over the dimensions inner to dim; when the
+    // end of the slice is reached, the steppers go back to its beginning.
+    template <class E1, class E2, layout_type L>
+    inline void data_assigner<E1, E2, L>::increment_inner(size_type dim)
+    {
+        const auto& shape = m_e1.shape();
+        if (L == layout_type::row_major)
+        {
+            for (size_type i = shape.size(); i != dim + 1; --i)
+            {
+                if (m_index[i - 1] != shape[i - 1] - 1)
+                {
+                    ++m_index[i - 1];
+                    step(i - 1);
+                    return;
+                }
+                m_index[i - 1] = 0;
+                reset(i - 1);
+            }
+        }
+        else
+        {
+            for (size_type i = 0; i != dim; ++i)
+            {
+                if (m_index[i] != shape[i] - 1)
+                {
+                    ++m_index[i];
+                    step(i);
+                    return;
+                }
+                m_index[i] = 0;
+                reset(i);
+            }
+        }
+    }
+
     /***********************************
      * trivial_assigner implementation *
      ***********************************/
@@ -367,10 +618,18 @@ namespace xt
         {
             e1.data_element(i) = e2.data_element(i);
         }
-        for (size_type i = align_begin; i < align_end; i += simd_size)
-        {
-            e1.template store_simd<lhs_align_mode, simd_type>(i, e2.template load_simd<rhs_align_mode, simd_type>(i));
-        }
+
+        // The aligned part is split across threads on simd boundaries
+        size_type nb_batches = (align_end - align_begin) / simd_size;
+        parallel_for(nb_batches, detail::assign_grain(nb_batches, simd_size),
+                     [&e1, &e2, align_begin, simd_size](size_type first, size_type last) {
+                         size_type batch_end = align_begin + last * simd_size;
+                         for (size_type i = align_begin + first * simd_size; i < batch_end; i += simd_size)
+                         {
+                             e1.template store_simd<lhs_align_mode, simd_type>(i, e2.template load_simd<rhs_align_mode, simd_type>(i));
+                         }
+                     });
+
         for (size_type i = align_end; i < size; ++i)
         {
             e1.data_element(i) = e2.data_element(i);
@@ -379,10 +638,48 @@ namespace xt
 
     namespace assigner_detail
     {
+        template <class E1, class E2>
+        inline bool trivial_assigner_parallel_copy(E1& e1, const E2& e2, std::true_type)
+        {
+            using size_type = typename E1::size_type;
+            using argument_type = typename E2::value_type;
+            using result_type = typename E1::value_type;
+            constexpr bool is_narrowing = is_narrowing_conversion<argument_type, result_type>::value;
+
+            size_type size = e1.size();
+            size_type grain = detail::assign_grain(size, size_type(1));
+            if (grain > size)
+            {
+                return false;
+            }
+            parallel_for(size, grain, [&e1, &e2](size_type first, size_type last) {
+                for (size_type i = first; i != last; ++i)
+                {
+                    e1.data_element(i) = conditional_cast<is_narrowing, result_type>(e2.data_element(i));
+                }
+            });
+            return true;
+        }
+
+        template <class E1, class E2>
+        inline bool trivial_assigner_parallel_copy(E1&, const E2&, std::false_type)
+        {
+            return false;
+        }
+
         template <class E1, class E2>
         inline void trivial_assigner_run_impl(E1& e1, const E2& e2, std::true_type)
         {
-            std::copy(e2.storage_cbegin(), e2.storage_cend(), e1.storage_begin());
+            // data_element is only guaranteed to be valid on contiguous expressions,
+            // and elements accessed through proxies may share memory.
+            constexpr bool contiguous_layout = E1::contiguous_layout && E2::contiguous_layout;
+            constexpr bool lvalue_reference = std::is_lvalue_reference<typename E1::reference>::value;
+            using indexable = std::integral_constant<bool, contiguous_layout && lvalue_reference &&
+                detail::has_data_element<E1>::value && detail::has_data_element<E2>::value>;
+            if (!trivial_assigner_parallel_copy(e1, e2, indexable()))
+            {
+                std::copy(e2.storage_cbegin(), e2.storage_cend(), e1.storage_begin());
+            }
         }
 
         template <class E1, class E2>
@@ -9,15 +9,36 @@
 #ifndef XTENSOR_CSV_HPP
 #define XTENSOR_CSV_HPP
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <exception>
+#include <fstream>
 #include <istream>
 #include <iterator>
+#include <limits>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "xparallel.hpp"
 #include "xtensor.hpp"
 
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#define XTENSOR_CSV_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace xt
 {
 
@@ -28,6 +49,9 @@ namespace xt
     template <class T, class A = std::allocator<T>>
     xtensor_container<std::vector<T, A>, 2> load_csv(std::istream& stream);
 
+    template <class T, class A = std::allocator<T>>
+    xtensor_container<std::vector<T, A>, 2> load_csv_parallel(const std::string& filename);
+
     template <class E>
     void dump_csv(std::ostream& stream, const xexpression<E>& e);
 
@@ -73,93 +97,1505 @@ namespace xt
         template <>
         inline unsigned long long lexical_cast<unsigned long long>(const std::string& cell) { return std::stoull(cell); }
 
-        template <class ST, class T, class OI>
-        ST load_csv_row(std::istream& row_stream, OI output, std::string cell)
+        /***************
+         * cell parser *
+         ***************/
+
+        // The cells are parsed without locale by fast paths that return the
+        // same value as the std::sto* functions. Cells that are not handled
+        // by the fast paths, including invalid cells, are parsed by
+        // lexical_cast, so that the values and the exceptions are unchanged.
+
+        inline bool is_csv_space(char c) noexcept
+        {
+            return c == ' ' || (c >= '\t' && c <= '\r');
+        }
+
+        inline bool is_csv_digit(char c) noexcept
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        // Eight digits are checked and converted at once in a 64-bit word
+        inline std::uint64_t read_csv_word(const char* p) noexcept
         {
-            ST length = 0;
-            while (std::getline(row_stream, cell, ','))
+            std::uint64_t res = 0;
+            for (std::size_t i = 8; i != 0; --i)
             {
-                *output++ = lexical_cast<T>(cell);
-                ++length;
+                res = (res << 8) | static_cast<unsigned char>(p[i - 1]);
             }
-            return length;
+            return res;
         }
-    }
 
-    /**
-     * @brief Load tensor from CSV.
-     * 
-     * Returns an \ref xexpression for the parsed CSV
-     * @param stream the input stream containing the CSV encoded values
-     */
-    template <class T, class A>
-    xtensor_container<std::vector<T, A>, 2> load_csv(std::istream& stream)
-    {
-        using container_type = typename std::vector<T, A>;
-        using tensor_type = xtensor_container<container_type, 2>;
-        using size_type = typename tensor_type::size_type;
-        using inner_shape_type = typename tensor_type::inner_shape_type;
-        using inner_strides_type = typename tensor_type::inner_strides_type;
-        using output_iterator = std::back_insert_iterator<container_type>;
+        inline bool is_csv_eight_digits(std::uint64_t w) noexcept
+        {
+            return ((w & 0xf0f0f0f0f0f0f0f0) | (((w + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4)) ==
+                   0x3333333333333333;
+        }
+
+        inline std::uint64_t parse_csv_eight_digits(std::uint64_t w) noexcept
+        {
+            const std::uint64_t mask = 0x000000ff000000ff;
+            w -= 0x3030303030303030;
+            w = (w * 10) + (w >> 8);
+            return (((w & mask) * 0x000f424000000064) + (((w >> 16) & mask) * 0x0000271000000001)) >> 32;
+        }
+
+        // Accumulates decimal digits in value, which wraps around beyond 19 digits
+        inline const char* accumulate_csv_digits(const char* p, const char* last, std::uint64_t& value) noexcept
+        {
+            for (; last - p >= 8; p += 8)
+            {
+                std::uint64_t w = read_csv_word(p);
+                if (!is_csv_eight_digits(w))
+                {
+                    break;
+                }
+                value = 100000000 * value + parse_csv_eight_digits(w);
+            }
+            for (; p != last && is_csv_digit(*p); ++p)
+            {
+                value = 10 * value + static_cast<std::uint64_t>(*p - '0');
+            }
+            return p;
+        }
 
-        container_type data;
-        size_type nbrow = 0, nbcol = 0;
+        // Reads an optional sign and at most max_digits decimal digits.
+        // Returns false if there is no digit or more than max_digits.
+        inline bool parse_csv_digits(const char*& p, const char* last, bool& negative,
+                                     std::uint64_t& value, std::size_t max_digits) noexcept
         {
-            output_iterator output(data);
-            std::string row, cell;
-            while (std::getline(stream, row))
+            while (p != last && is_csv_space(*p))
+            {
+                ++p;
+            }
+            negative = p != last && *p == '-';
+            if (p != last && (*p == '-' || *p == '+'))
             {
-                std::stringstream row_stream(row);
-                nbcol = detail::load_csv_row<size_type, T, output_iterator>(row_stream, output, cell);
-                ++nbrow;
+                ++p;
             }
+            const char* digits = p;
+            value = 0;
+            p = accumulate_csv_digits(p, last, value);
+            std::size_t nb_digits = static_cast<std::size_t>(p - digits);
+            return nb_digits != 0 && nb_digits <= max_digits;
         }
-        inner_shape_type shape = {nbrow, nbcol};
-        inner_strides_type strides;  // no need for initializer list for stack-allocated strides_type
-        size_type data_size = compute_strides(shape, layout_type::row_major, strides);
-        // Sanity check for data size.
-        if (data.size() != data_size)
+
+        // Integers are parsed like std::stoi, std::stol, std::stoll (signed
+        // P) or std::stoul, std::stoull (unsigned P, negative values wrap
+        // around) and converted to T.
+        template <class T, class P>
+        inline bool parse_csv_integer(const char* first, const char* last, T& res, std::true_type) noexcept
         {
-            throw std::runtime_error("Inconsistent row lengths in CSV");
+            bool negative;
+            std::uint64_t magnitude;
+            if (!parse_csv_digits(first, last, negative, magnitude, 18))
+            {
+                return false;
+            }
+            std::int64_t value = negative ? -static_cast<std::int64_t>(magnitude) : static_cast<std::int64_t>(magnitude);
+            if (value < static_cast<std::int64_t>(std::numeric_limits<P>::min()) ||
+                value > static_cast<std::int64_t>(std::numeric_limits<P>::max()))
+            {
+                return false;
+            }
+            res = static_cast<T>(value);
+            return true;
         }
-        return tensor_type(std::move(data), std::move(shape), std::move(strides));
-    }
 
-    /**
-     * @brief Dump tensor to CSV.
-     * 
-     * @param stream the output stream to write the CSV encoded values
-     * @param e the tensor expression to serialize
-     */
-    template <class E>
-    void dump_csv(std::ostream& stream, const xexpression<E>& e)
-    {
-        using size_type = typename E::size_type;
-        const E& ex = e.derived_cast();
-        if (ex.dimension() != 2)
+        template <class T, class P>
+        inline bool parse_csv_integer(const char* first, const char* last, T& res, std::false_type) noexcept
         {
-            throw std::runtime_error("Only 2-D expressions can be serialized to CSV");
+            bool negative;
+            std::uint64_t magnitude;
+            if (!parse_csv_digits(first, last, negative, magnitude, 18) ||
+                magnitude > static_cast<std::uint64_t>(std::numeric_limits<P>::max()))
+            {
+                return false;
+            }
+            P value = static_cast<P>(magnitude);
+            res = static_cast<T>(negative ? static_cast<P>(P(0) - value) : value);
+            return true;
+        }
+
+        // Exact floating point computations are only valid without excess
+        // precision
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+        constexpr bool csv_fast_float = true;
+#else
+        constexpr bool csv_fast_float = false;
+#endif
+
+        template <class T>
+        struct csv_float_traits;
+
+        template <>
+        struct csv_float_traits<float>
+        {
+            static constexpr std::uint64_t max_mantissa = std::uint64_t(1) << 24;
+            static constexpr int max_exponent = 10;
+        };
+
+        template <>
+        struct csv_float_traits<double>
+        {
+            static constexpr std::uint64_t max_mantissa = std::uint64_t(1) << 53;
+            static constexpr int max_exponent = 22;
+        };
+
+        template <class T>
+        inline T csv_power_of_ten(int e) noexcept
+        {
+            static constexpr T powers[] = {T(1e0), T(1e1), T(1e2), T(1e3), T(1e4), T(1e5), T(1e6), T(1e7),
+                                       T(1e8), T(1e9), T(1e10), T(1e11), T(1e12), T(1e13), T(1e14), T(1e15),
+                                       T(1e16), T(1e17), T(1e18), T(1e19), T(1e20), T(1e21), T(1e22)};
+            return powers[e];
+        }
+
+        // Decimal numbers whose significand and power of ten are exactly
+        // representable in T are computed with a single rounded operation,
+        // which gives the correctly rounded value returned by std::stod.
+        template <class T>
+        inline bool parse_csv_float(const char* p, const char* last, T& res) noexcept
+        {
+            using traits = csv_float_traits<T>;
+            while (p != last && is_csv_space(*p))
+            {
+                ++p;
+            }
+            bool negative = p != last && *p == '-';
+            if (p != last && (*p == '-' || *p == '+'))
+            {
+                ++p;
+            }
+            // hexadecimal numbers
+            if (last - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+            {
+                return false;
+            }
+
+            // leading zeros are not significant digits
+            const char* digits = p;
+            while (p != last && *p == '0')
+            {
+                ++p;
+            }
+            const char* significant = p;
+            std::uint64_t mantissa = 0;
+            p = accumulate_csv_digits(p, last, mantissa);
+            std::ptrdiff_t nb_digits = p - digits;
+            std::ptrdiff_t nb_significant = p - significant;
+            int exponent = 0;
+            if (p != last && *p == '.')
+            {
+                const char* fraction = ++p;
+                if (mantissa == 0)
+                {
+                    while (p != last && *p == '0')
+                    {
+                        ++p;
+                    }
+                }
+                significant = p;
+                p = accumulate_csv_digits(p, last, mantissa);
+                nb_digits += p - fraction;
+                nb_significant += p - significant;
+                exponent = -static_cast<int>(p - fraction);
+            }
+            if (nb_digits == 0 || nb_significant > 19)
+            {
+                return false;
+            }
+            if (p != last && (*p == 'e' || *p == 'E'))
+            {
+                const char* q = p + 1;
+                bool negative_exponent = q != last && *q == '-';
+                if (q != last && (*q == '-' || *q == '+'))
+                {
+                    ++q;
+                }
+                // an incomplete exponent is not part of the number
+                if (q != last && is_csv_digit(*q))
+                {
+                    int e = 0;
+                    for (; q != last && is_csv_digit(*q); ++q)
+                    {
+                        e = e < 10000 ? 10 * e + (*q - '0') : e;
+                    }
+                    exponent += negative_exponent ? -e : e;
+                }
+            }
+
+            if (mantissa == 0)
+            {
+                res = negative ? -T(0) : T(0);
+                return true;
+            }
+            if (!csv_fast_float || mantissa > traits::max_mantissa)
+            {
+                return false;
+            }
+            if (exponent > traits::max_exponent)
+            {
+                // the significand absorbs the excess of the exponent if it stays exact
+                for (; exponent > traits::max_exponent && mantissa <= traits::max_mantissa; --exponent)
+                {
+                    mantissa *= 10;
+                }
+                if (mantissa > traits::max_mantissa || exponent > traits::max_exponent)
+                {
+                    return false;
+                }
+            }
+            else if (exponent < -traits::max_exponent)
+            {
+                return false;
+            }
+            T value = static_cast<T>(mantissa);
+            value = exponent < 0 ? value / csv_power_of_ten<T>(-exponent) : value * csv_power_of_ten<T>(exponent);
+            res = negative ? -value : value;
+            return true;
+        }
+
+        template <class T>
+        struct csv_cell_parser
+        {
+            static bool run(const char*, const char*, T&) noexcept
+            {
+                return false;
+            }
+        };
+
+        template <>
+        struct csv_cell_parser<float>
+        {
+            static bool run(const char* first, const char* last, float& res) noexcept
+            {
+                return parse_csv_float(first, last, res);
+            }
+        };
+
+        template <>
+        struct csv_cell_parser<double>
+        {
+            static bool run(const char* first, const char* last, double& res) noexcept
+            {
+                return parse_csv_float(first, last, res);
+            }
+        };
+
+        template <class T, class P>
+        struct csv_integer_parser
+        {
+            static bool run(const char* first, const char* last, T& res) noexcept
+            {
+                return parse_csv_integer<T, P>(first, last, res, std::is_signed<P>());
+            }
+        };
+
+        template <>
+        struct csv_cell_parser<int> : csv_integer_parser<int, int>
+        {
+        };
+
+        template <>
+        struct csv_cell_parser<long> : csv_integer_parser<long, long>
+        {
+        };
+
+        template <>
+        struct csv_cell_parser<long long> : csv_integer_parser<long long, long long>
+        {
+        };
+
+        // std::stoul is used for unsigned int
+        template <>
+        struct csv_cell_parser<unsigned int> : csv_integer_parser<unsigned int, unsigned long>
+        {
+        };
+
+        template <>
+        struct csv_cell_parser<unsigned long> : csv_integer_parser<unsigned long, unsigned long>
+        {
+        };
+
+        template <>
+        struct csv_cell_parser<unsigned long long> : csv_integer_parser<unsigned long long, unsigned long long>
+        {
+        };
+
+        template <class T>
+        inline T parse_csv_cell(const char* first, const char* last)
+        {
+            T res;
+            if (!csv_cell_parser<T>::run(first, last, res))
+            {
+                res = lexical_cast<T>(std::string(first, last));
+            }
+            return res;
+        }
+
+        /**************
+         * row parser *
+         **************/
+
+        inline const char* find_csv_char(const char* first, const char* last, char c) noexcept
+        {
+            const void* res = std::memchr(first, c, static_cast<std::size_t>(last - first));
+            return res == nullptr ? last : static_cast<const char*>(res);
+        }
+
+        // Returns the number of cells of the row [first, last); like with
+        // std::getline, a delimiter at the end of the row does not start a
+        // new cell.
+        inline std::size_t count_csv_cells(const char* first, const char* last, char delimiter) noexcept
+        {
+            std::size_t res = 0;
+            for (const char* p = first; p != last; ++res)
+            {
+                p = find_csv_char(p, last, delimiter);
+                p = p == last ? last : p + 1;
+            }
+            return res;
+        }
+
+        // Parses the cells of the row [first, last) in the nbcol elements
+        // starting at out. Returns false if the row does not have nbcol cells.
+        template <class T, class O>
+        inline bool parse_csv_row(const char* first, const char* last, char delimiter, O out, std::size_t nbcol)
+        {
+            std::size_t count = 0;
+            for (const char* p = first; p != last; ++count)
+            {
+                const char* cell_end = find_csv_char(p, last, delimiter);
+                if (count == nbcol)
+                {
+                    return false;
+                }
+                *out++ = parse_csv_cell<T>(p, cell_end);
+                p = cell_end == last ? last : cell_end + 1;
+            }
+            return count == nbcol;
+        }
+
+        // Parses the cells of the selected columns of a row, given by pairs
+        // of column index and position in out sorted by index; the cells of
+        // the other columns are skipped without being parsed.
+        template <class T, class O, class S>
+        inline bool parse_csv_columns(const char* first, const char* last, char delimiter, O out,
+                                      std::size_t nbcol, const S& selection)
+        {
+            std::size_t count = 0;
+            auto selected = selection.cbegin();
+            for (const char* p = first; p != last; ++count)
+            {
+                const char* cell_end = find_csv_char(p, last, delimiter);
+                if (count == nbcol)
+                {
+                    return false;
+                }
+                if (selected != selection.cend() && selected->first == count)
+                {
+                    T value = parse_csv_cell<T>(p, cell_end);
+                    for (; selected != selection.cend() && selected->first == count; ++selected)
+                    {
+                        out[static_cast<std::ptrdiff_t>(selected->second)] = value;
+                    }
+                }
+                p = cell_end == last ? last : cell_end + 1;
+            }
+            return count == nbcol;
+        }
+
+        // Returns the number of rows of the buffer [first, last), the last
+        // row may not end with a newline.
+        inline std::size_t count_csv_rows(const char* first, const char* last) noexcept
+        {
+            std::size_t res = 0;
+            for (const char* p = first; p != last; ++res)
+            {
+                p = find_csv_char(p, last, '\n');
+                p = p == last ? last : p + 1;
+            }
+            return res;
+        }
+
+        inline std::string read_csv_buffer(std::istream& stream)
+        {
+            std::string res;
+            if (!stream)
+            {
+                return res;
+            }
+            // the remaining size of seekable streams is read at once
+            std::istream::pos_type position = stream.tellg();
+            if (position != std::istream::pos_type(-1) && stream.seekg(0, std::ios::end))
+            {
+                std::streamoff remaining = stream.tellg() - position;
+                stream.seekg(position);
+                if (remaining > 0)
+                {
+                    res.resize(static_cast<std::size_t>(remaining));
+                    stream.read(&res[0], static_cast<std::streamsize>(res.size()));
+                    res.resize(static_cast<std::size_t>(stream.gcount()));
+                }
+            }
+            stream.clear(stream.rdstate() & ~std::ios::failbit);
+            constexpr std::size_t block_size = std::size_t(1) << 20;
+            std::size_t size = res.size();
+            while (stream)
+            {
+                res.resize(std::max(size + block_size, 2 * size));
+                stream.read(&res[size], static_cast<std::streamsize>(res.size() - size));
+                size += static_cast<std::size_t>(stream.gcount());
+            }
+            res.resize(size);
+            return res;
+        }
+
+        /*******************
+         * csv_file_buffer *
+         ********************/
+
+        // Read-only contents of a file, mapped in memory when the system
+        // supports it and read at once otherwise.
+        class csv_file_buffer
+        {
+        public:
+
+            explicit csv_file_buffer(const std::string& filename);
+            ~csv_file_buffer();
+
+            csv_file_buffer(const csv_file_buffer&) = delete;
+            csv_file_buffer& operator=(const csv_file_buffer&) = delete;
+
+            const char* begin() const noexcept;
+            const char* end() const noexcept;
+
+        private:
+
+            const char* p_data;
+            std::size_t m_size;
+#ifndef XTENSOR_CSV_MMAP
+            std::string m_buffer;
+#endif
+        };
+
+#ifdef XTENSOR_CSV_MMAP
+        inline csv_file_buffer::csv_file_buffer(const std::string& filename)
+            : p_data(nullptr), m_size(0)
+        {
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd == -1)
+            {
+                throw std::runtime_error("io error: failed to open a file.");
+            }
+            struct stat st;
+            if (::fstat(fd, &st) == -1)
+            {
+                ::close(fd);
+                throw std::runtime_error("io error: failed to open a file.");
+            }
+            m_size = static_cast<std::size_t>(st.st_size);
+            // empty files cannot be mapped
+            void* base = m_size == 0 ? nullptr : ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (base == MAP_FAILED)
+            {
+                throw std::runtime_error("io error: failed to map a file.");
+            }
+            p_data = static_cast<const char*>(base);
+        }
+
+        inline csv_file_buffer::~csv_file_buffer()
+        {
+            if (m_size != 0)
+            {
+                ::munmap(const_cast<char*>(p_data), m_size);
+            }
+        }
+#else
+        inline csv_file_buffer::csv_file_buffer(const std::string& filename)
+            : p_data(nullptr), m_size(0)
+        {
+            std::ifstream stream(filename, std::ios::in | std::ios::binary);
+            if (!stream)
+            {
+                throw std::runtime_error("io error: failed to open a file.");
+            }
+            m_buffer = read_csv_buffer(stream);
+            p_data = m_buffer.data();
+            m_size = m_buffer.size();
+        }
+
+        inline csv_file_buffer::~csv_file_buffer()
+        {
+        }
+#endif
+
+        inline const char* csv_file_buffer::begin() const noexcept
+        {
+            return p_data;
+        }
+
+        inline const char* csv_file_buffer::end() const noexcept
+        {
+            return p_data + m_size;
+        }
+
+        /*******************
+         * load_csv_buffer *
+         ********************/
+
+        // Minimal number of bytes of the chunks of a CSV parsed in parallel
+        constexpr std::size_t csv_chunk_size = std::size_t(1) << 16;
+
+        inline std::runtime_error csv_row_length_error(std::size_t line, std::size_t nb_cells, std::size_t nbcol)
+        {
+            return std::runtime_error("Inconsistent row lengths in CSV: line " + std::to_string(line) + " has " +
+                                      std::to_string(nb_cells) + " cells, expected " + std::to_string(nbcol));
+        }
+
+        // Parses the rows of [first, last) into out; first_line is the
+        // one-based number of the first row in the CSV, for error messages.
+        template <class T, class O>
+        inline void parse_csv_rows(const char* first, const char* last, O out, std::size_t nbcol, std::size_t first_line)
+        {
+            std::size_t line = first_line;
+            for (const char* p = first; p != last; out += static_cast<std::ptrdiff_t>(nbcol), ++line)
+            {
+                const char* row_end = find_csv_char(p, last, '\n');
+                if (!parse_csv_row<T>(p, row_end, ',', out, nbcol))
+                {
+                    throw csv_row_length_error(line, count_csv_cells(p, row_end, ','), nbcol);
+                }
+                p = row_end == last ? last : row_end + 1;
+            }
         }
-        size_type nbrows = ex.shape()[0], nbcols = ex.shape()[1];
-        auto st = ex.stepper_begin(ex.shape());
-        for (size_type r = 0; r != nbrows; ++r)
+
+        // Splits [first, last) into nb_chunks ranges of whole lines whose rows
+        // are counted, then parsed at their final position, in parallel.
+        template <class T, class A>
+        inline xtensor_container<std::vector<T, A>, 2> load_csv_buffer(const char* first, const char* last, std::size_t nb_chunks)
         {
-            for (size_type c = 0; c != nbcols; ++c)
+            using container_type = typename std::vector<T, A>;
+            using tensor_type = xtensor_container<container_type, 2>;
+            using size_type = typename tensor_type::size_type;
+            using inner_shape_type = typename tensor_type::inner_shape_type;
+            using inner_strides_type = typename tensor_type::inner_strides_type;
+
+            // the elements of std::vector<bool> cannot be written concurrently
+            if (std::is_same<T, bool>::value)
+            {
+                nb_chunks = 1;
+            }
+
+            std::size_t size = static_cast<std::size_t>(last - first);
+            std::vector<const char*> bounds(nb_chunks + 1, last);
+            bounds[0] = first;
+            for (std::size_t i = 1; i < nb_chunks; ++i)
             {
-                stream << *st;
-                if (c != nbcols - 1)
+                const char* p = first + i * (size / nb_chunks);
+                if (p <= bounds[i - 1])
                 {
-                    st.step(1);
-                    stream << ',';
+                    p = bounds[i - 1];
                 }
                 else
                 {
-                    st.reset(1);
-                    st.step(0);
-                    stream << std::endl;
+                    // moves p to the beginning of the next line, unless it already is
+                    p = find_csv_char(p - 1, last, '\n');
+                    p = p == last ? last : p + 1;
                 }
+                bounds[i] = p;
             }
+
+            std::vector<size_type> row_offsets(nb_chunks + 1, size_type(0));
+            parallel_for(nb_chunks, 1, [&bounds, &row_offsets](std::size_t f, std::size_t l) {
+                for (std::size_t i = f; i != l; ++i)
+                {
+                    row_offsets[i + 1] = count_csv_rows(bounds[i], bounds[i + 1]);
+                }
+            });
+            std::partial_sum(row_offsets.cbegin(), row_offsets.cend(), row_offsets.begin());
+
+            size_type nbrow = row_offsets.back();
+            size_type nbcol = count_csv_cells(first, find_csv_char(first, last, '\n'), ',');
+            container_type data(nbrow * nbcol);
+
+            // the errors are rethrown in the order of the chunks, so that
+            // the first invalid row of the CSV is reported
+            std::vector<std::exception_ptr> errors(nb_chunks);
+            parallel_for(nb_chunks, 1, [&](std::size_t f, std::size_t l) {
+                for (std::size_t i = f; i != l; ++i)
+                {
+                    try
+                    {
+                        auto out = data.begin() + static_cast<std::ptrdiff_t>(row_offsets[i] * nbcol);
+                        parse_csv_rows<T>(bounds[i], bounds[i + 1], out, nbcol, row_offsets[i] + 1);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                }
+            });
+            for (const auto& error : errors)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+
+            inner_shape_type shape = {nbrow, nbcol};
+            inner_strides_type strides;  // no need for initializer list for stack-allocated strides_type
+            compute_strides(shape, layout_type::row_major, strides);
+            return tensor_type(std::move(data), std::move(shape), std::move(strides));
+        }
+    }
+
+    /**
+     * @brief Load tensor from CSV.
+     * 
+     * Returns an \ref xexpression for the parsed CSV. The cells are parsed
+     * with the value the std::sto* functions return in the "C" locale,
+     * and the same exceptions are thrown for invalid cells.
+     * @param stream the input stream containing the CSV encoded values
+     */
+    template <class T, class A>
+    xtensor_container<std::vector<T, A>, 2> load_csv(std::istream& stream)
+    {
+        std::string buffer = detail::read_csv_buffer(stream);
+        return detail::load_csv_buffer<T, A>(buffer.data(), buffer.data() + buffer.size(), 1);
+    }
+
+    /**
+     * @brief Load tensor from a CSV file in parallel.
+     *
+     * The file is mapped in memory when the system supports it and split
+     * into chunks of whole lines, which are parsed in parallel directly
+     * into the returned tensor. The cells are parsed as by \ref load_csv.
+     * @param filename the name of the CSV file
+     */
+    template <class T, class A>
+    xtensor_container<std::vector<T, A>, 2> load_csv_parallel(const std::string& filename)
+    {
+        detail::csv_file_buffer buffer(filename);
+        std::size_t size = static_cast<std::size_t>(buffer.end() - buffer.begin());
+        std::size_t nb_chunks = std::min(size / detail::csv_chunk_size, 4 * parallel_concurrency());
+        return detail::load_csv_buffer<T, A>(buffer.begin(), buffer.end(), std::max(nb_chunks, std::size_t(1)));
+    }
+
+    /**************
+     * csv_reader *
+     **************/
+
+    /**
+     * @class csv_reader
+     * @brief Streaming reader of CSV data.
+     *
+     * The csv_reader class reads the rows of a CSV stream by batches of a
+     * fixed number of rows, so that streams of any size are read with a
+     * bounded memory. The first lines of the stream may be skipped, e.g.
+     * a header, and a subset of the columns may be selected; the cells of
+     * the other columns are not parsed. The cells are parsed as by
+     * \ref load_csv, and all the rows must have the same number of cells.
+     * The buffer of the batch is reused by each call to \ref next.
+     *
+     * @tparam T the value type of the batches
+     * @tparam A the allocator of the batches
+     */
+    template <class T, class A = std::allocator<T>>
+    class csv_reader
+    {
+    public:
+
+        using value_type = T;
+        using allocator_type = A;
+        using tensor_type = xtensor_container<std::vector<T, A>, 2>;
+        using size_type = typename tensor_type::size_type;
+
+        csv_reader(std::istream& stream, size_type batch_size, char delimiter = ',',
+                   size_type skip_lines = 0, std::vector<size_type> columns = {});
+
+        csv_reader(const csv_reader&) = delete;
+        csv_reader& operator=(const csv_reader&) = delete;
+
+        bool next();
+        const tensor_type& batch() const noexcept;
+
+        size_type line() const noexcept;
+
+    private:
+
+        static constexpr size_type unknown_size() noexcept;
+
+        bool read_line(const char*& first, const char*& last);
+        void fill_buffer();
+        void init_columns(const char* first, const char* last);
+        void parse_row(const char* first, const char* last, typename std::vector<T, A>::iterator out) const;
+
+        std::istream& m_stream;
+        std::string m_buffer;
+        std::size_t m_begin;
+        std::size_t m_end;
+        bool m_eof;
+        size_type m_batch_size;
+        char m_delimiter;
+        size_type m_skip_lines;
+        std::vector<size_type> m_columns;
+        // selected columns sorted by index, with their position in the batch
+        std::vector<std::pair<size_type, size_type>> m_selection;
+        // number of cells of the rows, unknown until the first row is read
+        size_type m_nbcol;
+        size_type m_line;
+        tensor_type m_batch;
+    };
+
+    /**
+     * Builds a reader of the rows of a stream.
+     * @param stream the input stream containing the CSV encoded values
+     * @param batch_size the number of rows of the batches, except the last one
+     * @param delimiter the character separating the cells of a row
+     * @param skip_lines the number of lines skipped at the beginning of the stream
+     * @param columns the indices of the columns of the batches, in their order;
+     *        all the columns are read when empty
+     */
+    template <class T, class A>
+    inline csv_reader<T, A>::csv_reader(std::istream& stream, size_type batch_size, char delimiter,
+                                        size_type skip_lines, std::vector<size_type> columns)
+        : m_stream(stream), m_begin(0), m_end(0), m_eof(false), m_batch_size(batch_size),
+          m_delimiter(delimiter), m_skip_lines(skip_lines), m_columns(std::move(columns)),
+          m_nbcol(unknown_size()), m_line(0)
+    {
+        if (m_batch_size == 0)
+        {
+            throw std::invalid_argument("csv_reader: the batch size must be positive");
+        }
+    }
+
+    /**
+     * Reads the next batch of rows, which has \c batch_size rows unless
+     * the end of the stream is reached.
+     * @return false if the stream has no more rows, in which case the
+     *         batch is empty
+     */
+    template <class T, class A>
+    inline bool csv_reader<T, A>::next()
+    {
+        const char* first;
+        const char* last;
+        for (; m_skip_lines != 0; --m_skip_lines)
+        {
+            if (!read_line(first, last))
+            {
+                m_skip_lines = 0;
+                break;
+            }
+        }
+
+        if (m_nbcol != unknown_size())
+        {
+            m_batch.reshape({m_batch_size, m_batch.shape()[1]});
+        }
+        size_type nb_rows = 0;
+        while (nb_rows != m_batch_size && read_line(first, last))
+        {
+            if (m_nbcol == unknown_size())
+            {
+                init_columns(first, last);
+            }
+            auto out = m_batch.data().begin() + static_cast<std::ptrdiff_t>(nb_rows * m_batch.shape()[1]);
+            parse_row(first, last, out);
+            ++nb_rows;
+        }
+        if (nb_rows != m_batch_size)
+        {
+            m_batch.reshape({nb_rows, m_batch.shape()[1]});
+        }
+        return nb_rows != 0;
+    }
+
+    /**
+     * Returns the last batch read by \ref next.
+     */
+    template <class T, class A>
+    inline auto csv_reader<T, A>::batch() const noexcept -> const tensor_type&
+    {
+        return m_batch;
+    }
+
+    /**
+     * Returns the number of lines read, including the skipped lines.
+     */
+    template <class T, class A>
+    inline auto csv_reader<T, A>::line() const noexcept -> size_type
+    {
+        return m_line;
+    }
+
+    template <class T, class A>
+    constexpr auto csv_reader<T, A>::unknown_size() noexcept -> size_type
+    {
+        return std::numeric_limits<size_type>::max();
+    }
+
+    template <class T, class A>
+    inline bool csv_reader<T, A>::read_line(const char*& first, const char*& last)
+    {
+        std::size_t scanned = m_begin;
+        for (;;)
+        {
+            const char* data = m_buffer.data();
+            const char* line_end = detail::find_csv_char(data + scanned, data + m_end, '\n');
+            if (line_end != data + m_end || m_eof)
+            {
+                if (m_begin == m_end)
+                {
+                    return false;
+                }
+                first = data + m_begin;
+                last = line_end;
+                m_begin = line_end == data + m_end ? m_end : static_cast<std::size_t>(line_end - data) + 1;
+                ++m_line;
+                return true;
+            }
+            scanned = m_end - m_begin;
+            fill_buffer();
+        }
+    }
+
+    // Moves the unread data to the beginning of the buffer and reads the
+    // next block of the stream after it; the buffer only grows for lines
+    // longer than a block.
+    template <class T, class A>
+    inline void csv_reader<T, A>::fill_buffer()
+    {
+        constexpr std::size_t block_size = std::size_t(1) << 20;
+        std::size_t size = m_end - m_begin;
+        if (m_begin != 0)
+        {
+            std::memmove(&m_buffer[0], m_buffer.data() + m_begin, size);
+        }
+        m_begin = 0;
+        m_end = size;
+        if (m_buffer.size() < size + block_size)
+        {
+            m_buffer.resize(size + block_size);
+        }
+        m_stream.read(&m_buffer[m_end], static_cast<std::streamsize>(m_buffer.size() - m_end));
+        m_end += static_cast<std::size_t>(m_stream.gcount());
+        m_eof = !m_stream;
+    }
+
+    template <class T, class A>
+    inline void csv_reader<T, A>::init_columns(const char* first, const char* last)
+    {
+        m_nbcol = detail::count_csv_cells(first, last, m_delimiter);
+        m_selection.clear();
+        for (size_type i = 0; i < m_columns.size(); ++i)
+        {
+            if (m_columns[i] >= m_nbcol)
+            {
+                throw std::out_of_range("csv_reader: column " + std::to_string(m_columns[i]) + " out of range, the CSV has " +
+                                        std::to_string(m_nbcol) + " columns");
+            }
+            m_selection.emplace_back(m_columns[i], i);
+        }
+        std::sort(m_selection.begin(), m_selection.end());
+        m_batch.reshape({m_batch_size, m_columns.empty() ? m_nbcol : m_columns.size()});
+    }
+
+    template <class T, class A>
+    inline void csv_reader<T, A>::parse_row(const char* first, const char* last,
+                                            typename std::vector<T, A>::iterator out) const
+    {
+        bool valid = m_columns.empty() ? detail::parse_csv_row<T>(first, last, m_delimiter, out, m_nbcol)
+                                       : detail::parse_csv_columns<T>(first, last, m_delimiter, out, m_nbcol, m_selection);
+        if (!valid)
+        {
+            throw detail::csv_row_length_error(m_line, detail::count_csv_cells(first, last, m_delimiter), m_nbcol);
+        }
+    }
+
+    namespace detail
+    {
+        /****************
+         * float writer *
+         ****************/
+
+        // Floating point values are written with the shortest decimal
+        // representation that reads back to the same value, computed with
+        // the Grisu2 algorithm of F. Loitsch, "Printing Floating-Point
+        // Numbers Quickly and Accurately with Integers" (PLDI 2010). Grisu2
+        // always round-trips and gives the shortest digits for almost all
+        // values, otherwise one more digit.
+
+        struct csv_diyfp
+        {
+            std::uint64_t f;
+            int e;
+        };
+
+        // Rounded upper 64 bits of the 128-bit product of x and y
+        inline csv_diyfp csv_diyfp_mul(const csv_diyfp& x, const csv_diyfp& y) noexcept
+        {
+            constexpr std::uint64_t mask = 0xFFFFFFFFu;
+            std::uint64_t u_lo = x.f & mask, u_hi = x.f >> 32;
+            std::uint64_t v_lo = y.f & mask, v_hi = y.f >> 32;
+            std::uint64_t p0 = u_lo * v_lo, p1 = u_lo * v_hi;
+            std::uint64_t p2 = u_hi * v_lo, p3 = u_hi * v_hi;
+            std::uint64_t q = (p0 >> 32) + (p1 & mask) + (p2 & mask) + (std::uint64_t(1) << 31);
+            return {p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32), x.e + y.e + 64};
+        }
+
+        inline csv_diyfp csv_diyfp_normalize(csv_diyfp x) noexcept
+        {
+            while ((x.f >> 63) == 0)
+            {
+                x.f <<= 1;
+                --x.e;
+            }
+            return x;
+        }
+
+        template <class T>
+        struct csv_float_bits;
+
+        template <>
+        struct csv_float_bits<float>
+        {
+            using type = std::uint32_t;
+        };
+
+        template <>
+        struct csv_float_bits<double>
+        {
+            using type = std::uint64_t;
+        };
+
+        // Computes the normalized value v of a positive finite floating point
+        // value and the boundaries m_minus and m_plus of its rounding
+        // interval, with the exponent of m_plus.
+        template <class T>
+        inline void csv_float_boundaries(T value, csv_diyfp& m_minus, csv_diyfp& v, csv_diyfp& m_plus) noexcept
+        {
+            using bits_type = typename csv_float_bits<T>::type;
+            constexpr int precision = std::numeric_limits<T>::digits;
+            constexpr int bias = std::numeric_limits<T>::max_exponent - 1 + (precision - 1);
+            constexpr std::uint64_t hidden_bit = std::uint64_t(1) << (precision - 1);
+
+            bits_type raw;
+            std::memcpy(&raw, &value, sizeof(T));
+            std::uint64_t bits = raw;
+            std::uint64_t biased_exponent = bits >> (precision - 1);
+            std::uint64_t fraction = bits & (hidden_bit - 1);
+
+            csv_diyfp w = biased_exponent == 0 ? csv_diyfp{fraction, 1 - bias}
+                                               : csv_diyfp{fraction + hidden_bit, static_cast<int>(biased_exponent) - bias};
+            // the lower boundary is closer for powers of two, except the smallest normal
+            bool lower_closer = fraction == 0 && biased_exponent > 1;
+            m_plus = csv_diyfp_normalize({2 * w.f + 1, w.e - 1});
+            m_minus = lower_closer ? csv_diyfp{4 * w.f - 1, w.e - 2} : csv_diyfp{2 * w.f - 1, w.e - 1};
+            m_minus = {m_minus.f << (m_minus.e - m_plus.e), m_plus.e};
+            v = csv_diyfp_normalize(w);
+        }
+
+        struct csv_cached_power
+        {
+            std::uint64_t f;
+            int e;
+            int k;
+        };
+
+        // Returns c = f * 2^e ~= 10^k such that the binary exponent of the
+        // product of c and a normalized value of exponent e lies in [-60, -32].
+        inline csv_cached_power csv_get_cached_power(int e) noexcept
+        {
+            static const csv_cached_power powers[] = {
+                {0xAB70FE17C79AC6CA, -1060, -300},
+                {0xFF77B1FCBEBCDC4F, -1034, -292},
+                {0xBE5691EF416BD60C, -1007, -284},
+                {0x8DD01FAD907FFC3C, -980, -276},
+                {0xD3515C2831559A83, -954, -268},
+                {0x9D71AC8FADA6C9B5, -927, -260},
+                {0xEA9C227723EE8BCB, -901, -252},
+                {0xAECC49914078536D, -874, -244},
+                {0x823C12795DB6CE57, -847, -236},
+                {0xC21094364DFB5637, -821, -228},
+                {0x9096EA6F3848984F, -794, -220},
+                {0xD77485CB25823AC7, -768, -212},
+                {0xA086CFCD97BF97F4, -741, -204},
+                {0xEF340A98172AACE5, -715, -196},
+                {0xB23867FB2A35B28E, -688, -188},
+                {0x84C8D4DFD2C63F3B, -661, -180},
+                {0xC5DD44271AD3CDBA, -635, -172},
+                {0x936B9FCEBB25C996, -608, -164},
+                {0xDBAC6C247D62A584, -582, -156},
+                {0xA3AB66580D5FDAF6, -555, -148},
+                {0xF3E2F893DEC3F126, -529, -140},
+                {0xB5B5ADA8AAFF80B8, -502, -132},
+                {0x87625F056C7C4A8B, -475, -124},
+                {0xC9BCFF6034C13053, -449, -116},
+                {0x964E858C91BA2655, -422, -108},
+                {0xDFF9772470297EBD, -396, -100},
+                {0xA6DFBD9FB8E5B88F, -369, -92},
+                {0xF8A95FCF88747D94, -343, -84},
+                {0xB94470938FA89BCF, -316, -76},
+                {0x8A08F0F8BF0F156B, -289, -68},
+                {0xCDB02555653131B6, -263, -60},
+                {0x993FE2C6D07B7FAC, -236, -52},
+                {0xE45C10C42A2B3B06, -210, -44},
+                {0xAA242499697392D3, -183, -36},
+                {0xFD87B5F28300CA0E, -157, -28},
+                {0xBCE5086492111AEB, -130, -20},
+                {0x8CBCCC096F5088CC, -103, -12},
+                {0xD1B71758E219652C, -77, -4},
+                {0x9C40000000000000, -50, 4},
+                {0xE8D4A51000000000, -24, 12},
+                {0xAD78EBC5AC620000, 3, 20},
+                {0x813F3978F8940984, 30, 28},
+                {0xC097CE7BC90715B3, 56, 36},
+                {0x8F7E32CE7BEA5C70, 83, 44},
+                {0xD5D238A4ABE98068, 109, 52},
+                {0x9F4F2726179A2245, 136, 60},
+                {0xED63A231D4C4FB27, 162, 68},
+                {0xB0DE65388CC8ADA8, 189, 76},
+                {0x83C7088E1AAB65DB, 216, 84},
+                {0xC45D1DF942711D9A, 242, 92},
+                {0x924D692CA61BE758, 269, 100},
+                {0xDA01EE641A708DEA, 295, 108},
+                {0xA26DA3999AEF774A, 322, 116},
+                {0xF209787BB47D6B85, 348, 124},
+                {0xB454E4A179DD1877, 375, 132},
+                {0x865B86925B9BC5C2, 402, 140},
+                {0xC83553C5C8965D3D, 428, 148},
+                {0x952AB45CFA97A0B3, 455, 156},
+                {0xDE469FBD99A05FE3, 481, 164},
+                {0xA59BC234DB398C25, 508, 172},
+                {0xF6C69A72A3989F5C, 534, 180},
+                {0xB7DCBF5354E9BECE, 561, 188},
+                {0x88FCF317F22241E2, 588, 196},
+                {0xCC20CE9BD35C78A5, 614, 204},
+                {0x98165AF37B2153DF, 641, 212},
+                {0xE2A0B5DC971F303A, 667, 220},
+                {0xA8D9D1535CE3B396, 694, 228},
+                {0xFB9B7CD9A4A7443C, 720, 236},
+                {0xBB764C4CA7A44410, 747, 244},
+                {0x8BAB8EEFB6409C1A, 774, 252},
+                {0xD01FEF10A657842C, 800, 260},
+                {0x9B10A4E5E9913129, 827, 268},
+                {0xE7109BFBA19C0C9D, 853, 276},
+                {0xAC2820D9623BF429, 880, 284},
+                {0x80444B5E7AA7CF85, 907, 292},
+                {0xBF21E44003ACDD2D, 933, 300},
+                {0x8E679C2F5E44FF8F, 960, 308},
+                {0xD433179D9C8CB841, 986, 316},
+                {0x9E19DB92B4E31BA9, 1013, 324},
+            };
+            // powers[i] = 10^(8 * i - 300), the smallest one with k >= ceil((-61 - e) * log10(2))
+            int f = -61 - e;
+            int k = (f * 78913) / (1 << 18) + static_cast<int>(f > 0);
+            return powers[(300 + k + 7) / 8];
+        }
+
+        // Returns the number of digits of n and 10^(digits - 1)
+        inline int csv_largest_pow10(std::uint32_t n, std::uint32_t& pow10) noexcept
+        {
+            int digits = 1;
+            pow10 = 1;
+            while (digits < 10 && n / pow10 >= 10)
+            {
+                pow10 *= 10;
+                ++digits;
+            }
+            return digits;
+        }
+
+        inline void csv_grisu2_round(char* buffer, int length, std::uint64_t dist, std::uint64_t delta,
+                                     std::uint64_t rest, std::uint64_t ten_k) noexcept
+        {
+            // moves the last digit towards w while the result stays in the rounding interval
+            while (rest < dist && delta - rest >= ten_k &&
+                   (rest + ten_k < dist || dist - rest > rest + ten_k - dist))
+            {
+                --buffer[length - 1];
+                rest += ten_k;
+            }
+        }
+
+        // Generates the digits of a value in [m_minus, m_plus], as close
+        // to w as possible; the result is buffer * 10^decimal_exponent.
+        inline void csv_grisu2_digits(char* buffer, int& length, int& decimal_exponent,
+                                      csv_diyfp m_minus, csv_diyfp w, csv_diyfp m_plus) noexcept
+        {
+            std::uint64_t delta = m_plus.f - m_minus.f;
+            std::uint64_t dist = m_plus.f - w.f;
+            int shift = -m_plus.e;
+            std::uint64_t one = std::uint64_t(1) << shift;
+            std::uint32_t p1 = static_cast<std::uint32_t>(m_plus.f >> shift);
+            std::uint64_t p2 = m_plus.f & (one - 1);
+
+            std::uint32_t pow10;
+            int n = csv_largest_pow10(p1, pow10);
+            while (n > 0)
+            {
+                buffer[length++] = static_cast<char>('0' + p1 / pow10);
+                p1 %= pow10;
+                --n;
+                std::uint64_t rest = (std::uint64_t(p1) << shift) + p2;
+                if (rest <= delta)
+                {
+                    decimal_exponent += n;
+                    csv_grisu2_round(buffer, length, dist, delta, rest, std::uint64_t(pow10) << shift);
+                    return;
+                }
+                pow10 /= 10;
+            }
+
+            int m = 0;
+            do
+            {
+                p2 *= 10;
+                buffer[length++] = static_cast<char>('0' + (p2 >> shift));
+                p2 &= one - 1;
+                ++m;
+                delta *= 10;
+                dist *= 10;
+            } while (p2 > delta);
+            decimal_exponent -= m;
+            csv_grisu2_round(buffer, length, dist, delta, p2, one);
+        }
+
+        // Writes the exponent of the scientific notation as printf does
+        inline char* write_csv_exponent(char* out, int e) noexcept
+        {
+            *out++ = 'e';
+            *out++ = e < 0 ? '-' : '+';
+            unsigned int u = static_cast<unsigned int>(e < 0 ? -e : e);
+            if (u >= 100)
+            {
+                *out++ = static_cast<char>('0' + u / 100);
+                u %= 100;
+            }
+            *out++ = static_cast<char>('0' + u / 10);
+            *out++ = static_cast<char>('0' + u % 10);
+            return out;
+        }
+
+        // Writes a float or a double to out, which must hold 32 characters,
+        // and returns the end of the written characters. The notation is the
+        // one of "%g" with the greatest of 6, the precision of default
+        // streams, and the number of digits.
+        template <class T>
+        inline char* write_csv_float(char* out, T value) noexcept
+        {
+            if (std::isnan(value))
+            {
+                std::memcpy(out, "nan", 3);
+                return out + 3;
+            }
+            if (std::signbit(value))
+            {
+                *out++ = '-';
+                value = -value;
+            }
+            if (std::isinf(value))
+            {
+                std::memcpy(out, "inf", 3);
+                return out + 3;
+            }
+            if (value == T(0))
+            {
+                *out++ = '0';
+                return out;
+            }
+
+            char digits[20];
+            int n = 0;
+            int k = 0;
+            csv_diyfp m_minus, v, m_plus;
+            csv_float_boundaries(value, m_minus, v, m_plus);
+            csv_cached_power cached = csv_get_cached_power(m_plus.e);
+            csv_diyfp c = {cached.f, cached.e};
+            csv_diyfp w = csv_diyfp_mul(v, c);
+            csv_diyfp w_minus = csv_diyfp_mul(m_minus, c);
+            csv_diyfp w_plus = csv_diyfp_mul(m_plus, c);
+            // the products are exact to 1 ulp, the interval is shrunk accordingly
+            k = -cached.k;
+            csv_grisu2_digits(digits, n, k, {w_minus.f + 1, w_minus.e}, w, {w_plus.f - 1, w_plus.e});
+
+            // value = digits * 10^k = d.ddd * 10^x
+            int x = n + k - 1;
+            if (x < -4 || x >= std::max(n, 6))
+            {
+                *out++ = digits[0];
+                if (n > 1)
+                {
+                    *out++ = '.';
+                    std::memcpy(out, digits + 1, static_cast<std::size_t>(n - 1));
+                    out += n - 1;
+                }
+                return write_csv_exponent(out, x);
+            }
+            if (k >= 0)
+            {
+                std::memcpy(out, digits, static_cast<std::size_t>(n));
+                std::memset(out + n, '0', static_cast<std::size_t>(k));
+                return out + n + k;
+            }
+            if (x >= 0)
+            {
+                std::size_t int_digits = static_cast<std::size_t>(x + 1);
+                std::memcpy(out, digits, int_digits);
+                out[int_digits] = '.';
+                std::memcpy(out + int_digits + 1, digits + int_digits, static_cast<std::size_t>(n) - int_digits);
+                return out + n + 1;
+            }
+            std::size_t zeros = static_cast<std::size_t>(-x - 1);
+            *out++ = '0';
+            *out++ = '.';
+            std::memset(out, '0', zeros);
+            std::memcpy(out + zeros, digits, static_cast<std::size_t>(n));
+            return out + zeros + static_cast<std::size_t>(n);
+        }
+
+        template <class T>
+        inline bool is_csv_negative(T value, std::true_type) noexcept
+        {
+            return value < T(0);
+        }
+
+        template <class T>
+        inline bool is_csv_negative(T, std::false_type) noexcept
+        {
+            return false;
+        }
+
+        template <class T>
+        inline char* write_csv_integer(char* out, T value) noexcept
+        {
+            using unsigned_type = std::make_unsigned_t<T>;
+            unsigned_type u = static_cast<unsigned_type>(value);
+            if (is_csv_negative(value, std::is_signed<T>()))
+            {
+                *out++ = '-';
+                u = static_cast<unsigned_type>(unsigned_type(0) - u);
+            }
+            char digits[24];
+            char* p = digits + sizeof(digits);
+            do
+            {
+                *--p = static_cast<char>('0' + u % 10);
+                u = static_cast<unsigned_type>(u / 10);
+            } while (u != 0);
+            std::size_t length = static_cast<std::size_t>(digits + sizeof(digits) - p);
+            std::memcpy(out, p, length);
+            return out + length;
+        }
+
+        /*******************
+         * csv_cell_writer *
+         *******************/
+
+        // Appends the text of the cells to a buffer. Floats, doubles and
+        // integers larger than char are written without stream, other
+        // types with the formatting flags of the output stream.
+        template <class T, class = void>
+        class csv_cell_writer
+        {
+        public:
+
+            explicit csv_cell_writer(const std::ostream& stream)
+            {
+                m_stream.copyfmt(stream);
+                if (std::is_floating_point<T>::value)
+                {
+                    m_stream.precision(std::numeric_limits<T>::max_digits10);
+                }
+            }
+
+            template <class V>
+            void operator()(std::string& buffer, const V& value)
+            {
+                m_stream.str(std::string());
+                m_stream << value;
+                buffer += m_stream.str();
+            }
+
+        private:
+
+            std::ostringstream m_stream;
+        };
+
+        template <class T>
+        class csv_cell_writer<T, std::enable_if_t<std::is_same<T, float>::value || std::is_same<T, double>::value>>
+        {
+        public:
+
+            explicit csv_cell_writer(const std::ostream&) noexcept
+            {
+            }
+
+            void operator()(std::string& buffer, T value)
+            {
+                char cell[32];
+                buffer.append(cell, write_csv_float(cell, value));
+            }
+        };
+
+        template <class T>
+        class csv_cell_writer<T, std::enable_if_t<std::is_integral<T>::value && (sizeof(T) > 1) && !std::is_same<T, wchar_t>::value>>
+        {
+        public:
+
+            explicit csv_cell_writer(const std::ostream&) noexcept
+            {
+            }
+
+            void operator()(std::string& buffer, T value)
+            {
+                char cell[24];
+                buffer.append(cell, write_csv_integer(cell, value));
+            }
+        };
+
+        template <>
+        class csv_cell_writer<bool>
+        {
+        public:
+
+            explicit csv_cell_writer(const std::ostream& stream) noexcept
+                : m_alpha((stream.flags() & std::ios::boolalpha) != 0)
+            {
+            }
+
+            void operator()(std::string& buffer, bool value)
+            {
+                buffer += m_alpha ? (value ? "true" : "false") : (value ? "1" : "0");
+            }
+
+        private:
+
+            bool m_alpha;
+        };
+
+        /**************
+         * csv writer *
+         **************/
+
+        // Number of cells formatted by a task of dump_csv
+        constexpr std::size_t csv_block_size = std::size_t(1) << 16;
+
+        // Appends the rows [first_row, last_row) of a 2-D expression to buffer
+        template <class W, class E>
+        inline void format_csv_rows(W& writer, std::string& buffer, const E& ex,
+                                    std::size_t first_row, std::size_t last_row, std::false_type)
+        {
+            using size_type = typename E::size_type;
+            size_type nbcols = ex.shape()[1];
+            auto st = ex.stepper_begin(ex.shape());
+            st.step(0, first_row);
+            for (size_type r = first_row; r != last_row; ++r)
+            {
+                for (size_type c = 0; c != nbcols; ++c)
+                {
+                    writer(buffer, *st);
+                    if (c != nbcols - 1)
+                    {
+                        st.step(1);
+                        buffer += ',';
+                    }
+                    else
+                    {
+                        st.reset(1);
+                        st.step(0);
+                        buffer += '\n';
+                    }
+                }
+            }
+        }
+
+        // Row-major containers are read directly from their buffer
+        template <class W, class E>
+        inline void format_csv_rows(W& writer, std::string& buffer, const E& ex,
+                                    std::size_t first_row, std::size_t last_row, std::true_type)
+        {
+            if (ex.layout() != layout_type::row_major)
+            {
+                format_csv_rows(writer, buffer, ex, first_row, last_row, std::false_type());
+                return;
+            }
+            std::size_t nbcols = ex.shape()[1];
+            auto p = ex.raw_data() + ex.raw_data_offset() + first_row * nbcols;
+            for (std::size_t r = first_row; r != last_row; ++r)
+            {
+                for (std::size_t c = 0; c != nbcols; ++c, ++p)
+                {
+                    writer(buffer, *p);
+                    buffer += c != nbcols - 1 ? ',' : '\n';
+                }
+            }
+        }
+
+        // The rows are formatted by blocks in reusable buffers, in parallel
+        // when threads are enabled, and the buffers are written in order.
+        template <class E>
+        inline void write_csv(std::ostream& stream, const E& ex)
+        {
+            using value_type = typename E::value_type;
+            using direct = std::integral_constant<bool, E::contiguous_layout && has_raw_data_interface<E>::value>;
+
+            std::size_t nbrows = ex.shape()[0], nbcols = ex.shape()[1];
+            if (nbrows == 0 || nbcols == 0)
+            {
+                return;
+            }
+            std::size_t rows_per_block = std::max(csv_block_size / nbcols, std::size_t(1));
+            std::size_t nb_blocks = (nbrows + rows_per_block - 1) / rows_per_block;
+            std::vector<std::string> buffers(std::min(nb_blocks, 2 * parallel_concurrency()));
+            // random expressions are formatted on the calling thread, in order
+            std::size_t grain = is_splittable<E>::value ? std::size_t(1) : buffers.size() + 1;
+            for (std::size_t first_block = 0; first_block < nb_blocks; first_block += buffers.size())
+            {
+                std::size_t nb = std::min(buffers.size(), nb_blocks - first_block);
+                parallel_for(nb, grain, [&](std::size_t f, std::size_t l) {
+                    csv_cell_writer<value_type> writer(stream);
+                    for (std::size_t i = f; i != l; ++i)
+                    {
+                        std::size_t first_row = (first_block + i) * rows_per_block;
+                        std::size_t last_row = std::min(first_row + rows_per_block, nbrows);
+                        buffers[i].clear();
+                        format_csv_rows(writer, buffers[i], ex, first_row, last_row, direct());
+                    }
+                });
+                for (std::size_t i = 0; i != nb; ++i)
+                {
+                    stream.write(buffers[i].data(), static_cast<std::streamsize>(buffers[i].size()));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Dump tensor to CSV.
+     * 
+     * Floats and doubles are written with the shortest text that reads
+     * back to the same value, integers with their decimal digits, and
+     * other types with the formatting flags of \a stream. The rows are
+     * formatted by blocks in memory, in parallel when threads are enabled.
+     * @param stream the output stream to write the CSV encoded values
+     * @param e the tensor expression to serialize
+     */
+    template <class E>
+    void dump_csv(std::ostream& stream, const xexpression<E>& e)
+    {
+        const E& ex = e.derived_cast();
+        if (ex.dimension() != 2)
+        {
+            throw std::runtime_error("Only 2-D expressions can be serialized to CSV");
         }
+        detail::write_csv(stream, ex);
     }
 }
 
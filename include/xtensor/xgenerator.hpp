@@ -33,6 +33,23 @@ namespace xt
     template <class F, class R, class S>
     class xgenerator;
 
+    namespace detail
+    {
+        // Functors of generators may provide a method fill(out, first, n),
+        // which writes their elements of flat indices [first, first + n)
+        // in row-major order to the iterator out.
+        template <class F, class It, class = void_t<>>
+        struct has_generator_fill : std::false_type
+        {
+        };
+
+        template <class F, class It>
+        struct has_generator_fill<F, It, void_t<decltype(std::declval<const F&>().fill(std::declval<It>(), std::size_t(0), std::size_t(0)))>>
+            : std::true_type
+        {
+        };
+    }
+
     template <class C, class R, class S>
     struct xiterable_inner_types<xgenerator<C, R, S>>
     {
@@ -112,8 +129,16 @@ namespace xt
         template <class O>
         const_stepper stepper_end(const O& shape, layout_type) const noexcept;
 
+        template <class E>
+        bool assign_to(E& e) const;
+
     private:
 
+        template <class E>
+        bool assign_to(E& e, std::false_type) const;
+        template <class E>
+        bool assign_to(E& e, std::true_type) const;
+
         functor_type m_f;
         inner_shape_type m_shape;
     };
@@ -296,6 +321,51 @@ namespace xt
         return const_stepper(this, offset, true);
     }
 
+    /**
+     * Computes the whole generator into \c e, which must have the same
+     * shape, with the fill method of the functor if it provides one and
+     * \c e is a contiguous container whose elements are stored in
+     * row-major order.
+     * @return false if the generator has to be assigned element-wise
+     */
+    template <class F, class R, class S>
+    template <class E>
+    inline bool xgenerator<F, R, S>::assign_to(E& e) const
+    {
+        using pointer_type = decltype(e.raw_data());
+        return assign_to(e, std::integral_constant<bool, E::contiguous_layout && has_raw_data_interface<E>::value &&
+                                                             detail::has_generator_fill<functor_type, pointer_type>::value>());
+    }
+
+    template <class F, class R, class S>
+    template <class E>
+    inline bool xgenerator<F, R, S>::assign_to(E&, std::false_type) const
+    {
+        return false;
+    }
+
+    template <class F, class R, class S>
+    template <class E>
+    inline bool xgenerator<F, R, S>::assign_to(E& e, std::true_type) const
+    {
+        if (e.dimension() != dimension() || !std::equal(m_shape.cbegin(), m_shape.cend(), e.shape().cbegin()) ||
+            (e.layout() != layout_type::row_major && dimension() > 1))
+        {
+            return false;
+        }
+        m_f.fill(e.raw_data() + e.raw_data_offset(), size_type(0), size());
+        return true;
+    }
+
+    namespace detail
+    {
+        template <class E1, class F, class R, class S>
+        inline bool assign_generator(E1& e1, const xgenerator<F, R, S>& e2)
+        {
+            return e2.assign_to(e1);
+        }
+    }
+
     namespace detail
     {
 #ifdef X_OLD_CLANG
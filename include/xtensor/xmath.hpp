@@ -596,7 +596,23 @@ INT_SPECIALIZATION_IMPL(FUNC_NAME, RETURN_VAL, unsigned long long);
                 return xsimd::select(t1 > t2, t1, t2);
             }
         };
+    }
+
+    namespace detail
+    {
+        template <class T>
+        struct is_associative<math::minimum<T>> : std::true_type
+        {
+        };
+
+        template <class T>
+        struct is_associative<math::maximum<T>> : std::true_type
+        {
+        };
+    }
 
+    namespace math
+    {
         template <class T>
         struct clamp_fun
         {
@@ -1536,22 +1552,89 @@ INT_SPECIALIZATION_IMPL(FUNC_NAME, RETURN_VAL, unsigned long long);
      * @defgroup  red_functions reducing functions
      */
 
+    namespace detail
+    {
+        // Reduce functor of sum: the values reduced along an axis are
+        // accumulated with the summation policy P.
+        template <class T, class P = summation::pairwise>
+        struct summation_plus : plus<T>
+        {
+            using summation_policy = P;
+        };
+
+        template <class T, class P>
+        struct is_associative<summation_plus<T, P>> : std::true_type
+        {
+        };
+    }
+
     /**
      * @ingroup red_functions
      * @brief Sum of elements over given axes.
      *
      * Returns an \ref xreducer for the sum of elements over given
-     * \em axes.
+     * \em axes. Floating point values are summed pairwise.
+     * @param e an \ref xexpression
+     * @param axes the axes along which the sum is performed (optional)
+     * @param es evaluation strategy of the reducer
+     * @return an \ref xreducer
+     */
+    REDUCER_FUNCTION(sum, detail::summation_plus, big_promote_type_t<typename std::decay_t<E>::value_type>);
+#ifdef X_OLD_CLANG
+    OLD_CLANG_REDUCER(sum, detail::summation_plus, big_promote_type_t<typename std::decay_t<E>::value_type>);
+#else
+    MODERN_CLANG_REDUCER(sum, detail::summation_plus, big_promote_type_t<typename std::decay_t<E>::value_type>);
+#endif
+
+    /**
+     * @ingroup red_functions
+     * @brief Sum of elements over given axes, with a given summation policy.
+     *
+     * Returns an \ref xreducer for the sum of elements over given
+     * \em axes, accumulated with the summation policy \em P.
+     * @tparam P the summation policy: summation::naive, summation::pairwise
+     *           or summation::kahan
      * @param e an \ref xexpression
      * @param axes the axes along which the sum is performed (optional)
      * @param es evaluation strategy of the reducer
      * @return an \ref xreducer
      */
-    REDUCER_FUNCTION(sum, std::plus, big_promote_type_t<typename std::decay_t<E>::value_type>);
+    template <class P, class E, class X, class ES = DEFAULT_STRATEGY_REDUCERS,
+              class = std::enable_if_t<std::is_base_of<summation::base, P>::value &&
+                                       !std::is_base_of<evaluation_strategy::base, std::decay_t<X>>::value, int>>
+    inline auto sum(E&& e, X&& axes, ES es = ES()) noexcept
+    {
+        using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
+        using functor_type = detail::summation_plus<result_type, P>;
+        return reduce(make_xreducer_functor(functor_type()), std::forward<E>(e), std::forward<X>(axes), es);
+    }
+
+    template <class P, class E, class ES = DEFAULT_STRATEGY_REDUCERS,
+              class = std::enable_if_t<std::is_base_of<summation::base, P>::value &&
+                                       std::is_base_of<evaluation_strategy::base, ES>::value, int>>
+    inline auto sum(E&& e, ES es = ES()) noexcept
+    {
+        using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
+        using functor_type = detail::summation_plus<result_type, P>;
+        return reduce(make_xreducer_functor(functor_type()), std::forward<E>(e), es);
+    }
+
 #ifdef X_OLD_CLANG
-    OLD_CLANG_REDUCER(sum, std::plus, big_promote_type_t<typename std::decay_t<E>::value_type>);
+    template <class P, class E, class I, class ES = DEFAULT_STRATEGY_REDUCERS>
+    inline auto sum(E&& e, std::initializer_list<I> axes, ES es = ES()) noexcept
+    {
+        using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
+        using functor_type = detail::summation_plus<result_type, P>;
+        return reduce(make_xreducer_functor(functor_type()), std::forward<E>(e), axes);
+    }
 #else
-    MODERN_CLANG_REDUCER(sum, std::plus, big_promote_type_t<typename std::decay_t<E>::value_type>);
+    template <class P, class E, class I, std::size_t N, class ES = DEFAULT_STRATEGY_REDUCERS>
+    inline auto sum(E&& e, const I (&axes)[N], ES es = ES()) noexcept
+    {
+        using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
+        using functor_type = detail::summation_plus<result_type, P>;
+        return reduce(make_xreducer_functor(functor_type()), std::forward<E>(e), axes, es);
+    }
 #endif
 
     /**
@@ -1565,11 +1648,11 @@ INT_SPECIALIZATION_IMPL(FUNC_NAME, RETURN_VAL, unsigned long long);
      * @param es evaluation strategy of the reducer
      * @return an \ref xreducer
      */
-    REDUCER_FUNCTION(prod, std::multiplies, big_promote_type_t<typename std::decay_t<E>::value_type>);
+    REDUCER_FUNCTION(prod, detail::multiplies, big_promote_type_t<typename std::decay_t<E>::value_type>);
 #ifdef X_OLD_CLANG
-    OLD_CLANG_REDUCER(prod, std::multiplies, big_promote_type_t<typename std::decay_t<E>::value_type>);
+    OLD_CLANG_REDUCER(prod, detail::multiplies, big_promote_type_t<typename std::decay_t<E>::value_type>);
 #else
-    MODERN_CLANG_REDUCER(prod, std::multiplies, big_promote_type_t<typename std::decay_t<E>::value_type>);
+    MODERN_CLANG_REDUCER(prod, detail::multiplies, big_promote_type_t<typename std::decay_t<E>::value_type>);
 #endif
 
     /**
@@ -1615,6 +1698,53 @@ INT_SPECIALIZATION_IMPL(FUNC_NAME, RETURN_VAL, unsigned long long);
     }
 #endif
 
+    /**
+     * @ingroup red_functions
+     * @brief Mean of elements over given axes, with a given summation policy.
+     *
+     * Returns an \ref xreducer for the mean of elements over given
+     * \em axes, whose sum is accumulated with the summation policy \em P.
+     * @tparam P the summation policy: summation::naive, summation::pairwise
+     *           or summation::kahan
+     * @param e an \ref xexpression
+     * @param axes the axes along which the mean is computed (optional)
+     * @return an \ref xexpression
+     */
+    template <class P, class E, class X,
+              class = std::enable_if_t<std::is_base_of<summation::base, P>::value, int>>
+    inline auto mean(E&& e, X&& axes) noexcept
+    {
+        auto size = e.size();
+        auto s = sum<P>(std::forward<E>(e), std::forward<X>(axes));
+        return std::move(s) / static_cast<double>(size / s.size());
+    }
+
+    template <class P, class E,
+              class = std::enable_if_t<std::is_base_of<summation::base, P>::value, int>>
+    inline auto mean(E&& e) noexcept
+    {
+        auto size = e.size();
+        return sum<P>(std::forward<E>(e)) / static_cast<double>(size);
+    }
+
+#ifdef X_OLD_CLANG
+    template <class P, class E, class I>
+    inline auto mean(E&& e, std::initializer_list<I> axes) noexcept
+    {
+        auto size = e.size();
+        auto s = sum<P>(std::forward<E>(e), axes);
+        return std::move(s) / static_cast<double>(size / s.size());
+    }
+#else
+    template <class P, class E, class I, std::size_t N>
+    inline auto mean(E&& e, const I (&axes)[N]) noexcept
+    {
+        auto size = e.size();
+        auto s = sum<P>(std::forward<E>(e), axes);
+        return std::move(s) / static_cast<double>(size / s.size());
+    }
+#endif
+
     /**
      * @defgroup acc_functions accumulating functions
      */
@@ -1627,20 +1757,22 @@ INT_SPECIALIZATION_IMPL(FUNC_NAME, RETURN_VAL, unsigned long long);
      * \em axis (or flattened).
      * @param e an \ref xexpression
      * @param axis the axes along which the cumulative sum is computed (optional)
-     * @return an \ref xarray<T>
+     * @param es evaluation strategy of the accumulation
+     * @return a container, or an \ref xaccumulator with the lazy evaluation strategy
      */
-    template <class E>
-    inline auto cumsum(E&& e, std::size_t axis) noexcept
+    template <class E, class ES = DEFAULT_STRATEGY_ACCUMULATORS>
+    inline auto cumsum(E&& e, std::size_t axis, ES es = ES())
     {
         using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
-        return accumulate(std::plus<result_type>(), std::forward<E>(e), axis);
+        return accumulate(detail::plus<result_type>(), std::forward<E>(e), axis, es);
     }
 
-    template <class E>
-    inline auto cumsum(E&& e) noexcept
+    template <class E, class ES = DEFAULT_STRATEGY_ACCUMULATORS,
+              typename std::enable_if_t<!std::is_integral<ES>::value, int> = 0>
+    inline auto cumsum(E&& e, ES es = ES())
     {
         using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
-        return accumulate(std::plus<result_type>(), std::forward<E>(e));
+        return accumulate(detail::plus<result_type>(), std::forward<E>(e), es);
     }
 
     /**
@@ -1651,20 +1783,22 @@ INT_SPECIALIZATION_IMPL(FUNC_NAME, RETURN_VAL, unsigned long long);
      * \em axis (or flattened).
      * @param e an \ref xexpression
      * @param axis the axes along which the cumulative product is computed (optional)
-     * @return an \ref xarray<T>
+     * @param es evaluation strategy of the accumulation
+     * @return a container, or an \ref xaccumulator with the lazy evaluation strategy
      */
-    template <class E>
-    inline auto cumprod(E&& e, std::size_t axis) noexcept
+    template <class E, class ES = DEFAULT_STRATEGY_ACCUMULATORS>
+    inline auto cumprod(E&& e, std::size_t axis, ES es = ES())
     {
         using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
-        return accumulate(std::multiplies<result_type>(), std::forward<E>(e), axis);
+        return accumulate(detail::multiplies<result_type>(), std::forward<E>(e), axis, es);
     }
 
-    template <class E>
-    inline auto cumprod(E&& e) noexcept
+    template <class E, class ES = DEFAULT_STRATEGY_ACCUMULATORS,
+              typename std::enable_if_t<!std::is_integral<ES>::value, int> = 0>
+    inline auto cumprod(E&& e, ES es = ES())
     {
         using result_type = big_promote_type_t<typename std::decay_t<E>::value_type>;
-        return accumulate(std::multiplies<result_type>(), std::forward<E>(e));
+        return accumulate(detail::multiplies<result_type>(), std::forward<E>(e), es);
     }
 }
 
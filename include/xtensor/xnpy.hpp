@@ -13,22 +13,43 @@
 #include "xtensor/xadapt.hpp"
 #include "xtensor/xarray.hpp"
 #include "xtensor/xeval.hpp"
+#include "xtensor/xnoalias.hpp"
+#include "xtensor/xstrided_view.hpp"
 #include "xtensor/xstrides.hpp"
+#include "xtensor/xview.hpp"
 
 #include "xtl/xsequence.hpp"
 
 #include <algorithm>
+#include <array>
 #include <complex>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <regex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <typeinfo>
+#include <utility>
 #include <vector>
 
+#ifdef XTENSOR_USE_THREADS
+#include <future>
+#endif
+
+#if defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#define XTENSOR_NPY_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace xt
 {
     using namespace std::string_literals;
@@ -57,6 +78,14 @@ namespace xt
 
         constexpr char host_endian_char = (big_endian ? big_endian_char : little_endian_char);
 
+        // default size in bytes of the chunks of expressions dumped to npy files,
+        // and maximal size of the coalesced reads of partial loads
+        constexpr std::size_t npy_chunk_size = std::size_t(1) << 24;
+
+        // maximal gap in bytes between two runs of a partial load that are
+        // read at once
+        constexpr std::size_t npy_read_gap = std::size_t(1) << 16;
+
         template <class O>
         inline void write_magic(O& ostream,
                                 unsigned char v_major = 1,
@@ -342,9 +371,12 @@ namespace xt
             }
         }
 
+        // Writes the header of a npy file; reserved spaces are added to its
+        // padding, so that a longer header can be written in place later.
         template <class O, class S>
         inline void write_header(O& out, const std::string& descr,
-                                 bool fortran_order, const S& shape)
+                                 bool fortran_order, const S& shape,
+                                 std::size_t reserved = 0)
         {
             std::ostringstream ss_header;
             std::string s_fortran_order;
@@ -379,7 +411,7 @@ namespace xt
                       << "', 'fortran_order': " << s_fortran_order
                       << ", 'shape': " << s_shape << ", }";
 
-            std::size_t header_len_pre = ss_header.str().length() + 1;
+            std::size_t header_len_pre = ss_header.str().length() + 1 + reserved;
             std::size_t metadata_len = magic_string_length + 2 + 2 + header_len_pre;
 
             unsigned char version[2] = {1, 0};
@@ -390,7 +422,7 @@ namespace xt
                 version[1] = 0;
             }
             std::size_t padding_len = 16 - metadata_len % 16;
-            std::string padding(padding_len, ' ');
+            std::string padding(padding_len + reserved, ' ');
             ss_header << padding;
             ss_header << std::endl;
 
@@ -467,6 +499,32 @@ namespace xt
             return header;
         }
 
+        template <class T, layout_type L>
+        inline void check_npy_cast(const std::string& typestring, bool fortran_order, bool check_type)
+        {
+            // check if the typestring matches the given one
+            if (check_type && typestring != detail::build_typestring<T>())
+            {
+                throw std::runtime_error("Cast error: formats not matching "s + typestring +
+                                         " vs "s + detail::build_typestring<T>());
+            }
+
+            if ((L == layout_type::column_major && !fortran_order) ||
+                (L == layout_type::row_major && fortran_order))
+            {
+                throw std::runtime_error("Cast error: layout mismatch between npy file and requested layout.");
+            }
+        }
+
+        inline std::vector<std::size_t> npy_strides(const std::vector<std::size_t>& shape, bool fortran_order)
+        {
+            std::vector<std::size_t> strides(shape.size());
+            compute_strides(shape,
+                            fortran_order ? layout_type::column_major : layout_type::row_major,
+                            strides);
+            return strides;
+        }
+
         struct npy_file
         {
             npy_file() = default;
@@ -528,25 +586,9 @@ namespace xt
                     throw std::runtime_error("This npy_file has already been cast.");
                 }
                 T* ptr = reinterpret_cast<T*>(&m_buffer[0]);
-                std::vector<std::size_t> strides(m_shape.size());
                 std::size_t sz = compute_size(m_shape);
-
-                // check if the typestring matches the given one
-                if (check_type && m_typestring != detail::build_typestring<T>())
-                {
-                    throw std::runtime_error("Cast error: formats not matching "s + m_typestring +
-                                             " vs "s + detail::build_typestring<T>());
-                }
-
-                if ((L == layout_type::column_major && !m_fortran_order) ||
-                    (L == layout_type::row_major && m_fortran_order))
-                {
-                    throw std::runtime_error("Cast error: layout mismatch between npy file and requested layout.");
-                }
-
-                compute_strides(m_shape,
-                                m_fortran_order ? layout_type::column_major : layout_type::row_major,
-                                strides);
+                check_npy_cast<T, L>(m_typestring, m_fortran_order, check_type);
+                std::vector<std::size_t> strides = npy_strides(m_shape, m_fortran_order);
                 std::vector<std::size_t> shape(m_shape);
 
                 return std::make_tuple(ptr, sz, std::move(shape), std::move(strides));
@@ -595,7 +637,10 @@ namespace xt
             char* m_buffer;
         };
 
-        npy_file load_npy_file(std::istream& stream)
+        // Reads the magic string and the header of a npy stream, leaving the
+        // stream positioned at the beginning of the data.
+        inline void read_npy_header(std::istream& stream, std::string& typestring,
+                                    bool* fortran_order, std::vector<std::size_t>& shape)
         {
             // check magic bytes an version number
             unsigned char v_major, v_minor;
@@ -617,11 +662,15 @@ namespace xt
             }
 
             // parse header
+            detail::parse_header(header, typestring, fortran_order, shape);
+        }
+
+        npy_file load_npy_file(std::istream& stream)
+        {
             bool fortran_order;
             std::string typestr;
-
             std::vector<std::size_t> shape;
-            detail::parse_header(header, typestr, &fortran_order, shape);
+            detail::read_npy_header(stream, typestr, &fortran_order, shape);
 
             npy_file result(shape, fortran_order, typestr);
             // read the data
@@ -629,68 +678,1838 @@ namespace xt
             return result;
         }
 
-        template <class O, class E>
-        void dump_npy_stream(O& stream, const xexpression<E>& e)
+        /**************************
+         * conversion of npy data *
+         **************************/
+
+        // size in bytes of the chunks of npy data converted at once
+        constexpr std::size_t npy_convert_chunk_size = std::size_t(1) << 16;
+
+        template <std::size_t N>
+        struct npy_word;
+
+        template <>
+        struct npy_word<1>
         {
-            using value_type = typename E::value_type;
-            const E& ex = e.derived_cast();
-            auto&& eval_ex = eval(ex);
-            bool fortran_order = false;
-            if (eval_ex.layout() == layout_type::column_major && eval_ex.dimension() > 1)
+            using type = std::uint8_t;
+        };
+
+        template <>
+        struct npy_word<2>
+        {
+            using type = std::uint16_t;
+        };
+
+        template <>
+        struct npy_word<4>
+        {
+            using type = std::uint32_t;
+        };
+
+        template <>
+        struct npy_word<8>
+        {
+            using type = std::uint64_t;
+        };
+
+        // Byte order applies to the real and imaginary parts of complex numbers
+        template <class S>
+        struct npy_component
+        {
+            using type = S;
+        };
+
+        template <class S>
+        struct npy_component<std::complex<S>>
+        {
+            using type = S;
+        };
+
+        inline std::uint8_t byte_swap(std::uint8_t w) noexcept
+        {
+            return w;
+        }
+
+        inline std::uint16_t byte_swap(std::uint16_t w) noexcept
+        {
+            return static_cast<std::uint16_t>((w >> 8) | (w << 8));
+        }
+
+        inline std::uint32_t byte_swap(std::uint32_t w) noexcept
+        {
+            return ((w & 0xff) << 24) | ((w & 0xff00) << 8) | ((w >> 8) & 0xff00) | (w >> 24);
+        }
+
+        inline std::uint64_t byte_swap(std::uint64_t w) noexcept
+        {
+            return (std::uint64_t(byte_swap(static_cast<std::uint32_t>(w))) << 32) |
+                   byte_swap(static_cast<std::uint32_t>(w >> 32));
+        }
+
+        // The kernels below are branch-free loops on contiguous buffers that
+        // the compiler vectorizes; they run on chunks that fit in the cache.
+        template <class W>
+        inline void swap_bytes(char* data, std::size_t size) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                W w;
+                std::memcpy(&w, data + i * sizeof(W), sizeof(W));
+                w = byte_swap(w);
+                std::memcpy(data + i * sizeof(W), &w, sizeof(W));
+            }
+        }
+
+        // Conversion of an element, without implicit conversions of the parts
+        // of complex numbers
+        template <class T>
+        struct npy_caster
+        {
+            template <class S>
+            static T run(const S& s) noexcept
             {
-                fortran_order = true;
+                return static_cast<T>(s);
             }
+        };
 
-            std::string typestring = detail::build_typestring<value_type>();
+        template <class C>
+        struct npy_caster<std::complex<C>>
+        {
+            template <class S>
+            static std::complex<C> run(const S& s) noexcept
+            {
+                return std::complex<C>(static_cast<C>(s));
+            }
 
-            auto shape = eval_ex.shape();
-            detail::write_header(stream, typestring, fortran_order, shape);
+            template <class D>
+            static std::complex<C> run(const std::complex<D>& s) noexcept
+            {
+                return std::complex<C>(static_cast<C>(s.real()), static_cast<C>(s.imag()));
+            }
+        };
 
-            std::size_t size = compute_size(shape);
-            stream.write(reinterpret_cast<const char*>(eval_ex.raw_data()),
-                         (std::streamsize)(sizeof(value_type) * size));
+        template <class S, class T>
+        inline void convert_npy_chunk(const char* src, T* dst, std::size_t size, std::false_type) noexcept
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                S s;
+                std::memcpy(&s, src + i * sizeof(S), sizeof(S));
+                dst[i] = npy_caster<T>::run(s);
+            }
         }
-    }  // namespace detail
 
+        template <class S, class T>
+        inline void convert_npy_chunk(const char*, T*, std::size_t, std::true_type) noexcept
+        {
+        }
 
-    /**
-     * Save xexpression to NumPy npy format
-     *
-     * @param filename The filename or path to dump the data
-     * @param e the xexpression
-     */
-    template <typename E>
-    void dump_npy(const std::string& filename, const xexpression<E>& e)
-    {
-        std::ofstream stream(filename, std::ofstream::binary);
-        if (!stream)
+        // Reads size elements of type S and converts them to T, by chunks:
+        // each chunk is read, byte-swapped and converted while it is in the
+        // cache. Elements of type T are read directly in dest.
+        template <class S, class T>
+        inline void read_npy_as(std::istream& stream, bool swap, T* dest, std::size_t size, std::true_type)
         {
-            throw std::runtime_error("IO Error: failed to open file: "s + filename);
+            using same_type = std::is_same<S, T>;
+            using word_type = typename npy_word<sizeof(typename npy_component<S>::type)>::type;
+            constexpr std::size_t chunk_size = npy_convert_chunk_size / sizeof(S);
+            std::vector<char> buffer(same_type::value ? 0 : chunk_size * sizeof(S));
+            for (std::size_t first = 0; first < size; first += chunk_size)
+            {
+                std::size_t n = std::min(chunk_size, size - first);
+                char* bytes = same_type::value ? reinterpret_cast<char*>(dest + first) : buffer.data();
+                stream.read(bytes, static_cast<std::streamsize>(n * sizeof(S)));
+                if (swap)
+                {
+                    swap_bytes<word_type>(bytes, n * sizeof(S) / sizeof(word_type));
+                }
+                convert_npy_chunk<S>(bytes, dest + first, n, same_type());
+            }
         }
 
-        detail::dump_npy_stream(stream, e);
-    }
+        template <class S, class T>
+        inline void read_npy_as(std::istream&, bool, T*, std::size_t, std::false_type)
+        {
+            throw std::runtime_error("Cast error: cannot convert npy data of type "s + build_typestring<S>() +
+                                     " to "s + build_typestring<T>());
+        }
 
-    /**
-     * Loads a npy file (the numpy storage format)
-     *
-     * @param filename The filename or path to the file
-     * @tparam T select the type of the npy file (note: currently there is
-     *           no dynamic casting if types do not match)
-     * @tparam L select layout_type::column_major if you stored data in
-     *           Fortran format
-     * @return xarray with contents from npy file
-     */
-    template <typename T, layout_type L = layout_type::dynamic>
-    auto load_npy(const std::string& filename)
-    {
-        std::ifstream stream(filename, std::ifstream::binary);
-        if (!stream)
+        template <class S, class T>
+        inline void read_npy_as(std::istream& stream, bool swap, T* dest, std::size_t size)
         {
-            throw std::runtime_error("io error: failed to open a file.");
+            read_npy_as<S>(stream, swap, dest, size, std::is_constructible<T, S>());
         }
-        detail::npy_file file = detail::load_npy_file(stream);
-        return std::move(file).cast<T, L>();
+
+        // Reads npy data stored with the given typestring in a buffer of T,
+        // converting the byte order and the type of the elements.
+        template <class T>
+        inline void read_npy_converted(std::istream& stream, const std::string& typestring, T* dest, std::size_t size)
+        {
+            bool swap = typestring[0] != no_endian_char && typestring[0] != host_endian_char;
+            std::string type = typestring.substr(1);
+            if (type == "b1")
+            {
+                read_npy_as<bool>(stream, swap, dest, size);
+            }
+            else if (type == "i1")
+            {
+                read_npy_as<std::int8_t>(stream, swap, dest, size);
+            }
+            else if (type == "i2")
+            {
+                read_npy_as<std::int16_t>(stream, swap, dest, size);
+            }
+            else if (type == "i4")
+            {
+                read_npy_as<std::int32_t>(stream, swap, dest, size);
+            }
+            else if (type == "i8")
+            {
+                read_npy_as<std::int64_t>(stream, swap, dest, size);
+            }
+            else if (type == "u1")
+            {
+                read_npy_as<std::uint8_t>(stream, swap, dest, size);
+            }
+            else if (type == "u2")
+            {
+                read_npy_as<std::uint16_t>(stream, swap, dest, size);
+            }
+            else if (type == "u4")
+            {
+                read_npy_as<std::uint32_t>(stream, swap, dest, size);
+            }
+            else if (type == "u8")
+            {
+                read_npy_as<std::uint64_t>(stream, swap, dest, size);
+            }
+            else if (type == "f4")
+            {
+                read_npy_as<float>(stream, swap, dest, size);
+            }
+            else if (type == "f8")
+            {
+                read_npy_as<double>(stream, swap, dest, size);
+            }
+            else if (type == "c8")
+            {
+                read_npy_as<std::complex<float>>(stream, swap, dest, size);
+            }
+            else if (type == "c16")
+            {
+                read_npy_as<std::complex<double>>(stream, swap, dest, size);
+            }
+            else
+            {
+                throw std::runtime_error("Cast error: formats not matching "s + typestring +
+                                         " vs "s + build_typestring<T>());
+            }
+        }
+
+        // Reads a npy stream in a npy_file of T; the data is converted on the
+        // fly if the file stores another type or byte order.
+        template <class T>
+        inline npy_file load_npy_file_as(std::istream& stream)
+        {
+            bool fortran_order;
+            std::string typestring;
+            std::vector<std::size_t> shape;
+            detail::read_npy_header(stream, typestring, &fortran_order, shape);
+
+            std::string target = detail::build_typestring<T>();
+            npy_file result(shape, fortran_order, target);
+            if (typestring == target)
+            {
+                stream.read(result.ptr(), (std::streamsize)(result.n_bytes()));
+            }
+            else
+            {
+                read_npy_converted(stream, typestring, reinterpret_cast<T*>(result.ptr()), compute_size(shape));
+            }
+            return result;
+        }
+
+        // Selection of a partial load along an axis of the file.
+        struct npy_axis_selection
+        {
+            std::size_t start;
+            std::size_t count;
+            std::ptrdiff_t step;
+        };
+
+        // Reads runs of bytes of a stream into consecutive locations of a
+        // buffer. Runs separated by at most npy_read_gap bytes are read at
+        // once, up to npy_chunk_size bytes.
+        class npy_run_reader
+        {
+        public:
+
+            npy_run_reader(std::istream& stream, char* dest)
+                : m_stream(stream), p_dest(dest), m_begin(0), m_end(0)
+            {
+            }
+
+            void add(std::size_t offset, std::size_t length)
+            {
+                if (!m_runs.empty())
+                {
+                    if (offset == m_end)
+                    {
+                        m_runs.back().second += length;
+                        m_end += length;
+                        return;
+                    }
+                    if (offset < m_end || offset - m_end > npy_read_gap || offset + length - m_begin > npy_chunk_size)
+                    {
+                        flush();
+                    }
+                }
+                if (m_runs.empty())
+                {
+                    m_begin = offset;
+                }
+                m_runs.emplace_back(offset, length);
+                m_end = offset + length;
+            }
+
+            void flush()
+            {
+                if (m_runs.size() == 1)
+                {
+                    read(m_begin, p_dest, m_runs.front().second);
+                    p_dest += m_runs.front().second;
+                }
+                else if (!m_runs.empty())
+                {
+                    m_buffer.resize(m_end - m_begin);
+                    read(m_begin, m_buffer.data(), m_buffer.size());
+                    for (const auto& run : m_runs)
+                    {
+                        p_dest = std::copy_n(m_buffer.data() + (run.first - m_begin), run.second, p_dest);
+                    }
+                }
+                m_runs.clear();
+            }
+
+        private:
+
+            void read(std::size_t offset, char* dest, std::size_t length)
+            {
+                m_stream.seekg(static_cast<std::streamoff>(offset));
+                m_stream.read(dest, static_cast<std::streamsize>(length));
+                if (!m_stream)
+                {
+                    throw std::runtime_error("io error: failed reading file");
+                }
+            }
+
+            std::istream& m_stream;
+            char* p_dest;
+            std::vector<std::pair<std::size_t, std::size_t>> m_runs;
+            std::size_t m_begin;
+            std::size_t m_end;
+            std::vector<char> m_buffer;
+        };
+
+        // Reads the selected elements of the data starting at offset in
+        // the stream into dest, in the storage order of the file. The
+        // selections are given from the slowest to the fastest varying
+        // axis in the file.
+        inline void read_npy_selection(std::istream& stream, std::size_t offset, std::size_t word_size,
+                                       const std::vector<std::size_t>& shape,
+                                       const std::vector<npy_axis_selection>& selection, char* dest)
+        {
+            std::size_t dim = shape.size();
+            std::vector<std::size_t> strides(dim);
+            std::size_t stride = word_size;
+            for (std::size_t d = dim; d != 0; --d)
+            {
+                strides[d - 1] = stride;
+                stride *= shape[d - 1];
+            }
+
+            // the fastest axes that are entirely selected, and the next one
+            // if its elements are consecutive, form contiguous runs
+            std::size_t run_length = word_size;
+            std::size_t nb_outer = dim;
+            while (nb_outer != 0)
+            {
+                const npy_axis_selection& sel = selection[nb_outer - 1];
+                bool consecutive = sel.step == 1 || sel.count == 1;
+                if (!consecutive)
+                {
+                    break;
+                }
+                run_length *= sel.count;
+                --nb_outer;
+                if (sel.start != 0 || sel.count != shape[nb_outer])
+                {
+                    break;
+                }
+            }
+            std::size_t run_offset = offset;
+            if (nb_outer != dim)
+            {
+                run_offset += selection[nb_outer].start * strides[nb_outer];
+            }
+
+            npy_run_reader reader(stream, dest);
+            std::vector<std::size_t> index(nb_outer, 0);
+            for (;;)
+            {
+                std::size_t run = run_offset;
+                for (std::size_t d = 0; d != nb_outer; ++d)
+                {
+                    std::ptrdiff_t i = static_cast<std::ptrdiff_t>(selection[d].start) + static_cast<std::ptrdiff_t>(index[d]) * selection[d].step;
+                    run += static_cast<std::size_t>(i) * strides[d];
+                }
+                reader.add(run, run_length);
+
+                std::size_t d = nb_outer;
+                for (; d != 0; --d)
+                {
+                    if (++index[d - 1] != selection[d - 1].count)
+                    {
+                        break;
+                    }
+                    index[d - 1] = 0;
+                }
+                if (d == 0)
+                {
+                    break;
+                }
+            }
+            reader.flush();
+        }
+
+        template <class O, class E>
+        inline void write_npy_data(O& stream, const E& e)
+        {
+            stream.write(reinterpret_cast<const char*>(e.raw_data() + e.raw_data_offset()),
+                         (std::streamsize)(sizeof(typename E::value_type) * e.size()));
+        }
+
+        // Row-major or column-major containers are written directly.
+        template <class O, class E>
+        inline bool dump_npy_data(O& stream, const E& ex, std::size_t, std::true_type)
+        {
+            bool row_major = ex.layout() == layout_type::row_major;
+            if (!row_major && ex.layout() != layout_type::column_major)
+            {
+                return false;
+            }
+            bool fortran_order = !row_major && ex.dimension() > 1;
+            detail::write_header(stream, detail::build_typestring<typename E::value_type>(), fortran_order, ex.shape());
+            write_npy_data(stream, ex);
+            return true;
+        }
+
+        // Writes the elements of an expression converted to T in row-major
+        // order, by chunks of whole slices along the first axis holding at
+        // most chunk_size bytes (or a single slice). When XTENSOR_USE_THREADS
+        // is defined, a chunk is written while the next one is evaluated.
+        template <class T, class O, class E>
+        inline void write_npy_chunks(O& stream, const E& ex, std::size_t chunk_size)
+        {
+            using buffer_type = xarray<T, layout_type::row_major>;
+
+            std::vector<std::size_t> shape(ex.shape().cbegin(), ex.shape().cend());
+            std::size_t size = compute_size(shape);
+            if (shape.empty())
+            {
+                buffer_type buffer = ex;
+                write_npy_data(stream, buffer);
+                return;
+            }
+            if (size == 0)
+            {
+                return;
+            }
+
+            std::size_t nb_slices = shape[0];
+            std::size_t slice_bytes = sizeof(T) * (size / nb_slices);
+            std::size_t chunk_slices = std::max(chunk_size / slice_bytes, std::size_t(1));
+            auto evaluate = [&ex, &shape, nb_slices, chunk_slices](buffer_type& buffer, std::size_t first) {
+                std::size_t last = std::min(first + chunk_slices, nb_slices);
+                shape[0] = last - first;
+                buffer.reshape(shape);
+                noalias(buffer) = view(ex, xrange<std::size_t>(first, last));
+            };
+
+#ifdef XTENSOR_USE_THREADS
+            std::array<buffer_type, 2> buffers;
+            std::future<void> writing;
+            std::size_t current = 0;
+            for (std::size_t first = 0; first < nb_slices; first += chunk_slices, current = 1 - current)
+            {
+                evaluate(buffers[current], first);
+                if (writing.valid())
+                {
+                    writing.get();
+                }
+                const buffer_type& buffer = buffers[current];
+                writing = std::async(std::launch::async, [&stream, &buffer]() { write_npy_data(stream, buffer); });
+            }
+            if (writing.valid())
+            {
+                writing.get();
+            }
+#else
+            buffer_type buffer;
+            for (std::size_t first = 0; first < nb_slices; first += chunk_slices)
+            {
+                evaluate(buffer, first);
+                write_npy_data(stream, buffer);
+            }
+#endif
+        }
+
+        template <class T, class O, class E>
+        inline void write_npy_row_major(O& stream, const E& ex, std::size_t chunk_size, std::false_type)
+        {
+            write_npy_chunks<T>(stream, ex, chunk_size);
+        }
+
+        template <class T, class O, class E>
+        inline void write_npy_row_major(O& stream, const E& ex, std::size_t chunk_size, std::true_type)
+        {
+            if (ex.layout() == layout_type::row_major ||
+                (ex.layout() == layout_type::column_major && ex.dimension() < 2))
+            {
+                write_npy_data(stream, ex);
+            }
+            else
+            {
+                write_npy_chunks<T>(stream, ex, chunk_size);
+            }
+        }
+
+        // Writes the elements of an expression converted to T in row-major
+        // order, directly from the buffer of row-major containers of T.
+        template <class T, class O, class E>
+        inline void write_npy_row_major(O& stream, const E& ex, std::size_t chunk_size)
+        {
+            using direct = std::integral_constant<bool, std::is_same<typename E::value_type, T>::value &&
+                                                            E::contiguous_layout && has_raw_data_interface<E>::value>;
+            write_npy_row_major<T>(stream, ex, chunk_size, direct());
+        }
+
+        // Other expressions are written in row-major order.
+        template <class O, class E>
+        inline bool dump_npy_data(O& stream, const E& ex, std::size_t chunk_size, std::false_type)
+        {
+            using value_type = typename E::value_type;
+            detail::write_header(stream, detail::build_typestring<value_type>(), false, ex.shape());
+            write_npy_chunks<value_type>(stream, ex, chunk_size);
+            return true;
+        }
+
+        template <class O, class E>
+        void dump_npy_stream(O& stream, const xexpression<E>& e, std::size_t chunk_size = npy_chunk_size)
+        {
+            const E& ex = e.derived_cast();
+            using direct = std::integral_constant<bool, E::contiguous_layout && has_raw_data_interface<E>::value>;
+            if (!dump_npy_data(stream, ex, chunk_size, direct()))
+            {
+                dump_npy_data(stream, ex, chunk_size, std::false_type());
+            }
+        }
+    }  // namespace detail
+
+#ifdef XTENSOR_NPY_MMAP
+
+    /*! mmap_mode enum for the memory mapping of npy files */
+    enum class mmap_mode
+    {
+        /*! read-only mapping: writing to the array is an access violation */
+        read_only,
+        /*! private mapping: changes to the array are not written to the file */
+        copy_on_write
+    };
+
+    namespace detail
+    {
+        // Memory mapping of a part of a file, unmapped on destruction.
+        class npy_mapping
+        {
+        public:
+
+            npy_mapping(const std::string& filename, std::size_t offset, std::size_t length, mmap_mode mode)
+                : p_base(nullptr), p_data(nullptr), m_length(0)
+            {
+                int fd = ::open(filename.c_str(), O_RDONLY);
+                if (fd == -1)
+                {
+                    throw std::runtime_error("io error: failed to open a file.");
+                }
+                struct stat st;
+                if (::fstat(fd, &st) == -1 || static_cast<std::size_t>(st.st_size) < offset + length)
+                {
+                    ::close(fd);
+                    throw std::runtime_error("io error: npy file is shorter than its header states.");
+                }
+                // the offset of a mapping must be a multiple of the page size
+                std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+                std::size_t map_offset = offset - offset % page_size;
+                m_length = length + offset - map_offset;
+                int prot = mode == mmap_mode::read_only ? PROT_READ : PROT_READ | PROT_WRITE;
+                int flags = mode == mmap_mode::read_only ? MAP_SHARED : MAP_PRIVATE;
+                void* base = ::mmap(nullptr, m_length, prot, flags, fd, static_cast<off_t>(map_offset));
+                ::close(fd);
+                if (base == MAP_FAILED)
+                {
+                    throw std::runtime_error("io error: failed to map a file.");
+                }
+                p_base = static_cast<char*>(base);
+                p_data = p_base + (offset - map_offset);
+            }
+
+            ~npy_mapping()
+            {
+                ::munmap(p_base, m_length);
+            }
+
+            npy_mapping(const npy_mapping&) = delete;
+            npy_mapping& operator=(const npy_mapping&) = delete;
+
+            // Returns a pointer to the byte of the file at the offset of the mapping
+            char* data() const noexcept
+            {
+                return p_data;
+            }
+
+            bool contains(const void* p) const noexcept
+            {
+                const char* c = static_cast<const char*>(p);
+                return c >= p_base && c < p_base + m_length;
+            }
+
+        private:
+
+            char* p_base;
+            char* p_data;
+            std::size_t m_length;
+        };
+
+        // Allocator of the buffer adaptors on a mapped npy file: it keeps the
+        // mapping alive and does not deallocate the mapped data. Memory
+        // allocated when the adaptor is resized or assigned comes from the
+        // standard allocator.
+        template <class T>
+        class npy_mapped_allocator
+        {
+        public:
+
+            using value_type = T;
+            using reference = T&;
+            using const_reference = const T&;
+            using pointer = T*;
+            using const_pointer = const T*;
+            using size_type = std::size_t;
+            using difference_type = std::ptrdiff_t;
+
+            template <class U>
+            struct rebind
+            {
+                using other = npy_mapped_allocator<U>;
+            };
+
+            npy_mapped_allocator() = default;
+
+            explicit npy_mapped_allocator(std::shared_ptr<npy_mapping> mapping) noexcept
+                : m_mapping(std::move(mapping))
+            {
+            }
+
+            template <class U>
+            npy_mapped_allocator(const npy_mapped_allocator<U>& rhs) noexcept
+                : m_mapping(rhs.mapping())
+            {
+            }
+
+            pointer allocate(size_type n)
+            {
+                return std::allocator<T>().allocate(n);
+            }
+
+            void deallocate(pointer p, size_type n)
+            {
+                if (m_mapping == nullptr || !m_mapping->contains(p))
+                {
+                    std::allocator<T>().deallocate(p, n);
+                }
+            }
+
+            template <class U, class... Args>
+            void construct(U* p, Args&&... args)
+            {
+                new ((void*)p) U(std::forward<Args>(args)...);
+            }
+
+            template <class U>
+            void destroy(U* p)
+            {
+                p->~U();
+            }
+
+            const std::shared_ptr<npy_mapping>& mapping() const noexcept
+            {
+                return m_mapping;
+            }
+
+        private:
+
+            std::shared_ptr<npy_mapping> m_mapping;
+        };
+
+        template <class T, class U>
+        inline bool operator==(const npy_mapped_allocator<T>& lhs, const npy_mapped_allocator<U>& rhs) noexcept
+        {
+            return lhs.mapping() == rhs.mapping();
+        }
+
+        template <class T, class U>
+        inline bool operator!=(const npy_mapped_allocator<T>& lhs, const npy_mapped_allocator<U>& rhs) noexcept
+        {
+            return !(lhs == rhs);
+        }
+
+        // Maps the npy data stored at npy_offset in a file, returning an
+        // adaptor on the mapping and the size in bytes of the npy data.
+        template <class T, layout_type L>
+        inline auto map_npy(const std::string& filename, std::istream& stream,
+                            std::size_t npy_offset, mmap_mode mode)
+        {
+            stream.seekg(static_cast<std::streamoff>(npy_offset));
+            bool fortran_order;
+            std::string typestring;
+            std::vector<std::size_t> shape;
+            detail::read_npy_header(stream, typestring, &fortran_order, shape);
+            std::size_t offset = static_cast<std::size_t>(stream.tellg());
+
+            detail::check_npy_cast<T, L>(typestring, fortran_order, true);
+            if (offset % alignof(T) != 0)
+            {
+                throw std::runtime_error("Cast error: misaligned data in npy file.");
+            }
+
+            std::size_t size = compute_size(shape);
+            std::size_t length = offset - npy_offset + size * sizeof(T);
+            auto mapping = std::make_shared<detail::npy_mapping>(filename, npy_offset, length, mode);
+            T* ptr = reinterpret_cast<T*>(mapping->data() + (offset - npy_offset));
+            std::vector<std::size_t> strides = detail::npy_strides(shape, fortran_order);
+            auto res = adapt(std::move(ptr), size, acquire_ownership(), std::move(shape), std::move(strides),
+                             detail::npy_mapped_allocator<T>(std::move(mapping)));
+            return std::make_pair(std::move(res), length);
+        }
+    }
+
+#endif
+
+    /**
+     * Save xexpression to NumPy npy format. Containers are written directly,
+     * other expressions are evaluated by chunks of whole slices along their
+     * first axis, so that they are never evaluated entirely in memory.
+     *
+     * @param filename The filename or path to dump the data
+     * @param e the xexpression
+     * @param chunk_size the maximal size in bytes of an evaluated chunk (a
+     *        chunk holds at least one slice); two chunks are held in memory
+     *        when XTENSOR_USE_THREADS is defined, so that a chunk is written
+     *        while the next one is evaluated
+     */
+    template <typename E>
+    void dump_npy(const std::string& filename, const xexpression<E>& e,
+                  std::size_t chunk_size = detail::npy_chunk_size)
+    {
+        std::ofstream stream(filename, std::ofstream::binary);
+        if (!stream)
+        {
+            throw std::runtime_error("IO Error: failed to open file: "s + filename);
+        }
+
+        detail::dump_npy_stream(stream, e, chunk_size);
+    }
+
+    /**
+     * Loads a npy file (the numpy storage format)
+     *
+     * The data is converted on the fly if the file stores another numeric
+     * type than \p T, or uses the other byte order.
+     *
+     * @param filename The filename or path to the file
+     * @tparam T select the value type of the loaded array
+     * @tparam L select layout_type::column_major if you stored data in
+     *           Fortran format
+     * @return xarray with contents from npy file
+     */
+    template <typename T, layout_type L = layout_type::dynamic>
+    auto load_npy(const std::string& filename)
+    {
+        std::ifstream stream(filename, std::ifstream::binary);
+        if (!stream)
+        {
+            throw std::runtime_error("io error: failed to open a file.");
+        }
+        detail::npy_file file = detail::load_npy_file_as<T>(stream);
+        return std::move(file).cast<T, L>();
+    }
+
+    /**
+     * Loads a part of a npy file (the numpy storage format). The slices
+     * select the part of the array stored in the file, like those of
+     * \ref view: integer indices, \c range, \c all and \c newaxis are
+     * accepted, and missing slices select whole axes. Only the header and
+     * the selected elements are read from the file; elements that are
+     * stored close to each other are read at once.
+     *
+     * @param filename The filename or path to the file
+     * @param slices the slices selecting the part of the array to load
+     * @tparam T select the type of the npy file (note: currently there is
+     *           no dynamic casting if types do not match)
+     * @tparam L select layout_type::column_major if you stored data in
+     *           Fortran format
+     * @return xarray with the selected contents of the npy file, in the
+     *         layout of the file
+     */
+    template <typename T, layout_type L = layout_type::dynamic, class... S>
+    xarray<T, L> load_npy_slice(const std::string& filename, S... slices)
+    {
+        std::ifstream stream(filename, std::ifstream::binary);
+        if (!stream)
+        {
+            throw std::runtime_error("io error: failed to open a file.");
+        }
+        bool fortran_order;
+        std::string typestring;
+        std::vector<std::size_t> shape;
+        detail::read_npy_header(stream, typestring, &fortran_order, shape);
+        std::size_t offset = static_cast<std::size_t>(stream.tellg());
+        detail::check_npy_cast<T, L>(typestring, fortran_order, true);
+
+        slice_vector sv(shape, slices...);
+        std::vector<detail::npy_axis_selection> selection;
+        std::vector<std::size_t> result_shape;
+        for (const auto& s : sv)
+        {
+            if (s[0] == -1 && s[1] == 0)
+            {
+                // newaxis
+                result_shape.push_back(1);
+                continue;
+            }
+            std::size_t axis = selection.size();
+            // integer indices have a step of 0, empty ranges a size of 0
+            bool index = s[2] == 0;
+            if (axis >= shape.size())
+            {
+                throw std::out_of_range("npy slice out of bounds");
+            }
+            if (!index && s[1] == 0)
+            {
+                // empty range, nothing is read
+                selection.push_back({0, 0, 1});
+                result_shape.push_back(0);
+                continue;
+            }
+            // first and last selected indices
+            std::ptrdiff_t first = s[0];
+            std::ptrdiff_t last = index ? s[0] : s[0] + (s[1] - 1) * s[2];
+            if (std::min(first, last) < 0 || static_cast<std::size_t>(std::max(first, last)) >= shape[axis])
+            {
+                throw std::out_of_range("npy slice out of bounds");
+            }
+            if (index)
+            {
+                selection.push_back({static_cast<std::size_t>(s[0]), 1, 1});
+            }
+            else
+            {
+                selection.push_back({static_cast<std::size_t>(s[0]), static_cast<std::size_t>(s[1]), s[2]});
+                result_shape.push_back(static_cast<std::size_t>(s[1]));
+            }
+        }
+        for (std::size_t axis = selection.size(); axis < shape.size(); ++axis)
+        {
+            selection.push_back({0, shape[axis], 1});
+            result_shape.push_back(shape[axis]);
+        }
+
+        xarray<T, L> result(result_shape, fortran_order ? layout_type::column_major : layout_type::row_major);
+        if (result.size() != 0)
+        {
+            if (fortran_order)
+            {
+                std::reverse(shape.begin(), shape.end());
+                std::reverse(selection.begin(), selection.end());
+            }
+            detail::read_npy_selection(stream, offset, sizeof(T), shape, selection,
+                                       reinterpret_cast<char*>(result.raw_data()));
+        }
+        return result;
+    }
+
+    /*****************
+     * xnpy_appender *
+     *****************/
+
+    /**
+     * @class xnpy_appender
+     * @brief Writer of npy files growing along their first axis.
+     *
+     * The xnpy_appender class creates a npy file holding rows of a given
+     * shape, to which rows computed from expressions are appended. The
+     * header reserves room for any number of rows; it is rewritten in
+     * place with the current number of rows when the appender is flushed
+     * or closed, so that the file is a valid npy file after each flush.
+     * The appender is closed on destruction.
+     *
+     * @tparam T the value type of the stored array
+     */
+    template <class T>
+    class xnpy_appender
+    {
+    public:
+
+        using value_type = T;
+        using size_type = std::size_t;
+        using shape_type = std::vector<size_type>;
+
+        template <class S = shape_type>
+        xnpy_appender(const std::string& filename, const S& row_shape,
+                      size_type chunk_size = detail::npy_chunk_size);
+        ~xnpy_appender();
+
+        xnpy_appender(const xnpy_appender&) = delete;
+        xnpy_appender& operator=(const xnpy_appender&) = delete;
+
+        xnpy_appender(xnpy_appender&&) = default;
+        xnpy_appender& operator=(xnpy_appender&&) = delete;
+
+        template <class E>
+        void append(const xexpression<E>& e);
+
+        void flush();
+        void close();
+
+        size_type size() const noexcept;
+        const shape_type& shape() const noexcept;
+
+    private:
+
+        void write_header();
+
+        std::fstream m_stream;
+        shape_type m_shape;
+        size_type m_chunk_size;
+    };
+
+    /**
+     * Creates the npy file, overwriting any existing file, and writes
+     * its header for zero rows.
+     * @param filename The filename or path to the file
+     * @param row_shape the shape of the rows of the stored array
+     * @param chunk_size the maximal size in bytes of the chunks in which
+     *        appended expressions are evaluated, see \ref dump_npy
+     */
+    template <class T>
+    template <class S>
+    inline xnpy_appender<T>::xnpy_appender(const std::string& filename, const S& row_shape, size_type chunk_size)
+        : m_stream(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc),
+          m_shape(1, size_type(0)), m_chunk_size(chunk_size)
+    {
+        if (!m_stream)
+        {
+            throw std::runtime_error("IO Error: failed to open file: "s + filename);
+        }
+        m_shape.insert(m_shape.end(), std::begin(row_shape), std::end(row_shape));
+        write_header();
+    }
+
+    template <class T>
+    inline xnpy_appender<T>::~xnpy_appender()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    /**
+     * Appends an expression to the file: either a row, whose shape is the
+     * shape of the rows, or a block of rows stacked along the first axis.
+     * The rows are written at the end of the file, the header is only
+     * updated by \ref flush and \ref close.
+     * @param e the expression to append
+     */
+    template <class T>
+    template <class E>
+    inline void xnpy_appender<T>::append(const xexpression<E>& e)
+    {
+        const E& ex = e.derived_cast();
+        size_type row_dim = m_shape.size() - 1;
+        if ((ex.dimension() != row_dim && ex.dimension() != row_dim + 1) ||
+            !std::equal(m_shape.cbegin() + 1, m_shape.cend(), ex.shape().cend() - static_cast<std::ptrdiff_t>(row_dim)))
+        {
+            throw std::runtime_error("xnpy_appender: shape of the appended expression does not match the row shape");
+        }
+        size_type nb_rows = ex.dimension() == row_dim ? 1 : ex.shape()[0];
+        m_stream.seekp(0, std::ios::end);
+        detail::write_npy_row_major<T>(m_stream, ex, m_chunk_size);
+        if (!m_stream)
+        {
+            throw std::runtime_error("io error: failed writing file");
+        }
+        m_shape[0] += nb_rows;
+    }
+
+    /**
+     * Updates the number of rows in the header and flushes the file.
+     */
+    template <class T>
+    inline void xnpy_appender<T>::flush()
+    {
+        write_header();
+        m_stream.seekp(0, std::ios::end);
+        m_stream.flush();
+        if (!m_stream)
+        {
+            throw std::runtime_error("io error: failed writing file");
+        }
+    }
+
+    /**
+     * Updates the number of rows in the header and closes the file.
+     */
+    template <class T>
+    inline void xnpy_appender<T>::close()
+    {
+        if (m_stream.is_open())
+        {
+            flush();
+            m_stream.close();
+        }
+    }
+
+    /**
+     * Returns the number of rows appended to the file.
+     */
+    template <class T>
+    inline auto xnpy_appender<T>::size() const noexcept -> size_type
+    {
+        return m_shape[0];
+    }
+
+    /**
+     * Returns the shape of the stored array.
+     */
+    template <class T>
+    inline auto xnpy_appender<T>::shape() const noexcept -> const shape_type&
+    {
+        return m_shape;
+    }
+
+    // The header is written with room for the 20 digits of the largest
+    // number of rows, so that it keeps the same length.
+    template <class T>
+    inline void xnpy_appender<T>::write_header()
+    {
+        size_type nb_digits = std::to_string(m_shape[0]).size();
+        m_stream.seekp(0);
+        detail::write_header(m_stream, detail::build_typestring<T>(), false, m_shape, 20 - nb_digits);
+    }
+
+#ifdef XTENSOR_NPY_MMAP
+
+    /**
+     * Maps a npy file in memory (the numpy storage format). Only the header
+     * is read; the returned adaptor points directly at the data in the
+     * mapping, so that the pages of the file are loaded when they are first
+     * accessed. The mapping lives as long as the adaptor.
+     *
+     * This function is available on POSIX systems.
+     *
+     * @param filename The filename or path to the file
+     * @param mode the access mode of the mapping, copy-on-write by default
+     * @tparam T select the type of the npy file (there is no dynamic casting
+     *           if types do not match)
+     * @tparam L select layout_type::column_major if you stored data in
+     *           Fortran format
+     * @return xarray_adaptor on the contents of the npy file
+     */
+    template <typename T, layout_type L = layout_type::dynamic>
+    auto load_npy_mmap(const std::string& filename, mmap_mode mode = mmap_mode::copy_on_write)
+    {
+        std::ifstream stream(filename, std::ifstream::binary);
+        if (!stream)
+        {
+            throw std::runtime_error("io error: failed to open a file.");
+        }
+        return detail::map_npy<T, L>(filename, stream, 0, mode).first;
+    }
+
+#endif
+
+    /****************
+     * npz archives *
+     ****************/
+
+    namespace detail
+    {
+        constexpr std::uint32_t zip_local_signature = 0x04034b50;
+        constexpr std::uint32_t zip_central_signature = 0x02014b50;
+        constexpr std::uint32_t zip_end_signature = 0x06054b50;
+        constexpr std::uint32_t zip64_end_signature = 0x06064b50;
+        constexpr std::uint32_t zip64_locator_signature = 0x07064b50;
+
+        constexpr std::size_t zip_local_size = 30;
+        constexpr std::size_t zip_central_size = 46;
+        constexpr std::size_t zip_end_size = 22;
+        constexpr std::size_t zip64_end_size = 56;
+        constexpr std::size_t zip64_locator_size = 20;
+        constexpr std::size_t zip_max_comment_size = 0xffff;
+
+        // value of the 32-bit fields whose actual value is in the zip64 extra field
+        constexpr std::uint32_t zip_overflow = 0xffffffff;
+        constexpr std::uint16_t zip64_extra_id = 0x0001;
+        // id of the extra field padding the local headers, as written by zipalign
+        constexpr std::uint16_t zip_align_extra_id = 0xd935;
+        // members are named in UTF-8
+        constexpr std::uint16_t zip_utf8_flag = 0x0800;
+        // MS-DOS date of the members: 1980-01-01
+        constexpr std::uint16_t zip_dos_date = (1 << 5) | 1;
+
+        // alignment in bytes of the members of written npz files; the length
+        // of npy headers is a multiple of this alignment as well
+        constexpr std::size_t npz_alignment = 16;
+
+        template <class U>
+        inline U get_le(const char* p) noexcept
+        {
+            U res = 0;
+            for (std::size_t i = sizeof(U); i != 0; --i)
+            {
+                res = static_cast<U>((res << 8) | static_cast<unsigned char>(p[i - 1]));
+            }
+            return res;
+        }
+
+        template <class U>
+        inline void put_le(std::string& buffer, U value)
+        {
+            for (std::size_t i = 0; i < sizeof(U); ++i)
+            {
+                buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+            }
+        }
+
+        // Tables of the slicing-by-8 computation of the CRC-32 of ZIP archives
+        inline const std::array<std::array<std::uint32_t, 256>, 8>& crc32_tables()
+        {
+            static const std::array<std::array<std::uint32_t, 256>, 8> tables = []() {
+                std::array<std::array<std::uint32_t, 256>, 8> res;
+                for (std::uint32_t i = 0; i < 256; ++i)
+                {
+                    std::uint32_t c = i;
+                    for (std::size_t k = 0; k < 8; ++k)
+                    {
+                        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+                    }
+                    res[0][i] = c;
+                }
+                for (std::size_t t = 1; t < 8; ++t)
+                {
+                    for (std::size_t i = 0; i < 256; ++i)
+                    {
+                        std::uint32_t c = res[t - 1][i];
+                        res[t][i] = (c >> 8) ^ res[0][c & 0xff];
+                    }
+                }
+                return res;
+            }();
+            return tables;
+        }
+
+        inline std::uint32_t crc32_update(std::uint32_t crc, const char* data, std::size_t size) noexcept
+        {
+            const auto& t = crc32_tables();
+            crc = ~crc;
+            for (; size >= 8; size -= 8, data += 8)
+            {
+                std::uint32_t lo = crc ^ get_le<std::uint32_t>(data);
+                std::uint32_t hi = get_le<std::uint32_t>(data + 4);
+                crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+                      t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+            }
+            for (; size != 0; --size, ++data)
+            {
+                crc = t[0][(crc ^ static_cast<unsigned char>(*data)) & 0xff] ^ (crc >> 8);
+            }
+            return ~crc;
+        }
+
+        // Output stream forwarding to the stream of a ZIP archive, computing
+        // the size and the CRC-32 of the data of a member.
+        class zip_member_ostream
+        {
+        public:
+
+            explicit zip_member_ostream(std::ostream& stream)
+                : m_stream(stream), m_crc(0), m_size(0)
+            {
+            }
+
+            zip_member_ostream& write(const char* s, std::streamsize n)
+            {
+                m_stream.write(s, n);
+                m_crc = crc32_update(m_crc, s, static_cast<std::size_t>(n));
+                m_size += static_cast<std::uint64_t>(n);
+                return *this;
+            }
+
+            zip_member_ostream& put(char c)
+            {
+                return write(&c, 1);
+            }
+
+            zip_member_ostream& operator<<(const std::string& s)
+            {
+                return write(s.data(), static_cast<std::streamsize>(s.size()));
+            }
+
+            std::uint32_t crc() const noexcept
+            {
+                return m_crc;
+            }
+
+            std::uint64_t size() const noexcept
+            {
+                return m_size;
+            }
+
+        private:
+
+            std::ostream& m_stream;
+            std::uint32_t m_crc;
+            std::uint64_t m_size;
+        };
+
+        // Entry of the central directory of a ZIP archive
+        struct zip_member
+        {
+            std::string m_name;
+            std::uint16_t m_compression;
+            std::uint32_t m_crc;
+            std::uint64_t m_size;
+            std::uint64_t m_offset;
+        };
+
+        inline std::runtime_error npz_format_error()
+        {
+            return std::runtime_error("io error: invalid npz file.");
+        }
+
+        // Reads the central directory of a ZIP archive from the end of the
+        // stream; the members themselves are not read.
+        inline std::vector<zip_member> read_zip_directory(std::istream& stream)
+        {
+            stream.seekg(0, std::ios::end);
+            std::uint64_t file_size = static_cast<std::uint64_t>(stream.tellg());
+            std::size_t tail_size = static_cast<std::size_t>(
+                std::min(file_size, std::uint64_t(zip64_locator_size + zip_end_size + zip_max_comment_size)));
+            if (tail_size < zip_end_size)
+            {
+                throw npz_format_error();
+            }
+            std::string tail(tail_size, '\0');
+            stream.seekg(static_cast<std::streamoff>(file_size - tail_size));
+            stream.read(&tail[0], static_cast<std::streamsize>(tail_size));
+
+            // the end of central directory record is followed by a comment
+            std::size_t pos = tail_size - zip_end_size;
+            while (get_le<std::uint32_t>(&tail[pos]) != zip_end_signature)
+            {
+                if (pos == 0)
+                {
+                    throw npz_format_error();
+                }
+                --pos;
+            }
+            std::uint64_t nb_members = get_le<std::uint16_t>(&tail[pos + 10]);
+            std::uint64_t dir_size = get_le<std::uint32_t>(&tail[pos + 12]);
+            std::uint64_t dir_offset = get_le<std::uint32_t>(&tail[pos + 16]);
+            if (pos >= zip64_locator_size &&
+                get_le<std::uint32_t>(&tail[pos - zip64_locator_size]) == zip64_locator_signature)
+            {
+                std::array<char, zip64_end_size> end64;
+                stream.seekg(static_cast<std::streamoff>(get_le<std::uint64_t>(&tail[pos - zip64_locator_size + 8])));
+                stream.read(end64.data(), zip64_end_size);
+                if (!stream || get_le<std::uint32_t>(end64.data()) != zip64_end_signature)
+                {
+                    throw npz_format_error();
+                }
+                nb_members = get_le<std::uint64_t>(end64.data() + 32);
+                dir_size = get_le<std::uint64_t>(end64.data() + 40);
+                dir_offset = get_le<std::uint64_t>(end64.data() + 48);
+            }
+            if (dir_offset + dir_size > file_size)
+            {
+                throw npz_format_error();
+            }
+
+            std::string dir(static_cast<std::size_t>(dir_size), '\0');
+            stream.seekg(static_cast<std::streamoff>(dir_offset));
+            stream.read(&dir[0], static_cast<std::streamsize>(dir.size()));
+            if (!stream)
+            {
+                throw npz_format_error();
+            }
+
+            std::vector<zip_member> res;
+            res.reserve(static_cast<std::size_t>(std::min(nb_members, dir_size / zip_central_size)));
+            pos = 0;
+            for (std::uint64_t i = 0; i < nb_members; ++i)
+            {
+                if (pos + zip_central_size > dir.size() || get_le<std::uint32_t>(&dir[pos]) != zip_central_signature)
+                {
+                    throw npz_format_error();
+                }
+                const char* entry = &dir[pos];
+                std::size_t name_size = get_le<std::uint16_t>(entry + 28);
+                std::size_t extra_size = get_le<std::uint16_t>(entry + 30);
+                std::size_t comment_size = get_le<std::uint16_t>(entry + 32);
+                if (pos + zip_central_size + name_size + extra_size > dir.size())
+                {
+                    throw npz_format_error();
+                }
+
+                zip_member m;
+                m.m_name = dir.substr(pos + zip_central_size, name_size);
+                m.m_compression = get_le<std::uint16_t>(entry + 10);
+                m.m_crc = get_le<std::uint32_t>(entry + 16);
+                m.m_size = get_le<std::uint32_t>(entry + 20);
+                std::uint64_t uncompressed_size = get_le<std::uint32_t>(entry + 24);
+                m.m_offset = get_le<std::uint32_t>(entry + 42);
+
+                // the zip64 extra field holds the overflowing fields, in this order
+                const char* extra = entry + zip_central_size + name_size;
+                const char* extra_end = extra + extra_size;
+                while (extra + 4 <= extra_end)
+                {
+                    std::uint16_t id = get_le<std::uint16_t>(extra);
+                    std::size_t size = get_le<std::uint16_t>(extra + 2);
+                    const char* field = extra + 4;
+                    const char* field_end = std::min(field + size, extra_end);
+                    if (id == zip64_extra_id)
+                    {
+                        for (std::uint64_t* value : {&uncompressed_size, &m.m_size, &m.m_offset})
+                        {
+                            if (*value == zip_overflow && field + 8 <= field_end)
+                            {
+                                *value = get_le<std::uint64_t>(field);
+                                field += 8;
+                            }
+                        }
+                    }
+                    extra += 4 + size;
+                }
+                res.push_back(std::move(m));
+                pos += zip_central_size + name_size + extra_size + comment_size;
+            }
+            return res;
+        }
+
+        // Returns the offset of the data of a stored member of a ZIP archive
+        inline std::uint64_t zip_member_data(std::istream& stream, const zip_member& m)
+        {
+            if (m.m_compression != 0)
+            {
+                throw std::runtime_error("io error: compressed npz members are not supported.");
+            }
+            std::array<char, zip_local_size> header;
+            stream.seekg(static_cast<std::streamoff>(m.m_offset));
+            stream.read(header.data(), zip_local_size);
+            if (!stream || get_le<std::uint32_t>(header.data()) != zip_local_signature)
+            {
+                throw npz_format_error();
+            }
+            return m.m_offset + zip_local_size + get_le<std::uint16_t>(header.data() + 26) +
+                   get_le<std::uint16_t>(header.data() + 28);
+        }
+
+        inline std::string npz_member_name(const std::string& name)
+        {
+            return name + ".npy";
+        }
+    }
+
+    /*************
+     * xnpz_file *
+     *************/
+
+    /**
+     * @class xnpz_file
+     * @brief Handle on a npz archive.
+     *
+     * The xnpz_file class gives access to the arrays stored in a npz file
+     * (the archive format of numpy.savez). Only the central directory of
+     * the archive is read on construction; each array is read from the
+     * file when it is loaded. The arrays must be stored uncompressed, as
+     * written by numpy.savez and \ref dump_npz.
+     */
+    class xnpz_file
+    {
+    public:
+
+        explicit xnpz_file(const std::string& filename);
+
+        std::size_t size() const noexcept;
+        const std::vector<std::string>& names() const noexcept;
+        bool contains(const std::string& name) const;
+
+        template <class T, layout_type L = layout_type::dynamic>
+        auto load(const std::string& name) const;
+
+#ifdef XTENSOR_NPY_MMAP
+        template <class T, layout_type L = layout_type::dynamic>
+        auto load_mmap(const std::string& name, mmap_mode mode = mmap_mode::copy_on_write) const;
+#endif
+
+    private:
+
+        const detail::zip_member& member(const std::string& name) const;
+        std::ifstream open() const;
+
+        std::string m_filename;
+        std::vector<std::string> m_names;
+        std::map<std::string, detail::zip_member> m_members;
+    };
+
+    /**
+     * Reads the central directory of a npz file.
+     * @param filename The filename or path to the file
+     */
+    inline xnpz_file::xnpz_file(const std::string& filename)
+        : m_filename(filename)
+    {
+        std::ifstream stream = open();
+        for (auto& m : detail::read_zip_directory(stream))
+        {
+            std::string name = m.m_name;
+            const std::string extension = ".npy";
+            if (name.size() > extension.size() &&
+                name.compare(name.size() - extension.size(), extension.size(), extension) == 0)
+            {
+                name.erase(name.size() - extension.size());
+            }
+            if (m_members.emplace(name, std::move(m)).second)
+            {
+                m_names.push_back(std::move(name));
+            }
+        }
+    }
+
+    /**
+     * Returns the number of arrays in the archive.
+     */
+    inline std::size_t xnpz_file::size() const noexcept
+    {
+        return m_names.size();
+    }
+
+    /**
+     * Returns the names of the arrays in the archive, in the order of the
+     * archive. Like in numpy, the extension \c .npy of the member names is
+     * removed.
+     */
+    inline const std::vector<std::string>& xnpz_file::names() const noexcept
+    {
+        return m_names;
+    }
+
+    /**
+     * Returns true if the archive holds an array with the given name.
+     */
+    inline bool xnpz_file::contains(const std::string& name) const
+    {
+        return m_members.find(name) != m_members.end();
+    }
+
+    /**
+     * Loads an array of the archive. Only the given member of the archive
+     * is read.
+     *
+     * The data is converted on the fly if the member stores another numeric
+     * type than \p T, or uses the other byte order.
+     *
+     * @param name the name of the array
+     * @tparam T select the value type of the loaded array
+     * @tparam L select layout_type::column_major if the array is stored in
+     *           Fortran format
+     * @return xarray with contents of the array
+     */
+    template <class T, layout_type L>
+    inline auto xnpz_file::load(const std::string& name) const
+    {
+        const detail::zip_member& m = member(name);
+        std::ifstream stream = open();
+        std::uint64_t offset = detail::zip_member_data(stream, m);
+        stream.seekg(static_cast<std::streamoff>(offset));
+        detail::npy_file file = detail::load_npy_file_as<T>(stream);
+        if (!stream || static_cast<std::uint64_t>(stream.tellg()) > offset + m.m_size)
+        {
+            throw std::runtime_error("io error: npz member is shorter than its header states.");
+        }
+        return std::move(file).cast<T, L>();
+    }
+
+#ifdef XTENSOR_NPY_MMAP
+    /**
+     * Maps an array of the archive in memory, see \ref load_npy_mmap. The
+     * data of the array must be aligned for T in the file, which is the
+     * case of the archives written by \ref dump_npz.
+     *
+     * This function is available on POSIX systems.
+     *
+     * @param name the name of the array
+     * @param mode the access mode of the mapping, copy-on-write by default
+     * @tparam T select the type of the array (there is no dynamic casting
+     *           if types do not match)
+     * @tparam L select layout_type::column_major if the array is stored in
+     *           Fortran format
+     * @return xarray_adaptor on the contents of the array
+     */
+    template <class T, layout_type L>
+    inline auto xnpz_file::load_mmap(const std::string& name, mmap_mode mode) const
+    {
+        const detail::zip_member& m = member(name);
+        std::ifstream stream = open();
+        std::uint64_t offset = detail::zip_member_data(stream, m);
+        auto res = detail::map_npy<T, L>(m_filename, stream, static_cast<std::size_t>(offset), mode);
+        if (res.second > m.m_size)
+        {
+            throw std::runtime_error("io error: npz member is shorter than its header states.");
+        }
+        return std::move(res.first);
+    }
+#endif
+
+    inline const detail::zip_member& xnpz_file::member(const std::string& name) const
+    {
+        auto it = m_members.find(name);
+        if (it == m_members.end())
+        {
+            throw std::out_of_range("no array named " + name + " in npz file " + m_filename);
+        }
+        return it->second;
+    }
+
+    inline std::ifstream xnpz_file::open() const
+    {
+        std::ifstream stream(m_filename, std::ifstream::binary);
+        if (!stream)
+        {
+            throw std::runtime_error("io error: failed to open a file.");
+        }
+        return stream;
+    }
+
+    /***************
+     * xnpz_writer *
+     ***************/
+
+    /**
+     * @class xnpz_writer
+     * @brief Writer of npz archives.
+     *
+     * The xnpz_writer class writes arrays computed from expressions to an
+     * uncompressed npz file, that numpy.load reads. Each expression is
+     * written like by \ref dump_npy, so that it is not evaluated entirely
+     * in memory; the npy data of each member is aligned on 16 bytes in
+     * the file, so that the members can be mapped in memory. The central
+     * directory of the archive is written when the writer is closed, or
+     * on destruction.
+     */
+    class xnpz_writer
+    {
+    public:
+
+        explicit xnpz_writer(const std::string& filename, std::size_t chunk_size = detail::npy_chunk_size);
+        ~xnpz_writer();
+
+        xnpz_writer(const xnpz_writer&) = delete;
+        xnpz_writer& operator=(const xnpz_writer&) = delete;
+
+        xnpz_writer(xnpz_writer&&) = default;
+        xnpz_writer& operator=(xnpz_writer&&) = delete;
+
+        template <class E>
+        void add(const std::string& name, const xexpression<E>& e);
+
+        void close();
+
+    private:
+
+        void check_stream();
+
+        std::ofstream m_stream;
+        std::vector<detail::zip_member> m_members;
+        std::size_t m_chunk_size;
+    };
+
+    /**
+     * Creates the npz file, overwriting any existing file.
+     * @param filename The filename or path to the file
+     * @param chunk_size the maximal size in bytes of the chunks in which
+     *        expressions are evaluated, see \ref dump_npy
+     */
+    inline xnpz_writer::xnpz_writer(const std::string& filename, std::size_t chunk_size)
+        : m_stream(filename, std::ofstream::binary), m_chunk_size(chunk_size)
+    {
+        if (!m_stream)
+        {
+            throw std::runtime_error("IO Error: failed to open file: "s + filename);
+        }
+    }
+
+    inline xnpz_writer::~xnpz_writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    /**
+     * Writes an expression to the archive.
+     * @param name the name of the array in the archive
+     * @param e the expression to write
+     */
+    template <class E>
+    inline void xnpz_writer::add(const std::string& name, const xexpression<E>& e)
+    {
+        using value_type = typename E::value_type;
+        const E& ex = e.derived_cast();
+        if (!m_stream.is_open())
+        {
+            throw std::runtime_error("xnpz_writer: the archive is closed");
+        }
+
+        detail::zip_member m;
+        m.m_name = detail::npz_member_name(name);
+        m.m_compression = 0;
+        m.m_offset = static_cast<std::uint64_t>(m_stream.tellp());
+
+        // The sizes are written after the data; room for a zip64 extra field
+        // is reserved if the member may not fit in 4 GiB.
+        std::uint64_t max_size = std::uint64_t(sizeof(value_type)) * compute_size(ex.shape()) + 64 + 32 * ex.dimension();
+        bool zip64 = max_size >= detail::zip_overflow;
+        std::size_t zip64_size = zip64 ? 20 : 0;
+        std::size_t align_size = detail::npz_alignment - 1 -
+                                 (m.m_offset + detail::zip_local_size + m.m_name.size() + zip64_size + 4 + detail::npz_alignment - 1) %
+                                     detail::npz_alignment;
+
+        std::string header;
+        detail::put_le(header, detail::zip_local_signature);
+        detail::put_le(header, std::uint16_t(zip64 ? 45 : 20));
+        detail::put_le(header, detail::zip_utf8_flag);
+        detail::put_le(header, std::uint16_t(0));
+        detail::put_le(header, std::uint16_t(0));
+        detail::put_le(header, detail::zip_dos_date);
+        detail::put_le(header, std::uint32_t(0));
+        detail::put_le(header, std::uint64_t(0));
+        detail::put_le(header, static_cast<std::uint16_t>(m.m_name.size()));
+        detail::put_le(header, static_cast<std::uint16_t>(zip64_size + 4 + align_size));
+        header += m.m_name;
+        if (zip64)
+        {
+            detail::put_le(header, detail::zip64_extra_id);
+            detail::put_le(header, std::uint16_t(16));
+            detail::put_le(header, std::uint64_t(0));
+            detail::put_le(header, std::uint64_t(0));
+        }
+        detail::put_le(header, detail::zip_align_extra_id);
+        detail::put_le(header, static_cast<std::uint16_t>(align_size));
+        header.append(align_size, '\0');
+        m_stream.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+        detail::zip_member_ostream out(m_stream);
+        detail::dump_npy_stream(out, ex, m_chunk_size);
+        check_stream();
+        m.m_crc = out.crc();
+        m.m_size = out.size();
+        if (!zip64 && m.m_size >= detail::zip_overflow)
+        {
+            throw std::runtime_error("xnpz_writer: npy header of " + name + " too large");
+        }
+
+        // the CRC-32 and the sizes are written in place in the local header
+        std::string sizes;
+        detail::put_le(sizes, m.m_crc);
+        std::uint32_t size32 = zip64 ? detail::zip_overflow : static_cast<std::uint32_t>(m.m_size);
+        detail::put_le(sizes, size32);
+        detail::put_le(sizes, size32);
+        m_stream.seekp(static_cast<std::streamoff>(m.m_offset + 14));
+        m_stream.write(sizes.data(), static_cast<std::streamsize>(sizes.size()));
+        if (zip64)
+        {
+            sizes.clear();
+            detail::put_le(sizes, m.m_size);
+            detail::put_le(sizes, m.m_size);
+            m_stream.seekp(static_cast<std::streamoff>(m.m_offset + detail::zip_local_size + m.m_name.size() + 4));
+            m_stream.write(sizes.data(), static_cast<std::streamsize>(sizes.size()));
+        }
+        m_stream.seekp(0, std::ios::end);
+        check_stream();
+        m_members.push_back(std::move(m));
+    }
+
+    /**
+     * Writes the central directory of the archive and closes the file.
+     */
+    inline void xnpz_writer::close()
+    {
+        if (!m_stream.is_open())
+        {
+            return;
+        }
+
+        std::uint64_t dir_offset = static_cast<std::uint64_t>(m_stream.tellp());
+        std::string dir;
+        for (const auto& m : m_members)
+        {
+            std::string zip64_extra;
+            for (std::uint64_t value : {m.m_size, m.m_size, m.m_offset})
+            {
+                if (value >= detail::zip_overflow)
+                {
+                    detail::put_le(zip64_extra, value);
+                }
+            }
+            std::uint16_t version = zip64_extra.empty() ? 20 : 45;
+            auto field32 = [](std::uint64_t value) {
+                return static_cast<std::uint32_t>(std::min(value, std::uint64_t(detail::zip_overflow)));
+            };
+
+            detail::put_le(dir, detail::zip_central_signature);
+            detail::put_le(dir, version);
+            detail::put_le(dir, version);
+            detail::put_le(dir, detail::zip_utf8_flag);
+            detail::put_le(dir, std::uint16_t(0));
+            detail::put_le(dir, std::uint16_t(0));
+            detail::put_le(dir, detail::zip_dos_date);
+            detail::put_le(dir, m.m_crc);
+            detail::put_le(dir, field32(m.m_size));
+            detail::put_le(dir, field32(m.m_size));
+            detail::put_le(dir, static_cast<std::uint16_t>(m.m_name.size()));
+            detail::put_le(dir, static_cast<std::uint16_t>(zip64_extra.empty() ? 0 : zip64_extra.size() + 4));
+            detail::put_le(dir, std::uint16_t(0));
+            detail::put_le(dir, std::uint16_t(0));
+            detail::put_le(dir, std::uint16_t(0));
+            detail::put_le(dir, std::uint32_t(0));
+            detail::put_le(dir, field32(m.m_offset));
+            dir += m.m_name;
+            if (!zip64_extra.empty())
+            {
+                detail::put_le(dir, detail::zip64_extra_id);
+                detail::put_le(dir, static_cast<std::uint16_t>(zip64_extra.size()));
+                dir += zip64_extra;
+            }
+        }
+
+        std::uint64_t nb_members = m_members.size();
+        std::uint64_t dir_size = dir.size();
+        if (nb_members >= 0xffff || dir_size >= detail::zip_overflow || dir_offset >= detail::zip_overflow)
+        {
+            std::uint64_t end64_offset = dir_offset + dir_size;
+            detail::put_le(dir, detail::zip64_end_signature);
+            detail::put_le(dir, std::uint64_t(detail::zip64_end_size - 12));
+            detail::put_le(dir, std::uint16_t(45));
+            detail::put_le(dir, std::uint16_t(45));
+            detail::put_le(dir, std::uint32_t(0));
+            detail::put_le(dir, std::uint32_t(0));
+            detail::put_le(dir, nb_members);
+            detail::put_le(dir, nb_members);
+            detail::put_le(dir, dir_size);
+            detail::put_le(dir, dir_offset);
+
+            detail::put_le(dir, detail::zip64_locator_signature);
+            detail::put_le(dir, std::uint32_t(0));
+            detail::put_le(dir, end64_offset);
+            detail::put_le(dir, std::uint32_t(1));
+        }
+        std::uint16_t nb_members16 = static_cast<std::uint16_t>(std::min(nb_members, std::uint64_t(0xffff)));
+        detail::put_le(dir, detail::zip_end_signature);
+        detail::put_le(dir, std::uint16_t(0));
+        detail::put_le(dir, std::uint16_t(0));
+        detail::put_le(dir, nb_members16);
+        detail::put_le(dir, nb_members16);
+        detail::put_le(dir, static_cast<std::uint32_t>(std::min(dir_size, std::uint64_t(detail::zip_overflow))));
+        detail::put_le(dir, static_cast<std::uint32_t>(std::min(dir_offset, std::uint64_t(detail::zip_overflow))));
+        detail::put_le(dir, std::uint16_t(0));
+
+        m_stream.write(dir.data(), static_cast<std::streamsize>(dir.size()));
+        check_stream();
+        m_stream.close();
+        check_stream();
+    }
+
+    inline void xnpz_writer::check_stream()
+    {
+        if (!m_stream)
+        {
+            throw std::runtime_error("io error: failed writing file");
+        }
+    }
+
+    namespace detail
+    {
+        inline void add_npz_members(xnpz_writer&)
+        {
+        }
+
+        template <class E, class... Args>
+        inline void add_npz_members(xnpz_writer& writer, const std::string& name,
+                                    const xexpression<E>& e, const Args&... args)
+        {
+            writer.add(name, e);
+            add_npz_members(writer, args...);
+        }
+    }
+
+    /**
+     * Opens a npz file (the archive format of numpy.savez). Only the
+     * central directory of the archive is read; the arrays are read when
+     * they are loaded from the returned handle.
+     *
+     * @param filename The filename or path to the file
+     * @return xnpz_file handle on the archive
+     */
+    inline xnpz_file load_npz(const std::string& filename)
+    {
+        return xnpz_file(filename);
+    }
+
+    /**
+     * Saves expressions to an uncompressed npz file (the archive format of
+     * numpy.savez), like numpy.savez(filename, name1=e1, name2=e2).
+     *
+     * @param filename The filename or path to the file
+     * @param args the names of the arrays, followed each by the xexpression
+     *        to save under this name
+     */
+    template <class... Args>
+    inline void dump_npz(const std::string& filename, const Args&... args)
+    {
+        xnpz_writer writer(filename);
+        detail::add_npz_members(writer, args...);
+        writer.close();
     }
 
 }  // namespace xt
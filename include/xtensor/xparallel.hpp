@@ -0,0 +1,521 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille, Sylvain Corlay and Wolf Vollprecht    *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTENSOR_PARALLEL_HPP
+#define XTENSOR_PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+
+#ifdef XTENSOR_USE_THREADS
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+#include "xtensor_config.hpp"
+
+namespace xt
+{
+
+#ifdef XTENSOR_USE_THREADS
+
+    /*************
+     * xexecutor *
+     *************/
+
+    /**
+     * @class xexecutor
+     * @brief Base class for the executors running the parallel kernels of xtensor.
+     *
+     * An executor runs batches of independent tasks. Inheriting from this
+     * class and passing an instance to \ref set_executor allows to share the
+     * threads of an application with xtensor.
+     */
+    class xexecutor
+    {
+    public:
+
+        using task_type = std::function<void(std::size_t)>;
+
+        virtual ~xexecutor() = default;
+
+        /**
+         * Returns the number of threads that can run tasks concurrently,
+         * including the calling thread.
+         */
+        virtual std::size_t concurrency() const noexcept = 0;
+
+        /**
+         * Calls \p task(i) for each i in [0, nb_tasks) and returns when
+         * all the calls are done. Exceptions thrown by the tasks must be
+         * forwarded to the caller.
+         */
+        virtual void run(std::size_t nb_tasks, const task_type& task) = 0;
+
+    protected:
+
+        xexecutor() = default;
+        xexecutor(const xexecutor&) = default;
+        xexecutor& operator=(const xexecutor&) = default;
+        xexecutor(xexecutor&&) = default;
+        xexecutor& operator=(xexecutor&&) = default;
+    };
+
+    /****************
+     * xthread_pool *
+     ****************/
+
+    /**
+     * @class xthread_pool
+     * @brief Work-stealing thread pool.
+     *
+     * Each worker thread owns a queue of tasks. The tasks of a batch are
+     * dealt to the queues in a round-robin fashion; a worker whose queue
+     * is empty steals tasks from the other queues. The thread submitting
+     * a batch also runs tasks until the batch is complete.
+     */
+    class xthread_pool : public xexecutor
+    {
+    public:
+
+        explicit xthread_pool(std::size_t nb_threads = default_num_threads());
+        ~xthread_pool() override;
+
+        xthread_pool(const xthread_pool&) = delete;
+        xthread_pool& operator=(const xthread_pool&) = delete;
+        xthread_pool(xthread_pool&&) = delete;
+        xthread_pool& operator=(xthread_pool&&) = delete;
+
+        std::size_t concurrency() const noexcept override;
+        void run(std::size_t nb_tasks, const task_type& task) override;
+
+        static std::size_t default_num_threads() noexcept;
+
+    private:
+
+        struct batch
+        {
+            const task_type* p_task;
+            std::size_t m_remaining;
+            std::exception_ptr m_error;
+            std::mutex m_mutex;
+            std::condition_variable m_done;
+        };
+
+        struct job
+        {
+            batch* p_batch;
+            std::size_t m_index;
+        };
+
+        struct job_queue
+        {
+            std::mutex m_mutex;
+            std::deque<job> m_jobs;
+        };
+
+        bool pop(std::size_t queue, job& j);
+        bool steal(std::size_t thief, job& j);
+        void execute(const job& j);
+        void work(std::size_t queue);
+
+        std::vector<std::unique_ptr<job_queue>> m_queues;
+        std::vector<std::thread> m_threads;
+        std::atomic<std::size_t> m_pending;
+        std::size_t m_next_queue;
+        bool m_stop;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+    };
+
+    xexecutor& get_executor() noexcept;
+    void set_executor(xexecutor* executor) noexcept;
+
+#endif
+
+    /****************
+     * parallel_for *
+     ****************/
+
+    std::size_t parallel_concurrency() noexcept;
+
+    template <class F>
+    void parallel_for(std::size_t size, std::size_t grain, F&& f);
+
+#ifdef XTENSOR_USE_THREADS
+
+    /*******************************
+     * xthread_pool implementation *
+     *******************************/
+
+    /**
+     * Builds a thread pool running tasks on \p nb_threads threads, including
+     * the thread submitting the tasks; nb_threads - 1 worker threads are started.
+     */
+    inline xthread_pool::xthread_pool(std::size_t nb_threads)
+        : m_pending(0), m_next_queue(0), m_stop(false)
+    {
+        std::size_t nb_workers = nb_threads > 1 ? nb_threads - 1 : 0;
+        m_queues.reserve(nb_workers);
+        for (std::size_t i = 0; i < nb_workers; ++i)
+        {
+            m_queues.push_back(std::make_unique<job_queue>());
+        }
+        m_threads.reserve(nb_workers);
+        try
+        {
+            for (std::size_t i = 0; i < nb_workers; ++i)
+            {
+                m_threads.emplace_back([this, i]() { work(i); });
+            }
+        }
+        catch (...)
+        {
+            // the destructor is not called, stop the workers already started
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_wake.notify_all();
+            for (auto& t : m_threads)
+            {
+                t.join();
+            }
+            throw;
+        }
+    }
+
+    inline xthread_pool::~xthread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& t : m_threads)
+        {
+            t.join();
+        }
+    }
+
+    inline std::size_t xthread_pool::concurrency() const noexcept
+    {
+        return m_threads.size() + 1;
+    }
+
+    inline void xthread_pool::run(std::size_t nb_tasks, const task_type& task)
+    {
+        batch b;
+        b.p_task = &task;
+        b.m_remaining = nb_tasks;
+
+        if (m_queues.empty())
+        {
+            for (std::size_t i = 0; i < nb_tasks; ++i)
+            {
+                execute(job{&b, i});
+            }
+        }
+        else
+        {
+            std::size_t first_queue;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                first_queue = m_next_queue;
+                m_next_queue = (m_next_queue + 1) % m_queues.size();
+                m_pending += nb_tasks;
+            }
+            for (std::size_t i = 0; i < nb_tasks; ++i)
+            {
+                job_queue& q = *m_queues[(first_queue + i) % m_queues.size()];
+                std::lock_guard<std::mutex> lock(q.m_mutex);
+                q.m_jobs.push_back(job{&b, i});
+            }
+            m_wake.notify_all();
+
+            // The calling thread helps until every task has been started
+            job j;
+            while (steal(m_queues.size(), j))
+            {
+                execute(j);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(b.m_mutex);
+        b.m_done.wait(lock, [&b]() { return b.m_remaining == 0; });
+        if (b.m_error)
+        {
+            std::rethrow_exception(b.m_error);
+        }
+    }
+
+    /**
+     * Returns the number of threads of the default pool: the value of the
+     * environment variable XTENSOR_NUM_THREADS if it is set to a positive
+     * integer, the number of hardware threads otherwise.
+     */
+    inline std::size_t xthread_pool::default_num_threads() noexcept
+    {
+        const char* env = std::getenv("XTENSOR_NUM_THREADS");
+        if (env != nullptr)
+        {
+            char* end = nullptr;
+            unsigned long res = std::strtoul(env, &end, 10);
+            if (end != env && res > 0)
+            {
+                return static_cast<std::size_t>(res);
+            }
+        }
+        std::size_t res = std::thread::hardware_concurrency();
+        return res == 0 ? std::size_t(1) : res;
+    }
+
+    inline bool xthread_pool::pop(std::size_t queue, job& j)
+    {
+        job_queue& q = *m_queues[queue];
+        std::lock_guard<std::mutex> lock(q.m_mutex);
+        if (q.m_jobs.empty())
+        {
+            return false;
+        }
+        j = q.m_jobs.back();
+        q.m_jobs.pop_back();
+        --m_pending;
+        return true;
+    }
+
+    inline bool xthread_pool::steal(std::size_t thief, job& j)
+    {
+        std::size_t nb_queues = m_queues.size();
+        for (std::size_t i = 1; i <= nb_queues; ++i)
+        {
+            job_queue& q = *m_queues[(thief + i) % nb_queues];
+            std::lock_guard<std::mutex> lock(q.m_mutex);
+            if (!q.m_jobs.empty())
+            {
+                j = q.m_jobs.front();
+                q.m_jobs.pop_front();
+                --m_pending;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline void xthread_pool::execute(const job& j)
+    {
+        batch& b = *j.p_batch;
+        std::exception_ptr error;
+        try
+        {
+            (*b.p_task)(j.m_index);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        // The batch lives on the stack of the submitting thread, which cannot
+        // return before this lock is released.
+        std::lock_guard<std::mutex> lock(b.m_mutex);
+        if (error && !b.m_error)
+        {
+            b.m_error = error;
+        }
+        if (--b.m_remaining == 0)
+        {
+            b.m_done.notify_all();
+        }
+    }
+
+    inline void xthread_pool::work(std::size_t queue)
+    {
+        job j;
+        while (true)
+        {
+            if (pop(queue, j) || steal(queue, j))
+            {
+                execute(j);
+            }
+            else
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this]() { return m_stop || m_pending.load() != 0; });
+                if (m_stop)
+                {
+                    return;
+                }
+            }
+        }
+    }
+
+    /***************************
+     * executor implementation *
+     ***************************/
+
+    namespace detail
+    {
+        inline std::atomic<xexecutor*>& user_executor() noexcept
+        {
+            static std::atomic<xexecutor*> executor(nullptr);
+            return executor;
+        }
+
+        inline bool& in_parallel_region() noexcept
+        {
+            static thread_local bool flag = false;
+            return flag;
+        }
+
+        class parallel_region_guard
+        {
+        public:
+
+            parallel_region_guard() noexcept
+                : m_previous(in_parallel_region())
+            {
+                in_parallel_region() = true;
+            }
+
+            ~parallel_region_guard()
+            {
+                in_parallel_region() = m_previous;
+            }
+
+            parallel_region_guard(const parallel_region_guard&) = delete;
+            parallel_region_guard& operator=(const parallel_region_guard&) = delete;
+
+        private:
+
+            bool m_previous;
+        };
+
+        // Runs the tasks on the calling thread, used when the threads of
+        // the default pool cannot be started.
+        class serial_executor : public xexecutor
+        {
+        public:
+
+            std::size_t concurrency() const noexcept override
+            {
+                return 1;
+            }
+
+            void run(std::size_t nb_tasks, const task_type& task) override
+            {
+                for (std::size_t i = 0; i < nb_tasks; ++i)
+                {
+                    task(i);
+                }
+            }
+        };
+
+        inline xexecutor* make_default_executor() noexcept
+        {
+            try
+            {
+                static xthread_pool pool;
+                return &pool;
+            }
+            catch (...)
+            {
+                static serial_executor serial;
+                return &serial;
+            }
+        }
+    }
+
+    /**
+     * Returns the executor used by the parallel kernels of xtensor: the
+     * executor passed to \ref set_executor if any, a default \ref xthread_pool
+     * otherwise. The default pool is started on first use; if its threads
+     * cannot be started, the parallel kernels run on the calling thread.
+     */
+    inline xexecutor& get_executor() noexcept
+    {
+        xexecutor* executor = detail::user_executor().load();
+        if (executor != nullptr)
+        {
+            return *executor;
+        }
+        static xexecutor* default_executor = detail::make_default_executor();
+        return *default_executor;
+    }
+
+    /**
+     * Sets the executor used by the parallel kernels of xtensor. The
+     * executor is not owned by xtensor and must outlive its use. Passing
+     * \c nullptr restores the default thread pool.
+     */
+    inline void set_executor(xexecutor* executor) noexcept
+    {
+        detail::user_executor().store(executor);
+    }
+
+#endif
+
+    /*******************************
+     * parallel_for implementation *
+     *******************************/
+
+    /**
+     * Returns the maximum number of threads used by the parallel kernels
+     * of xtensor. Returns 1 if \c XTENSOR_USE_THREADS is not defined or
+     * if called from a task of a parallel kernel.
+     */
+    inline std::size_t parallel_concurrency() noexcept
+    {
+#ifdef XTENSOR_USE_THREADS
+        return detail::in_parallel_region() ? std::size_t(1) : get_executor().concurrency();
+#else
+        return std::size_t(1);
+#endif
+    }
+
+    /**
+     * Splits the range [0, size) into contiguous chunks of at least \p grain
+     * indices and calls \p f(first, last) on each of them through the executor
+     * returned by \ref get_executor. If the range is too small to be split, or
+     * if parallel_for is called from a task of a parallel kernel, \p f(0, size)
+     * is called on the calling thread.
+     *
+     * @param size the size of the range
+     * @param grain the minimal number of indices processed by a single call to \p f
+     * @param f the function to call on each chunk
+     */
+    template <class F>
+    inline void parallel_for(std::size_t size, std::size_t grain, F&& f)
+    {
+        std::size_t nb_chunks = std::min(parallel_concurrency(), size / std::max(grain, std::size_t(1)));
+        if (nb_chunks < 2)
+        {
+            f(std::size_t(0), size);
+            return;
+        }
+#ifdef XTENSOR_USE_THREADS
+        std::size_t chunk_size = size / nb_chunks;
+        std::size_t remainder = size % nb_chunks;
+        auto chunk_begin = [chunk_size, remainder](std::size_t i) {
+            return i * chunk_size + std::min(i, remainder);
+        };
+        get_executor().run(nb_chunks, [&f, &chunk_begin](std::size_t i) {
+            detail::parallel_region_guard guard;
+            f(chunk_begin(i), chunk_begin(i + 1));
+        });
+#endif
+    }
+}
+
+#endif
@@ -13,12 +13,26 @@
 #ifndef XTENSOR_RANDOM_HPP
 #define XTENSOR_RANDOM_HPP
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
 #include <random>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "xarray.hpp"
 #include "xtensor.hpp"
 #include "xgenerator.hpp"
+#include "xnoalias.hpp"
+#include "xparallel.hpp"
+#include "xstrides.hpp"
 
 namespace xt
 {
@@ -31,6 +45,8 @@ namespace xt
         using default_engine_type = std::mt19937;
         using seed_type = default_engine_type::result_type;
 
+        class philox_engine;
+
         default_engine_type& get_default_random_engine();
         void seed(seed_type seed);
 
@@ -74,18 +90,296 @@ namespace xt
 #endif
 
         template <class T, class E = random::default_engine_type>
-        xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n,
+        xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n, bool replace = false,
                                                   E& engine = random::get_default_random_engine());
+
+        template <class T, class E,
+                  class = std::enable_if_t<!std::is_integral<E>::value && !is_xexpression<E>::value>>
+        xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n, E& engine);
+
+        template <class T, class W, class E = random::default_engine_type>
+        xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n, const xexpression<W>& weights,
+                                                  bool replace = false, E& engine = random::get_default_random_engine());
+
+        template <class T, class E = random::default_engine_type>
+        xarray<typename T::value_type> choice(const xexpression<T>& e, std::size_t n, bool replace, std::size_t axis,
+                                              E& engine = random::get_default_random_engine());
+
+        template <class T, class W, class E = random::default_engine_type>
+        xarray<typename T::value_type> choice(const xexpression<T>& e, std::size_t n, const xexpression<W>& weights,
+                                              bool replace, std::size_t axis,
+                                              E& engine = random::get_default_random_engine());
+
+        template <class T, class E = random::default_engine_type>
+        void shuffle(xexpression<T>& e, E& engine = random::get_default_random_engine());
+
+        template <class T, class E = random::default_engine_type>
+        void shuffle(xexpression<T>& e, std::size_t axis, E& engine = random::get_default_random_engine());
+
+        template <class T, class E = random::default_engine_type>
+        std::enable_if_t<std::is_integral<T>::value, xtensor<T, 1>>
+        permutation(T n, E& engine = random::get_default_random_engine());
+
+        template <class T, class E = random::default_engine_type>
+        xarray<typename T::value_type> permutation(const xexpression<T>& e, std::size_t axis = 0,
+                                                   E& engine = random::get_default_random_engine());
+    }
+
+    /*****************
+     * philox_engine *
+     *****************/
+
+    namespace random
+    {
+        /**
+         * @class philox_engine
+         * @brief Counter-based random number engine.
+         *
+         * The philox_engine class implements the Philox4x32-10 generator of
+         * J. Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"
+         * (SC 2011). The block of four 32-bit numbers at a given position is
+         * a function of the seed and of the position only, so that any block
+         * is computed independently of the others.
+         *
+         * The engine satisfies the requirements of the uniform random bit
+         * generators of the standard library, returning the numbers of the
+         * consecutive blocks. Random expressions built with a philox_engine
+         * compute their element of flat index \c i in row-major order from
+         * the block at position <tt>position() + i</tt> and advance the
+         * engine past their elements: their values do not depend on the
+         * order of evaluation, nor on how the evaluation is split across
+         * threads, and evaluating an expression twice gives the same values.
+         */
+        class philox_engine
+        {
+        public:
+
+            using result_type = std::uint32_t;
+            using block_type = std::array<std::uint32_t, 4>;
+            using key_type = std::array<std::uint32_t, 2>;
+
+            static constexpr std::uint64_t default_seed = 20111115u;
+
+            explicit philox_engine(std::uint64_t seed = default_seed) noexcept;
+
+            void seed(std::uint64_t seed) noexcept;
+
+            static constexpr result_type min() noexcept;
+            static constexpr result_type max() noexcept;
+
+            result_type operator()() noexcept;
+            void discard(unsigned long long n) noexcept;
+
+            block_type block(std::uint64_t position, std::uint64_t subposition = 0) const noexcept;
+            std::uint64_t position() const noexcept;
+            void advance(std::uint64_t nb_blocks) noexcept;
+
+            const key_type& key() const noexcept;
+
+            bool operator==(const philox_engine& rhs) const noexcept;
+            bool operator!=(const philox_engine& rhs) const noexcept;
+
+        private:
+
+            key_type m_key;
+            std::uint64_t m_position;
+            block_type m_block;
+            std::size_t m_word;
+        };
     }
 
     namespace detail
     {
-        template <class T>
+        inline std::uint32_t mulhilo32(std::uint32_t a, std::uint32_t b, std::uint32_t& hi) noexcept
+        {
+            std::uint64_t product = std::uint64_t(a) * std::uint64_t(b);
+            hi = static_cast<std::uint32_t>(product >> 32);
+            return static_cast<std::uint32_t>(product);
+        }
+
+        inline std::array<std::uint32_t, 4> philox4x32_10(std::array<std::uint32_t, 4> ctr,
+                                                          std::array<std::uint32_t, 2> key) noexcept
+        {
+            for (std::size_t round = 0; round != 10; ++round)
+            {
+                if (round != 0)
+                {
+                    key[0] += 0x9E3779B9u;
+                    key[1] += 0xBB67AE85u;
+                }
+                std::uint32_t hi0, hi1;
+                std::uint32_t lo0 = mulhilo32(0xD2511F53u, ctr[0], hi0);
+                std::uint32_t lo1 = mulhilo32(0xCD9E8D57u, ctr[2], hi1);
+                ctr = {{hi1 ^ ctr[1] ^ key[0], lo1, hi0 ^ ctr[3] ^ key[1], lo0}};
+            }
+            return ctr;
+        }
+
+        // Computes the blocks of subposition 0 at N consecutive positions.
+        // The rounds operate on arrays of lanes, which compilers vectorize.
+        template <std::size_t N>
+        inline void philox4x32_10_batch(std::uint64_t position, std::array<std::uint32_t, 2> key,
+                                        std::uint32_t (&ctr)[4][N]) noexcept
+        {
+            for (std::size_t l = 0; l != N; ++l)
+            {
+                ctr[0][l] = static_cast<std::uint32_t>(position + l);
+                ctr[1][l] = static_cast<std::uint32_t>((position + l) >> 32);
+                ctr[2][l] = 0;
+                ctr[3][l] = 0;
+            }
+            for (std::size_t round = 0; round != 10; ++round)
+            {
+                if (round != 0)
+                {
+                    key[0] += 0x9E3779B9u;
+                    key[1] += 0xBB67AE85u;
+                }
+                for (std::size_t l = 0; l != N; ++l)
+                {
+                    std::uint64_t p0 = std::uint64_t(0xD2511F53u) * ctr[0][l];
+                    std::uint64_t p1 = std::uint64_t(0xCD9E8D57u) * ctr[2][l];
+                    std::uint32_t c1 = ctr[1][l];
+                    std::uint32_t c3 = ctr[3][l];
+                    ctr[0][l] = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ key[0];
+                    ctr[1][l] = static_cast<std::uint32_t>(p1);
+                    ctr[2][l] = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ key[1];
+                    ctr[3][l] = static_cast<std::uint32_t>(p0);
+                }
+            }
+        }
+
+        // Upper 64 bits of the 128-bit product of a and b
+        inline std::uint64_t mulhi64(std::uint64_t a, std::uint64_t b) noexcept
+        {
+            constexpr std::uint64_t mask = 0xFFFFFFFFu;
+            std::uint64_t a_lo = a & mask, a_hi = a >> 32;
+            std::uint64_t b_lo = b & mask, b_hi = b >> 32;
+            std::uint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi;
+            std::uint64_t p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+            std::uint64_t middle = (p0 >> 32) + (p1 & mask) + (p2 & mask);
+            return p3 + (p1 >> 32) + (p2 >> 32) + (middle >> 32);
+        }
+    }
+
+    namespace random
+    {
+        /**
+         * Builds an engine whose key is @p seed, at position 0.
+         */
+        inline philox_engine::philox_engine(std::uint64_t seed) noexcept
+        {
+            this->seed(seed);
+        }
+
+        /**
+         * Sets the key of the engine to @p seed and its position to 0.
+         */
+        inline void philox_engine::seed(std::uint64_t seed) noexcept
+        {
+            m_key = {{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)}};
+            m_position = 0;
+            m_word = m_block.size();
+        }
+
+        constexpr auto philox_engine::min() noexcept -> result_type
+        {
+            return 0;
+        }
+
+        constexpr auto philox_engine::max() noexcept -> result_type
+        {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        /**
+         * Returns the next number of the current block, or the first one
+         * of the block at position() when the current block is exhausted.
+         */
+        inline auto philox_engine::operator()() noexcept -> result_type
+        {
+            if (m_word == m_block.size())
+            {
+                m_block = block(m_position++);
+                m_word = 0;
+            }
+            return m_block[m_word++];
+        }
+
+        /**
+         * Skips @p n numbers.
+         */
+        inline void philox_engine::discard(unsigned long long n) noexcept
+        {
+            for (; n != 0 && m_word != m_block.size(); --n)
+            {
+                ++m_word;
+            }
+            m_position += n / m_block.size();
+            std::size_t remainder = static_cast<std::size_t>(n % m_block.size());
+            if (remainder != 0)
+            {
+                m_block = block(m_position++);
+                m_word = remainder;
+            }
+        }
+
+        /**
+         * Returns the block at @p position, without changing the state of
+         * the engine. The numbers of the engine are the blocks of
+         * subposition 0; random expressions draw from the blocks of the
+         * following subpositions when an element needs more numbers.
+         */
+        inline auto philox_engine::block(std::uint64_t position, std::uint64_t subposition) const noexcept -> block_type
+        {
+            return detail::philox4x32_10({{static_cast<std::uint32_t>(position), static_cast<std::uint32_t>(position >> 32),
+                                           static_cast<std::uint32_t>(subposition), static_cast<std::uint32_t>(subposition >> 32)}},
+                                         m_key);
+        }
+
+        inline auto philox_engine::key() const noexcept -> const key_type&
+        {
+            return m_key;
+        }
+
+        /**
+         * Returns the position of the next block used by the engine. The
+         * numbers left in the current block, if any, precede it.
+         */
+        inline std::uint64_t philox_engine::position() const noexcept
+        {
+            return m_position;
+        }
+
+        /**
+         * Skips the numbers left in the current block and @p nb_blocks blocks.
+         */
+        inline void philox_engine::advance(std::uint64_t nb_blocks) noexcept
+        {
+            m_position += nb_blocks;
+            m_word = m_block.size();
+        }
+
+        inline bool philox_engine::operator==(const philox_engine& rhs) const noexcept
+        {
+            return m_key == rhs.m_key && m_position == rhs.m_position &&
+                (m_word == m_block.size() ? rhs.m_word == m_block.size() : m_word == rhs.m_word && m_block == rhs.m_block);
+        }
+
+        inline bool philox_engine::operator!=(const philox_engine& rhs) const noexcept
+        {
+            return !(*this == rhs);
+        }
+    }
+
+    namespace detail
+    {
+        template <class T, class G>
         struct random_impl
         {
             using value_type = T;
 
-            random_impl(std::function<value_type()>&& generator)
+            random_impl(G&& generator)
                 : m_generator(std::move(generator))
             {
             }
@@ -99,12 +393,720 @@ namespace xt
             template <class It>
             inline value_type element(It, It) const
             {
-                return m_generator();
+                return operator()();
+            }
+
+            // The elements are drawn in order from the engine, which is
+            // shared by the elements; their indices are irrelevant.
+            template <class It>
+            inline void fill(It out, std::size_t, std::size_t n) const
+            {
+                for (std::size_t i = 0; i != n; ++i, ++out)
+                {
+                    *out = m_generator();
+                }
             }
 
         private:
-            std::function<value_type()> m_generator;
+
+            // standard distributions are stateful
+            mutable G m_generator;
+        };
+
+        // The elements are drawn in the order of the assignment, which
+        // must not be split across threads.
+        template <class T, class G>
+        struct is_splittable<random_impl<T, G>> : std::false_type
+        {
+        };
+
+        /***********************
+         * counter-based draws *
+         ***********************/
+
+        // The samplers compute a random number from a block of a philox_engine
+
+        inline double uniform_double(std::uint32_t hi, std::uint32_t lo) noexcept
+        {
+            // 53 random bits in [0, 1)
+            return static_cast<double>(((std::uint64_t(hi) << 32) | lo) >> 11) * (1. / 9007199254740992.);
+        }
+
+        template <class T>
+        struct uniform_real_sampler
+        {
+            T m_lower;
+            T m_upper;
+
+            inline T operator()(const random::philox_engine::block_type& b, const random::philox_engine&, std::uint64_t) const noexcept
+            {
+                // 24 random bits for floats, 53 for the other types
+                T u = std::is_same<T, float>::value ? static_cast<T>(b[0] >> 8) * T(1. / 16777216.)
+                                                    : static_cast<T>(uniform_double(b[0], b[1]));
+                return m_lower + (m_upper - m_lower) * u;
+            }
+        };
+
+        // Draws from [lower, lower + range) by multiplying range with a
+        // 64-bit number; the bias is smaller than range / 2^64.
+        template <class T>
+        struct uniform_int_sampler
+        {
+            using unsigned_type = std::make_unsigned_t<T>;
+
+            T m_lower;
+            std::uint64_t m_range;
+
+            inline T operator()(const random::philox_engine::block_type& b, const random::philox_engine&, std::uint64_t) const noexcept
+            {
+                std::uint64_t offset = mulhi64((std::uint64_t(b[0]) << 32) | b[1], m_range);
+                return static_cast<T>(static_cast<unsigned_type>(static_cast<unsigned_type>(m_lower) + static_cast<unsigned_type>(offset)));
+            }
         };
+
+        // Tables of the ziggurat of G. Marsaglia and W. W. Tsang, "The
+        // Ziggurat Method for Generating Random Variables" (2000), with
+        // 256 layers and 52-bit abscissae.
+        struct normal_ziggurat
+        {
+            static constexpr double r = 3.6541528853610088;
+            static constexpr double v = 4.92867323399e-3;
+
+            std::uint64_t k[256];
+            double w[256];
+            double f[256];
+
+            normal_ziggurat() noexcept
+            {
+                constexpr double m = 4503599627370496.;  // 2^52
+                double dn = r;
+                double tn = dn;
+                double q = v / std::exp(-0.5 * dn * dn);
+                k[0] = static_cast<std::uint64_t>((dn / q) * m);
+                k[1] = 0;
+                w[0] = q / m;
+                w[255] = dn / m;
+                f[0] = 1.;
+                f[255] = std::exp(-0.5 * dn * dn);
+                for (std::size_t i = 254; i != 0; --i)
+                {
+                    dn = std::sqrt(-2. * std::log(v / dn + std::exp(-0.5 * dn * dn)));
+                    k[i + 1] = static_cast<std::uint64_t>((dn / tn) * m);
+                    tn = dn;
+                    f[i] = std::exp(-0.5 * dn * dn);
+                    w[i] = dn / m;
+                }
+            }
+
+            static const normal_ziggurat& get() noexcept
+            {
+                static const normal_ziggurat tables;
+                return tables;
+            }
+        };
+
+        // Draws from the normal distribution with the ziggurat. The first
+        // try uses a block; the few rejected tries and the tail draw from
+        // the blocks of the following subpositions of the same position.
+        struct normal_sampler_base
+        {
+            inline static double draw(const random::philox_engine::block_type& b, const random::philox_engine& engine,
+                                      std::uint64_t position, const normal_ziggurat& z) noexcept
+            {
+                std::uint64_t bits = (std::uint64_t(b[0]) << 32) | b[1];
+                std::size_t layer = static_cast<std::size_t>(bits & 0xFF);
+                std::uint64_t abscissa = (bits >> 9) & 0x000FFFFFFFFFFFFFull;
+                double x = static_cast<double>(abscissa) * z.w[layer];
+                if (abscissa < z.k[layer])
+                {
+                    return (bits & 0x100) != 0 ? -x : x;
+                }
+                return draw_slow(b, engine, position, z);
+            }
+
+            // The rejected tries draw from the blocks of the following
+            // subpositions of the same position.
+            static double draw_slow(random::philox_engine::block_type b, const random::philox_engine& engine,
+                                    std::uint64_t position, const normal_ziggurat& z) noexcept
+            {
+                for (std::uint64_t subposition = 1;; ++subposition)
+                {
+                    std::uint64_t bits = (std::uint64_t(b[0]) << 32) | b[1];
+                    std::size_t layer = static_cast<std::size_t>(bits & 0xFF);
+                    bool negative = (bits & 0x100) != 0;
+                    std::uint64_t abscissa = (bits >> 9) & 0x000FFFFFFFFFFFFFull;
+                    double x = static_cast<double>(abscissa) * z.w[layer];
+                    if (abscissa < z.k[layer])
+                    {
+                        return negative ? -x : x;
+                    }
+                    if (layer == 0)
+                    {
+                        // the tail beyond r, by the method of Marsaglia (1964)
+                        for (;; ++subposition)
+                        {
+                            b = engine.block(position, subposition);
+                            double xx = -std::log1p(-uniform_double(b[0], b[1])) / normal_ziggurat::r;
+                            double yy = -std::log1p(-uniform_double(b[2], b[3]));
+                            if (yy + yy > xx * xx)
+                            {
+                                return negative ? -(normal_ziggurat::r + xx) : normal_ziggurat::r + xx;
+                            }
+                        }
+                    }
+                    double u = uniform_double(b[2], b[3]);
+                    if (z.f[layer] + u * (z.f[layer - 1] - z.f[layer]) < std::exp(-0.5 * x * x))
+                    {
+                        return negative ? -x : x;
+                    }
+                    b = engine.block(position, subposition);
+                }
+            }
+        };
+
+        template <class T>
+        struct normal_sampler : normal_sampler_base
+        {
+            T m_mean;
+            T m_std_dev;
+            const normal_ziggurat* p_ziggurat;
+
+            normal_sampler(T mean, T std_dev) noexcept
+                : m_mean(mean), m_std_dev(std_dev), p_ziggurat(&normal_ziggurat::get())
+            {
+            }
+
+            inline T operator()(const random::philox_engine::block_type& b, const random::philox_engine& engine,
+                                std::uint64_t position) const noexcept
+            {
+                double z = draw(b, engine, position, *p_ziggurat);
+                return m_mean + m_std_dev * static_cast<T>(z);
+            }
+        };
+
+        template <class T, class D>
+        class counter_random_impl
+        {
+        public:
+
+            using value_type = T;
+
+            template <class S>
+            counter_random_impl(const S& shape, random::philox_engine& engine, D sampler)
+                : m_engine(engine), m_position(engine.position()), m_sampler(sampler),
+                  m_strides(std::begin(shape), std::end(shape))
+            {
+                // row-major strides, computed in place of the shape
+                std::uint64_t size = 1;
+                for (auto it = m_strides.rbegin(); it != m_strides.rend(); ++it)
+                {
+                    std::uint64_t extent = *it;
+                    *it = size;
+                    size *= extent;
+                }
+                engine.advance(size);
+            }
+
+            template <class... Args>
+            inline value_type operator()(Args... args) const
+            {
+                return draw(data_offset<std::uint64_t>(m_strides, static_cast<std::uint64_t>(args)...));
+            }
+
+            template <class It>
+            inline value_type element(It first, It last) const
+            {
+                return draw(element_offset<std::uint64_t>(m_strides, first, last));
+            }
+
+            // The elements are computed by batches of consecutive blocks
+            // in parallel, with the same values as the element-wise access.
+            template <class It>
+            inline void fill(It out, std::size_t first, std::size_t n) const
+            {
+                constexpr std::size_t batch_size = 8;
+                std::size_t nb_batches = (n + batch_size - 1) / batch_size;
+                parallel_for(nb_batches, assign_grain(nb_batches, 16 * batch_size), [&](std::size_t fb, std::size_t lb) {
+                    std::uint32_t ctr[4][batch_size];
+                    random::philox_engine::block_type b;
+                    for (std::size_t batch = fb; batch != lb; ++batch)
+                    {
+                        std::size_t begin = batch * batch_size;
+                        std::size_t size = std::min(batch_size, n - begin);
+                        std::uint64_t position = m_position + first + begin;
+                        philox4x32_10_batch(position, m_engine.key(), ctr);
+                        It it = out + static_cast<std::ptrdiff_t>(begin);
+                        for (std::size_t l = 0; l != size; ++l, ++it)
+                        {
+                            b = {{ctr[0][l], ctr[1][l], ctr[2][l], ctr[3][l]}};
+                            *it = m_sampler(b, m_engine, position + l);
+                        }
+                    }
+                });
+            }
+
+        private:
+
+            inline value_type draw(std::uint64_t index) const noexcept
+            {
+                std::uint64_t position = m_position + index;
+                return m_sampler(m_engine.block(position), m_engine, position);
+            }
+
+            random::philox_engine m_engine;
+            std::uint64_t m_position;
+            D m_sampler;
+            std::vector<std::uint64_t> m_strides;
+        };
+
+        // Random expressions draw from standard distributions with the
+        // engine shared by their elements, or from the blocks of a
+        // counter-based engine.
+        template <class T, class S, class E, class D, class C>
+        inline auto make_random_xgenerator(const S& shape, E& engine, D dist, C)
+        {
+            using generator_type = decltype(std::bind(dist, std::ref(engine)));
+            return make_xgenerator(random_impl<T, generator_type>(std::bind(dist, std::ref(engine))), shape);
+        }
+
+        template <class T, class S, class D, class C>
+        inline auto make_random_xgenerator(const S& shape, random::philox_engine& engine, D, C sampler)
+        {
+            return make_xgenerator(counter_random_impl<T, C>(shape, engine, sampler), shape);
+        }
+
+        template <class T, class S, class E>
+        inline auto make_rand(const S& shape, T lower, T upper, E& engine)
+        {
+            return make_random_xgenerator<T>(shape, engine, std::uniform_real_distribution<T>(lower, upper),
+                                             uniform_real_sampler<T>{lower, upper});
+        }
+
+        template <class T, class S, class E>
+        inline auto make_randint(const S& shape, T lower, T upper, E& engine)
+        {
+            using unsigned_type = std::make_unsigned_t<T>;
+            std::uint64_t range = static_cast<unsigned_type>(static_cast<unsigned_type>(upper) - static_cast<unsigned_type>(lower));
+            return make_random_xgenerator<T>(shape, engine, std::uniform_int_distribution<T>(lower, upper - 1),
+                                             uniform_int_sampler<T>{lower, range});
+        }
+
+        template <class T, class S, class E>
+        inline auto make_randn(const S& shape, T mean, T std_dev, E& engine)
+        {
+            return make_random_xgenerator<T>(shape, engine, std::normal_distribution<T>(mean, std_dev),
+                                             normal_sampler<T>(mean, std_dev));
+        }
+
+        /******************
+         * random choices *
+         ******************/
+
+        // Without replacement, the sampled indices are the first n steps of a
+        // Fisher-Yates shuffle of the indices. When n is small compared to the
+        // size, only the swapped indices are stored, in a hash map, so that
+        // the sample costs O(n) whatever the size.
+        constexpr std::size_t choice_sparse_ratio = 16;
+
+        template <class E>
+        inline std::vector<std::size_t> choice_indices(std::size_t size, std::size_t n, bool replace, E& engine)
+        {
+            using param_type = std::uniform_int_distribution<std::size_t>::param_type;
+            std::uniform_int_distribution<std::size_t> dist;
+            std::vector<std::size_t> indices(n);
+            if (n == 0)
+            {
+                return indices;
+            }
+            if (replace)
+            {
+                param_type param(0, size - 1);
+                for (auto& i : indices)
+                {
+                    i = dist(engine, param);
+                }
+            }
+            else if (n * choice_sparse_ratio < size)
+            {
+                std::unordered_map<std::size_t, std::size_t> swapped;
+                swapped.reserve(2 * n);
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    std::size_t j = dist(engine, param_type(i, size - 1));
+                    auto it = swapped.find(j);
+                    std::size_t picked = it != swapped.end() ? it->second : j;
+                    it = swapped.find(i);
+                    swapped[j] = it != swapped.end() ? it->second : i;
+                    indices[i] = picked;
+                }
+            }
+            else
+            {
+                std::vector<std::size_t> all(size);
+                std::iota(all.begin(), all.end(), std::size_t(0));
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    std::swap(all[i], all[dist(engine, param_type(i, size - 1))]);
+                }
+                std::copy(all.cbegin(), all.cbegin() + std::ptrdiff_t(n), indices.begin());
+            }
+            return indices;
+        }
+
+        // Alias table of Walker, built with the method of Vose: every draw
+        // costs one uniform index and one uniform number, whatever the
+        // distribution of the weights.
+        class alias_table
+        {
+        public:
+
+            explicit alias_table(const std::vector<double>& weights);
+
+            template <class E>
+            std::size_t operator()(E& engine) const;
+
+        private:
+
+            std::vector<double> m_probability;
+            std::vector<std::size_t> m_alias;
+        };
+
+        inline alias_table::alias_table(const std::vector<double>& weights)
+            : m_probability(weights.size(), 1.), m_alias(weights.size())
+        {
+            std::size_t size = weights.size();
+            double total = std::accumulate(weights.cbegin(), weights.cend(), 0.);
+            std::vector<double> scaled(size);
+            std::vector<std::size_t> small, large;
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                scaled[i] = weights[i] * double(size) / total;
+                m_alias[i] = i;
+                (scaled[i] < 1. ? small : large).push_back(i);
+            }
+            while (!small.empty() && !large.empty())
+            {
+                std::size_t s = small.back();
+                std::size_t l = large.back();
+                small.pop_back();
+                m_probability[s] = scaled[s];
+                m_alias[s] = l;
+                scaled[l] = (scaled[l] + scaled[s]) - 1.;
+                if (scaled[l] < 1.)
+                {
+                    large.pop_back();
+                    small.push_back(l);
+                }
+            }
+        }
+
+        template <class E>
+        inline std::size_t alias_table::operator()(E& engine) const
+        {
+            std::uniform_int_distribution<std::size_t> index(0, m_alias.size() - 1);
+            std::uniform_real_distribution<double> coin;
+            std::size_t i = index(engine);
+            return coin(engine) < m_probability[i] ? i : m_alias[i];
+        }
+
+        // With weights and without replacement, the sample is made of the n
+        // smallest keys E_i / w_i where the E_i are exponential variables,
+        // which orders the indices as successive weighted draws would.
+        template <class E>
+        inline std::vector<std::size_t> choice_indices(const std::vector<double>& weights, std::size_t n,
+                                                       bool replace, E& engine)
+        {
+            std::vector<std::size_t> indices;
+            if (n == 0)
+            {
+                return indices;
+            }
+            if (replace)
+            {
+                alias_table table(weights);
+                indices.resize(n);
+                for (auto& i : indices)
+                {
+                    i = table(engine);
+                }
+            }
+            else
+            {
+                XTENSOR_ASSERT(std::size_t(std::count_if(weights.cbegin(), weights.cend(), [](double w) { return w > 0.; })) >= n);
+                std::exponential_distribution<double> exponential;
+                std::vector<double> keys(weights.size());
+                for (std::size_t i = 0; i < keys.size(); ++i)
+                {
+                    double key = exponential(engine);
+                    keys[i] = weights[i] > 0. ? key / weights[i] : std::numeric_limits<double>::infinity();
+                }
+                indices.resize(weights.size());
+                std::iota(indices.begin(), indices.end(), std::size_t(0));
+                std::partial_sort(indices.begin(), indices.begin() + std::ptrdiff_t(n), indices.end(),
+                                  [&keys](std::size_t i, std::size_t j) { return keys[i] < keys[j]; });
+                indices.resize(n);
+            }
+            return indices;
+        }
+
+        template <class W>
+        inline std::vector<double> choice_weights(const xexpression<W>& weights, std::size_t size)
+        {
+            const auto& dw = weights.derived_cast();
+            XTENSOR_ASSERT(dw.dimension() == 1);
+            XTENSOR_ASSERT(dw.size() == size);
+            (void)size;
+            std::vector<double> res(dw.cbegin(), dw.cend());
+            XTENSOR_ASSERT(std::all_of(res.cbegin(), res.cend(), [](double w) { return w >= 0.; }));
+            return res;
+        }
+
+        // Copies the slices of e along axis at the sampled indices into the
+        // row-major storage of res. The slices of contiguous row-major
+        // containers are copied as runs of elements, in parallel.
+        template <class R, class E>
+        inline void choice_gather(R& res, const E& e, std::size_t axis, const std::vector<std::size_t>& indices,
+                                  std::false_type)
+        {
+            const auto& shape = res.shape();
+            std::size_t dimension = shape.size();
+            xindex index(dimension, 0);
+            xindex source(dimension, 0);
+            auto out = res.data().begin();
+            if (res.size() == 0)
+            {
+                return;
+            }
+            source[axis] = indices[0];
+            for (std::size_t k = 0; k < res.size(); ++k, ++out)
+            {
+                *out = e.element(source.cbegin(), source.cend());
+                for (std::size_t d = dimension; d-- != 0;)
+                {
+                    if (++index[d] != shape[d])
+                    {
+                        source[d] = d == axis ? indices[index[d]] : index[d];
+                        break;
+                    }
+                    index[d] = 0;
+                    source[d] = d == axis ? indices[0] : 0;
+                }
+            }
+        }
+
+        template <class R, class E>
+        inline void choice_gather(R& res, const E& e, std::size_t axis, const std::vector<std::size_t>& indices,
+                                  std::true_type)
+        {
+            if (e.layout() != layout_type::row_major && e.dimension() > 1)
+            {
+                choice_gather(res, e, axis, indices, std::false_type());
+                return;
+            }
+            const auto& shape = e.shape();
+            std::size_t outer = std::accumulate(shape.cbegin(), shape.cbegin() + std::ptrdiff_t(axis), std::size_t(1),
+                                                std::multiplies<std::size_t>());
+            std::size_t inner = std::accumulate(shape.cbegin() + std::ptrdiff_t(axis) + 1, shape.cend(), std::size_t(1),
+                                                std::multiplies<std::size_t>());
+            std::size_t size = shape[axis];
+            std::size_t n = indices.size();
+            auto in = e.raw_data() + e.raw_data_offset();
+            auto out = res.data().begin();
+            parallel_for(outer * n, assign_grain(outer * n, inner), [&](std::size_t first, std::size_t last) {
+                for (std::size_t k = first; k != last; ++k)
+                {
+                    std::size_t o = k / n;
+                    auto src = in + std::ptrdiff_t((o * size + indices[k - o * n]) * inner);
+                    std::copy(src, src + std::ptrdiff_t(inner), out + std::ptrdiff_t(k * inner));
+                }
+            });
+        }
+
+        template <class R, class E>
+        inline void choice_gather(R& res, const E& e, std::size_t axis, const std::vector<std::size_t>& indices)
+        {
+            using direct = std::integral_constant<bool, E::contiguous_layout && has_raw_data_interface<E>::value>;
+            choice_gather(res, e, axis, indices, direct());
+        }
+
+        template <class T>
+        inline auto choice_container(const T& e, std::size_t n, std::size_t axis)
+        {
+            XTENSOR_ASSERT(axis < e.dimension());
+            typename xarray<typename T::value_type>::shape_type shape(e.shape().cbegin(), e.shape().cend());
+            shape[axis] = n;
+            return xarray<typename T::value_type>(shape);
+        }
+
+        /***********************
+         * random permutations *
+         ***********************/
+
+        // A counter-based engine permutes its items in parallel by scattering
+        // them to random buckets, keeping their order within a bucket, and by
+        // shuffling every bucket, which fits in cache. The bucket of the item
+        // i and the k-th draw of the bucket starting at the offset o of the
+        // output use the halves i and n + o + k of the blocks, so that the
+        // permutation only depends on the seed, whatever the number of threads.
+        constexpr std::size_t shuffle_bucket_size = std::size_t(1) << 15;
+
+        // Sequence of 64-bit draws made of the halves of consecutive blocks,
+        // computed by batches.
+        class shuffle_stream
+        {
+        public:
+
+            shuffle_stream(const random::philox_engine& engine, std::uint64_t first) noexcept
+                : m_key(engine.key()), m_base(engine.position()), m_next(first), m_first(first), m_last(first)
+            {
+            }
+
+            std::uint64_t operator()() noexcept
+            {
+                if (m_next == m_last)
+                {
+                    m_first = m_next & ~std::uint64_t(1);
+                    m_last = m_first + 2 * batch_size;
+                    std::uint32_t ctr[4][batch_size];
+                    philox4x32_10_batch(m_base + m_first / 2, m_key, ctr);
+                    for (std::size_t l = 0; l != batch_size; ++l)
+                    {
+                        m_draws[2 * l] = (std::uint64_t(ctr[0][l]) << 32) | ctr[1][l];
+                        m_draws[2 * l + 1] = (std::uint64_t(ctr[2][l]) << 32) | ctr[3][l];
+                    }
+                }
+                return m_draws[m_next++ - m_first];
+            }
+
+        private:
+
+            static constexpr std::size_t batch_size = 8;
+
+            random::philox_engine::key_type m_key;
+            std::uint64_t m_base;
+            std::uint64_t m_next;
+            std::uint64_t m_first;
+            std::uint64_t m_last;
+            std::uint64_t m_draws[2 * batch_size];
+        };
+
+        template <class F, class It>
+        inline void counter_shuffle(std::size_t n, F item, It out, random::philox_engine& engine)
+        {
+            std::size_t nb_buckets = std::max(n / shuffle_bucket_size, std::size_t(1));
+            std::vector<std::size_t> bounds(nb_buckets + 1, 0);
+            if (nb_buckets == 1)
+            {
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    out[std::ptrdiff_t(i)] = item(i);
+                }
+                bounds[1] = n;
+            }
+            else
+            {
+                std::size_t nb_chunks = std::min(4 * parallel_concurrency(), nb_buckets);
+                std::size_t chunk_size = ((n + nb_chunks - 1) / nb_chunks + 1) & ~std::size_t(1);
+                nb_chunks = (n + chunk_size - 1) / chunk_size;
+                std::vector<std::size_t> offsets(nb_chunks * nb_buckets, 0);
+                parallel_for(nb_chunks, 1, [&](std::size_t first, std::size_t last) {
+                    for (std::size_t c = first; c != last; ++c)
+                    {
+                        std::size_t* count = offsets.data() + c * nb_buckets;
+                        shuffle_stream stream(engine, c * chunk_size);
+                        for (std::size_t i = c * chunk_size; i < std::min((c + 1) * chunk_size, n); ++i)
+                        {
+                            ++count[mulhi64(stream(), nb_buckets)];
+                        }
+                    }
+                });
+                std::size_t total = 0;
+                for (std::size_t b = 0; b < nb_buckets; ++b)
+                {
+                    bounds[b] = total;
+                    for (std::size_t c = 0; c < nb_chunks; ++c)
+                    {
+                        std::size_t count = offsets[c * nb_buckets + b];
+                        offsets[c * nb_buckets + b] = total;
+                        total += count;
+                    }
+                }
+                bounds[nb_buckets] = total;
+                parallel_for(nb_chunks, 1, [&](std::size_t first, std::size_t last) {
+                    for (std::size_t c = first; c != last; ++c)
+                    {
+                        std::size_t* offset = offsets.data() + c * nb_buckets;
+                        shuffle_stream stream(engine, c * chunk_size);
+                        for (std::size_t i = c * chunk_size; i < std::min((c + 1) * chunk_size, n); ++i)
+                        {
+                            out[std::ptrdiff_t(offset[mulhi64(stream(), nb_buckets)]++)] = item(i);
+                        }
+                    }
+                });
+            }
+            parallel_for(nb_buckets, 1, [&](std::size_t first, std::size_t last) {
+                for (std::size_t b = first; b != last; ++b)
+                {
+                    shuffle_stream stream(engine, n + bounds[b]);
+                    for (std::size_t k = bounds[b + 1] - bounds[b]; k > 1; --k)
+                    {
+                        std::size_t j = static_cast<std::size_t>(mulhi64(stream(), k));
+                        using std::swap;
+                        swap(out[std::ptrdiff_t(bounds[b] + k - 1)], out[std::ptrdiff_t(bounds[b] + j)]);
+                    }
+                }
+            });
+            engine.advance(n);
+        }
+
+        template <class It, class E>
+        inline void permutation_fill(It out, std::size_t n, E& engine)
+        {
+            using value_type = typename std::iterator_traits<It>::value_type;
+            std::iota(out, out + std::ptrdiff_t(n), value_type(0));
+            std::shuffle(out, out + std::ptrdiff_t(n), engine);
+        }
+
+        template <class It>
+        inline void permutation_fill(It out, std::size_t n, random::philox_engine& engine)
+        {
+            using value_type = typename std::iterator_traits<It>::value_type;
+            counter_shuffle(n, [](std::size_t i) { return static_cast<value_type>(i); }, out, engine);
+        }
+
+        template <class E>
+        inline std::vector<std::size_t> permutation_indices(std::size_t n, E& engine)
+        {
+            std::vector<std::size_t> res(n);
+            permutation_fill(res.begin(), n, engine);
+            return res;
+        }
+
+        // The elements of a contiguous 1-D container are shuffled directly,
+        // the slices of other expressions are gathered in a temporary.
+        template <class T, class E>
+        inline void shuffle_impl(T& e, std::size_t, E& engine, std::true_type)
+        {
+            auto first = e.raw_data() + e.raw_data_offset();
+            std::shuffle(first, first + std::ptrdiff_t(e.size()), engine);
+        }
+
+        template <class T>
+        inline void shuffle_impl(T& e, std::size_t, random::philox_engine& engine, std::true_type)
+        {
+            auto first = e.raw_data() + e.raw_data_offset();
+            std::vector<typename T::value_type> tmp(e.size());
+            counter_shuffle(e.size(), [first](std::size_t i) { return first[std::ptrdiff_t(i)]; }, tmp.begin(), engine);
+            std::copy(tmp.cbegin(), tmp.cend(), first);
+        }
+
+        template <class T, class E>
+        inline void shuffle_impl(T& e, std::size_t axis, E& engine, std::false_type)
+        {
+            auto tmp = choice_container(e, e.shape()[axis], axis);
+            choice_gather(tmp, e, axis, permutation_indices(e.shape()[axis], engine));
+            noalias(e) = tmp;
+        }
     }
 
     namespace random
@@ -131,7 +1133,8 @@ namespace xt
          * xexpression with specified @p shape containing uniformly distributed random numbers
          * in the interval from @p lower to @p upper, excluding upper.
          *
-         * Numbers are drawn from @c std::uniform_real_distribution.
+         * Numbers are drawn from @c std::uniform_real_distribution, or from the
+         * blocks of the engine if it is a \ref philox_engine.
          *
          * @param shape shape of resulting xexpression
          * @param lower lower bound
@@ -142,15 +1145,15 @@ namespace xt
         template <class T, class S, class E>
         inline auto rand(const S& shape, T lower, T upper, E& engine)
         {
-            std::uniform_real_distribution<T> dist(lower, upper);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_rand(shape, lower, upper, engine);
         }
 
         /**
          * xexpression with specified @p shape containing uniformly distributed
          * random integers in the interval from @p lower to @p upper, excluding upper.
          *
-         * Numbers are drawn from @c std::uniform_int_distribution.
+         * Numbers are drawn from @c std::uniform_int_distribution, or from the
+         * blocks of the engine if it is a \ref philox_engine.
          *
          * @param shape shape of resulting xexpression
          * @param lower lower bound
@@ -161,8 +1164,7 @@ namespace xt
         template <class T, class S, class E>
         inline auto randint(const S& shape, T lower, T upper, E& engine)
         {
-            std::uniform_int_distribution<T> dist(lower, upper - 1);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_randint(shape, lower, upper, engine);
         }
 
         /**
@@ -170,7 +1172,8 @@ namespace xt
          * the Normal (Gaussian) random number distribution with mean @p mean and
          * standard deviation @p std_dev.
          *
-         * Numbers are drawn from @c std::normal_distribution.
+         * Numbers are drawn from @c std::normal_distribution, or from the
+         * blocks of the engine if it is a \ref philox_engine.
          *
          * @param shape shape of resulting xexpression
          * @param mean mean of normal distribution
@@ -181,82 +1184,243 @@ namespace xt
         template <class T, class S, class E>
         inline auto randn(const S& shape, T mean, T std_dev, E& engine)
         {
-            std::normal_distribution<T> dist(mean, std_dev);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_randn(shape, mean, std_dev, engine);
         }
 
 #ifdef X_OLD_CLANG
         template <class T, class I, class E>
         inline auto rand(std::initializer_list<I> shape, T lower, T upper, E& engine)
         {
-            std::uniform_real_distribution<T> dist(lower, upper);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_rand(shape, lower, upper, engine);
         }
 
         template <class T, class I, class E>
         inline auto randint(std::initializer_list<I> shape, T lower, T upper, E& engine)
         {
-            std::uniform_int_distribution<T> dist(lower, upper - 1);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_randint(shape, lower, upper, engine);
         }
 
         template <class T, class I, class E>
         inline auto randn(std::initializer_list<I> shape, T mean, T std_dev, E& engine)
         {
-            std::normal_distribution<T> dist(mean, std_dev);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_randn(shape, mean, std_dev, engine);
         }
 #else
         template <class T, class I, std::size_t L, class E>
         inline auto rand(const I (&shape)[L], T lower, T upper, E& engine)
         {
-            std::uniform_real_distribution<T> dist(lower, upper);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_rand(shape, lower, upper, engine);
         }
 
         template <class T, class I, std::size_t L, class E>
         inline auto randint(const I (&shape)[L], T lower, T upper, E& engine)
         {
-            std::uniform_int_distribution<T> dist(lower, upper - 1);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_randint(shape, lower, upper, engine);
         }
 
         template <class T, class I, std::size_t L, class E>
         inline auto randn(const I (&shape)[L], T mean, T std_dev, E& engine)
         {
-            std::normal_distribution<T> dist(mean, std_dev);
-            return detail::make_xgenerator(detail::random_impl<T>(std::bind(dist, std::ref(engine))), shape);
+            return detail::make_randn(shape, mean, std_dev, engine);
         }
 #endif
 
         /**
-         * Randomly select n unique elements from xexpression e.
-         * Note: this function makes a copy of your data, and only 1D data is accepted.
+         * Randomly select n elements from the 1-D xexpression @p e.
+         *
+         * Without replacement, the elements are drawn in O(n) operations
+         * when n is small compared to the size of @p e; @p e is not copied.
          *
          * @param e expression to sample from
          * @param n number of elements to sample
+         * @param replace whether the elements are drawn with replacement
          * @param engine random number engine
          *
          * @return xtensor containing 1D container of sampled elements
          */
         template <class T, class E>
-        xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n, E& engine)
+        inline xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n, bool replace, E& engine)
         {
             const auto& de = e.derived_cast();
             XTENSOR_ASSERT(de.dimension() == 1);
-            XTENSOR_ASSERT(de.size() >= n);
+            XTENSOR_ASSERT(replace || de.size() >= n);
+            XTENSOR_ASSERT(n == 0 || de.size() != 0);
             xtensor<typename T::value_type, 1> result;
             result.reshape({n});
+            detail::choice_gather(result, de, 0, detail::choice_indices(de.size(), n, replace, engine));
+            return result;
+        }
 
-            xtensor<typename T::value_type, 1> shuffled = de;
-            shuffle(shuffled.data().begin(), shuffled.data().end(), engine);
+        /**
+         * Randomly select n elements from the 1-D xexpression @p e, without
+         * replacement.
+         *
+         * @param e expression to sample from
+         * @param n number of elements to sample
+         * @param engine random number engine
+         *
+         * @return xtensor containing 1D container of sampled elements
+         */
+        template <class T, class E, class>
+        inline xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n, E& engine)
+        {
+            return choice(e, n, false, engine);
+        }
 
-            std::copy(shuffled.data().begin(), shuffled.data().begin() + n, result.begin());
+        /**
+         * Randomly select n elements from the 1-D xexpression @p e, with the
+         * probabilities given by @p weights.
+         *
+         * With replacement, the elements are drawn from an alias table in O(1)
+         * operations each.
+         *
+         * @param e expression to sample from
+         * @param n number of elements to sample
+         * @param weights 1-D expression of the non-negative weights of the elements
+         *        of @p e, which do not need to be normalized
+         * @param replace whether the elements are drawn with replacement
+         * @param engine random number engine
+         *
+         * @return xtensor containing 1D container of sampled elements
+         */
+        template <class T, class W, class E>
+        inline xtensor<typename T::value_type, 1> choice(const xexpression<T>& e, std::size_t n, const xexpression<W>& weights,
+                                                         bool replace, E& engine)
+        {
+            const auto& de = e.derived_cast();
+            XTENSOR_ASSERT(de.dimension() == 1);
+            xtensor<typename T::value_type, 1> result;
+            result.reshape({n});
+            auto w = detail::choice_weights(weights, de.size());
+            detail::choice_gather(result, de, 0, detail::choice_indices(w, n, replace, engine));
+            return result;
+        }
 
+        /**
+         * Randomly select n slices of the xexpression @p e along @p axis.
+         *
+         * @param e expression to sample from
+         * @param n number of slices to sample
+         * @param replace whether the slices are drawn with replacement
+         * @param axis axis along which the slices are sampled
+         * @param engine random number engine
+         *
+         * @return xarray with the shape of @p e, except for @p n along @p axis
+         */
+        template <class T, class E>
+        inline xarray<typename T::value_type> choice(const xexpression<T>& e, std::size_t n, bool replace, std::size_t axis,
+                                                     E& engine)
+        {
+            const auto& de = e.derived_cast();
+            auto result = detail::choice_container(de, n, axis);
+            std::size_t size = de.shape()[axis];
+            XTENSOR_ASSERT(replace || size >= n);
+            XTENSOR_ASSERT(n == 0 || size != 0);
+            detail::choice_gather(result, de, axis, detail::choice_indices(size, n, replace, engine));
             return result;
+        }
+
+        /**
+         * Randomly select n slices of the xexpression @p e along @p axis, with
+         * the probabilities given by @p weights.
+         *
+         * @param e expression to sample from
+         * @param n number of slices to sample
+         * @param weights 1-D expression of the non-negative weights of the slices
+         * @param replace whether the slices are drawn with replacement
+         * @param axis axis along which the slices are sampled
+         * @param engine random number engine
+         *
+         * @return xarray with the shape of @p e, except for @p n along @p axis
+         */
+        template <class T, class W, class E>
+        inline xarray<typename T::value_type> choice(const xexpression<T>& e, std::size_t n, const xexpression<W>& weights,
+                                                     bool replace, std::size_t axis, E& engine)
+        {
+            const auto& de = e.derived_cast();
+            auto result = detail::choice_container(de, n, axis);
+            auto w = detail::choice_weights(weights, de.shape()[axis]);
+            detail::choice_gather(result, de, axis, detail::choice_indices(w, n, replace, engine));
+            return result;
+        }
+
+        /**
+         * Randomly permutes the slices of the xexpression @p e along its first
+         * axis, in place.
+         *
+         * @param e expression to shuffle
+         * @param engine random number engine
+         */
+        template <class T, class E>
+        inline void shuffle(xexpression<T>& e, E& engine)
+        {
+            shuffle(e, 0, engine);
+        }
 
-            // Doesn't exist yet but would be much nicer as it probably prevent copies
-            // std::experimental::sample(de.begin(), de.end(), result.begin(), std::ref(engine));
+        /**
+         * Randomly permutes the slices of the xexpression @p e along @p axis,
+         * in place.
+         *
+         * With a \ref philox_engine, the permutation is computed in parallel
+         * by blocks that fit in cache, and only depends on the seed of the
+         * engine.
+         *
+         * @param e expression to shuffle
+         * @param axis axis along which the slices are permuted
+         * @param engine random number engine
+         */
+        template <class T, class E>
+        inline void shuffle(xexpression<T>& e, std::size_t axis, E& engine)
+        {
+            auto& de = e.derived_cast();
+            XTENSOR_ASSERT(axis < de.dimension());
+            using direct = std::integral_constant<bool, T::contiguous_layout && has_raw_data_interface<T>::value>;
+            if (direct::value && de.dimension() == 1)
+            {
+                detail::shuffle_impl(de, axis, engine, direct());
+            }
+            else
+            {
+                detail::shuffle_impl(de, axis, engine, std::false_type());
+            }
+        }
+
+        /**
+         * Returns a random permutation of the integers from 0 to @p n, excluding
+         * @p n.
+         *
+         * With a \ref philox_engine, the permutation is computed in parallel
+         * by blocks that fit in cache, and only depends on the seed of the
+         * engine.
+         *
+         * @param n number of integers
+         * @param engine random number engine
+         */
+        template <class T, class E>
+        inline std::enable_if_t<std::is_integral<T>::value, xtensor<T, 1>> permutation(T n, E& engine)
+        {
+            XTENSOR_ASSERT(n >= 0);
+            xtensor<T, 1> result;
+            result.reshape({static_cast<std::size_t>(n)});
+            detail::permutation_fill(result.data().begin(), result.size(), engine);
+            return result;
+        }
+
+        /**
+         * Returns a copy of the xexpression @p e whose slices along @p axis
+         * are randomly permuted.
+         *
+         * @param e expression to permute
+         * @param axis axis along which the slices are permuted
+         * @param engine random number engine
+         */
+        template <class T, class E>
+        inline xarray<typename T::value_type> permutation(const xexpression<T>& e, std::size_t axis, E& engine)
+        {
+            const auto& de = e.derived_cast();
+            auto result = detail::choice_container(de, de.shape()[axis], axis);
+            detail::choice_gather(result, de, axis, detail::permutation_indices(de.shape()[axis], engine));
+            return result;
         }
     }
 }
@@ -10,25 +10,30 @@
 #define XTENSOR_REDUCER_HPP
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <initializer_list>
 #include <iterator>
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
 #include <utility>
-#ifdef X_OLD_CLANG
 #include <vector>
-#endif
 
 #include "xtl/xfunctional.hpp"
 #include "xtl/xsequence.hpp"
 
+#include "xassign.hpp"
 #include "xbuilder.hpp"
 #include "xexpression.hpp"
 #include "xgenerator.hpp"
 #include "xiterable.hpp"
+#include "xparallel.hpp"
 #include "xreducer.hpp"
+#include "xstrides.hpp"
+#include "xtensor_simd.hpp"
 #include "xutils.hpp"
 
 namespace xt
@@ -55,12 +60,286 @@ namespace xt
     auto reduce(F&& f, E&& e, const I (&axes)[N], ES es = ES()) noexcept;
 #endif
 
+    namespace detail
+    {
+        template <class F, class = void_t<>>
+        struct has_simd_apply : std::false_type
+        {
+        };
+
+        template <class F>
+        struct has_simd_apply<F, void_t<decltype(&F::simd_apply)>> : std::true_type
+        {
+        };
+
+        template <class E, class = void_t<>>
+        struct has_simd_interface : std::false_type
+        {
+        };
+
+        template <class E>
+        struct has_simd_interface<E,
+            void_t<decltype(std::declval<const E&>().template load_simd<unaligned_mode>(typename E::size_type(0))),
+                   decltype(std::declval<const E&>().data_element(typename E::size_type(0)))>>
+            : std::true_type
+        {
+        };
+
+        // Tells whether the elements of E can be accumulated into those of R
+        // with the simd_apply method of F.
+        template <class F, class R, class E>
+        struct simd_block_reduce
+        {
+            using value_type = typename R::value_type;
+            static constexpr bool value = xsimd::simd_traits<value_type>::size > 1 &&
+                std::is_same<typename E::value_type, value_type>::value &&
+                has_simd_apply<F>::value &&
+                R::contiguous_layout && E::contiguous_layout &&
+                has_simd_interface<R>::value && has_simd_interface<E>::value;
+        };
+
+        template <class F, class R, class E>
+        inline std::size_t reduce_block_simd(F&, R&, std::size_t, const E&, std::size_t, std::size_t, std::false_type)
+        {
+            return 0;
+        }
+
+        template <class F, class R, class E>
+        inline std::size_t reduce_block_simd(F& f, R& res, std::size_t out_index, const E& e,
+                                             std::size_t in_index, std::size_t size, std::true_type)
+        {
+            using value_type = typename R::value_type;
+            using simd_type = xsimd::simd_type<value_type>;
+            constexpr std::size_t simd_size = xsimd::simd_traits<value_type>::size;
+            std::size_t simd_last = size & ~(simd_size - 1);
+            for (std::size_t i = 0; i != simd_last; i += simd_size)
+            {
+                simd_type acc = res.template load_simd<unaligned_mode, simd_type>(out_index + i);
+                acc = f.simd_apply(acc, e.template load_simd<unaligned_mode, simd_type>(in_index + i));
+                res.template store_simd<unaligned_mode, simd_type>(out_index + i, acc);
+            }
+            return simd_last;
+        }
+
+        // Accumulates the size elements of e starting at in_index into the
+        // size elements of res starting at out_index, using SIMD instructions
+        // when possible. Both ranges must be contiguous.
+        template <class F, class R, class E>
+        inline void reduce_block(F& f, R& res, std::size_t out_index, const E& e,
+                                 std::size_t in_index, std::size_t size)
+        {
+            using simd_reduce = std::integral_constant<bool, simd_block_reduce<F, R, E>::value>;
+            std::size_t i = reduce_block_simd(f, res, out_index, e, in_index, size, simd_reduce());
+            for (; i != size; ++i)
+            {
+                res.data_element(out_index + i) = f(res.data_element(out_index + i), e.data_element(in_index + i));
+            }
+        }
+
+        // Accumulates the next size elements of the input into the size
+        // elements of res starting at out_index, advancing the input iterator.
+        template <class F, class R, class E, class It>
+        inline void reduce_row(F& f, R& res, std::size_t out_index, const E& e, It& it,
+                               std::size_t size, std::true_type /*raw data*/)
+        {
+            reduce_block(f, res, out_index, e, static_cast<std::size_t>(it - e.raw_data()), size);
+            it += static_cast<std::ptrdiff_t>(size);
+        }
+
+        template <class F, class R, class E, class It>
+        inline void reduce_row(F& f, R& res, std::size_t out_index, const E&, It& it,
+                               std::size_t size, std::false_type /*raw data*/)
+        {
+            for (std::size_t i = 0; i != size; ++i, ++it)
+            {
+                res.data_element(out_index + i) = f(res.data_element(out_index + i), *it);
+            }
+        }
+
+        // Containers are read through their raw data, other expressions
+        // through their iterators in the layout of the result.
+        template <layout_type L, class E>
+        inline auto reduce_input_begin(const E& e, std::true_type /*raw data*/) noexcept
+        {
+            return e.raw_data();
+        }
+
+        template <layout_type L, class E>
+        inline auto reduce_input_begin(const E& e, std::false_type /*raw data*/) noexcept
+        {
+            return e.template cbegin<L>();
+        }
+
+        /*******************
+         * sum_accumulator *
+         *******************/
+
+        // Number of values summed in order before a block is merged into
+        // the pairwise tree.
+        constexpr std::size_t pairwise_block_size = 32;
+
+        template <class T, class P>
+        class sum_accumulator;
+
+        // Sums a stream of values (scalars or SIMD batches) by blocks, and the
+        // blocks as a balanced binary tree: partial[l] holds the sum of 2^l
+        // blocks, and is merged with the next sum of 2^l blocks like in a
+        // binary counter. The rounding error grows with the logarithm of the
+        // number of values instead of linearly.
+        template <class T>
+        class sum_accumulator<T, summation::pairwise>
+        {
+        public:
+
+            explicit sum_accumulator(const T& init)
+                : m_block(init), m_block_size(1), m_nb_blocks(0)
+            {
+            }
+
+            void add(const T& value)
+            {
+                if (m_block_size == pairwise_block_size)
+                {
+                    push_block();
+                    m_block = value;
+                    m_block_size = 1;
+                }
+                else
+                {
+                    m_block = m_block + value;
+                    ++m_block_size;
+                }
+            }
+
+            T result() const
+            {
+                T res = m_block;
+                for (std::size_t level = 0, n = m_nb_blocks; n != 0; ++level, n >>= 1)
+                {
+                    if (n & 1)
+                    {
+                        res = m_partial[level] + res;
+                    }
+                }
+                return res;
+            }
+
+        private:
+
+            void push_block()
+            {
+                T block = m_block;
+                std::size_t level = 0;
+                for (std::size_t n = m_nb_blocks; n & 1; ++level, n >>= 1)
+                {
+                    block = m_partial[level] + block;
+                }
+                m_partial[level] = block;
+                ++m_nb_blocks;
+            }
+
+            std::array<T, 8 * sizeof(std::size_t)> m_partial;
+            T m_block;
+            std::size_t m_block_size;
+            std::size_t m_nb_blocks;
+        };
+
+        template <class T>
+        class sum_accumulator<T, summation::kahan>
+        {
+        public:
+
+            explicit sum_accumulator(const T& init)
+                : m_sum(init), m_compensation(T(0))
+            {
+            }
+
+            void add(const T& value)
+            {
+                T y = value - m_compensation;
+                T t = m_sum + y;
+                m_compensation = (t - m_sum) - y;
+                m_sum = t;
+            }
+
+            T result() const
+            {
+                return m_sum - m_compensation;
+            }
+
+        private:
+
+            T m_sum;
+            T m_compensation;
+        };
+
+        template <class F, class = void_t<>>
+        struct summation_policy
+        {
+            using type = summation::naive;
+        };
+
+        template <class F>
+        struct summation_policy<F, void_t<typename F::summation_policy>>
+        {
+            using type = typename F::summation_policy;
+        };
+
+        // Policy used to accumulate the values reduced along an axis with the
+        // reduce functor RF, when the first value is initialized with IF. Sums
+        // of integers are exact whatever the order of the additions.
+        template <class RF, class IF, class T>
+        using reduce_summation_t = std::conditional_t<
+            std::is_same<IF, xtl::identity>::value && !std::is_integral<T>::value,
+            typename summation_policy<RF>::type, summation::naive>;
+
+        // Accumulates the next size elements of the input into init, advancing
+        // the input iterator.
+        template <class F, class T, class It>
+        inline T reduce_sequence(F& f, T init, It& it, std::size_t size, summation::naive)
+        {
+            for (std::size_t i = 0; i != size; ++i, ++it)
+            {
+                init = f(init, *it);
+            }
+            return init;
+        }
+
+        template <class F, class T, class It, class P>
+        inline T reduce_sequence(F&, const T& init, It& it, std::size_t size, P)
+        {
+            sum_accumulator<T, P> acc(init);
+            for (std::size_t i = 0; i != size; ++i, ++it)
+            {
+                acc.add(static_cast<T>(*it));
+            }
+            return acc.result();
+        }
+
+        template <class E>
+        struct immediate_reduce_traits
+        {
+            static constexpr layout_type static_layout = E::static_layout;
+            static constexpr bool raw_data = E::contiguous_layout && has_raw_data_interface<E>::value;
+            // Layout in which expressions without raw data are traversed
+            static constexpr layout_type traversal_layout = static_layout == layout_type::column_major ?
+                layout_type::column_major : layout_type::row_major;
+            static constexpr layout_type result_layout = raw_data ? static_layout : traversal_layout;
+        };
+    }
+
     template <class F, class E, class X>
     auto reduce_immediate(F&& f, E&& e, X&& axes)
     {
         using shape_type = std::vector<std::size_t>;
         using accumulate_functor = std::decay_t<decltype(std::get<0>(f))>;
         using result_type = typename accumulate_functor::result_type;
+        using traits = detail::immediate_reduce_traits<std::decay_t<E>>;
+        using raw_data = std::integral_constant<bool, traits::raw_data>;
+        using summation_policy = detail::reduce_summation_t<accumulate_functor,
+                                                            std::decay_t<decltype(std::get<1>(f))>,
+                                                            result_type>;
+        constexpr layout_type traversal_layout = traits::traversal_layout;
 
         // retrieve functors from triple struct
         auto acc_fct = std::get<0>(f);
@@ -68,23 +347,27 @@ namespace xt
         auto merge_fct = std::get<2>(f);
 
         shape_type result_shape(e.dimension() - axes.size());
-        std::vector<std::size_t> iter_shape = e.shape();
+        std::vector<std::size_t> iter_shape(e.shape().cbegin(), e.shape().cend());
         std::vector<std::size_t> iter_strides(e.dimension());
 
-        xt::xarray<result_type, std::decay_t<E>::static_layout> result;
+        xt::xarray<result_type, traits::result_layout> result;
 
         if (!std::is_sorted(axes.cbegin(), axes.cend()))
         {
             throw std::runtime_error("Reducing axes should be sorted");
         }
 
+        // Expressions are read in the order of memory for containers, and
+        // of the result layout for other expressions.
+        layout_type layout = traits::raw_data ? e.layout() : traversal_layout;
+        auto begin = detail::reduce_input_begin<traversal_layout>(e, raw_data());
+
         // Fast track for complete reduction
         if (e.dimension() == axes.size())
         {
-            auto begin = e.data().begin();
             result_type tmp = init_fct(*begin);
             ++begin;
-            result(0) = std::accumulate(begin, e.data().end(), tmp, acc_fct);
+            result(0) = detail::reduce_sequence(acc_fct, tmp, begin, e.size() - 1, summation_policy());
             return result;
         }
 
@@ -99,11 +382,22 @@ namespace xt
             }
         }
 
-        result.reshape(result_shape, e.layout());
+        result.reshape(result_shape, layout);
+
+        // strides of the input in the order it is read, extent-1 dimensions
+        // included
+        std::vector<std::size_t> e_strides(e.dimension());
+        std::size_t data_size = 1;
+        for (std::size_t i = 0; i < e.dimension(); ++i)
+        {
+            std::size_t d = layout == layout_type::row_major ? e.dimension() - 1 - i : i;
+            e_strides[d] = data_size;
+            data_size *= e.shape()[d];
+        }
 
-        std::size_t ax_idx = (e.layout() == layout_type::row_major) ? axes.size() - 1 : 0;
-        std::size_t inner_loop_size = e.strides()[axes[ax_idx]];
-        std::size_t inner_stride    = e.strides()[axes[ax_idx]];
+        std::size_t ax_idx = (layout == layout_type::row_major) ? axes.size() - 1 : 0;
+        std::size_t inner_loop_size = e_strides[axes[ax_idx]];
+        std::size_t inner_stride    = e_strides[axes[ax_idx]];
         std::size_t outer_loop_size = e.shape()[axes[ax_idx]];
 
         // The following code merges reduction axes "at the end" (or the beginning for col_major)
@@ -134,14 +428,14 @@ namespace xt
             }
         }
 
-        if (e.layout() == layout_type::row_major)
+        if (layout == layout_type::row_major)
         {
             std::size_t last_ax = merge_loops(axes.rbegin(), axes.rend());
 
             iter_shape.erase(iter_shape.begin() + (ptrdiff_t) last_ax, iter_shape.end());
             iter_strides.erase(iter_strides.begin() + (ptrdiff_t) last_ax, iter_strides.end());
         }
-        else if (e.layout() == layout_type::column_major)
+        else if (layout == layout_type::column_major)
         {
             // we got column_major here
             std::size_t last_ax = merge_loops(axes.begin(), axes.end());
@@ -180,7 +474,6 @@ namespace xt
                                                      iter_strides.begin(), ptrdiff_t(0)));
         };
 
-        auto begin = e.raw_data();
         auto out = result.raw_data();
         auto out_begin = result.raw_data();
 
@@ -202,17 +495,16 @@ namespace xt
         {
             while(idx_res.first != true)
             {
-                // for unknown reasons it's much faster to use a temporary variable and
-                // std::accumulate here -- probably some cache behavior
+                // for unknown reasons it's much faster to use a temporary variable
+                // here -- probably some cache behavior
                 result_type tmp;
                 tmp = init_fct(*begin);
-                tmp = std::accumulate(begin + 1, begin + outer_loop_size, tmp, acc_fct);
+                ++begin;
+                tmp = detail::reduce_sequence(acc_fct, tmp, begin, outer_loop_size - 1, summation_policy());
 
                 // use merge function if necessary
                 *out = merge ? merge_fct(*out, tmp) : tmp;
 
-                begin += outer_loop_size;
-
                 idx_res = next_idx();
                 next_stride = idx_res.second;
                 out = out_begin + next_stride;
@@ -233,18 +525,15 @@ namespace xt
         {
             while(idx_res.first != true)
             {
-                std::transform(out, out + inner_loop_size, begin, out,
-                               [merge, &init_fct, &merge_fct](auto&& v1, auto&& v2)
-                               {
-                                    return merge ? merge_fct(v1, v2) : init_fct(v2);
-                               }
-                );
+                for (std::size_t i = 0; i < inner_loop_size; ++i, ++begin)
+                {
+                    out[i] = merge ? merge_fct(out[i], *begin) : init_fct(*begin);
+                }
 
-                begin += inner_stride;
                 for (std::size_t i = 1; i < outer_loop_size; ++i)
                 {
-                    std::transform(out, out + inner_loop_size, begin, out, acc_fct);
-                    begin += inner_stride;
+                    detail::reduce_row(acc_fct, result, std::size_t(out - out_begin),
+                                       e, begin, inner_loop_size, raw_data());
                 }
 
                 idx_res = next_idx();
@@ -337,6 +626,106 @@ namespace xt
     template <class F, class CT, class X>
     class xreducer_stepper;
 
+    namespace detail
+    {
+        // Tells whether F can be regrouped, so that a reduction or a scan
+        // can be split into blocks processed independently and combined
+        // afterwards.
+        template <class F>
+        struct is_associative : std::false_type
+        {
+        };
+
+#define XTENSOR_ASSOCIATIVE_FUNCTOR(NAME)                  \
+        template <class T>                                 \
+        struct is_associative<NAME<T>> : std::true_type    \
+        {                                                  \
+        }
+
+        XTENSOR_ASSOCIATIVE_FUNCTOR(plus);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(multiplies);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(logical_or);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(logical_and);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(bitwise_or);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(bitwise_and);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(bitwise_xor);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(std::plus);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(std::multiplies);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(std::logical_or);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(std::logical_and);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(std::bit_or);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(std::bit_and);
+        XTENSOR_ASSOCIATIVE_FUNCTOR(std::bit_xor);
+
+#undef XTENSOR_ASSOCIATIVE_FUNCTOR
+
+        // A reduction is split into blocks merged with the merge functor
+        // when the reduce functor is associative, or when a merge functor
+        // of another type was given explicitly. The default merge functor
+        // is the reduce functor, which may not combine partial results.
+        template <class R>
+        struct reducer_block_split
+        {
+            using reduce_functor_type = typename R::reduce_functor_type;
+            using merge_functor_type = typename R::merge_functor_type;
+            static constexpr bool value = is_associative<reduce_functor_type>::value ||
+                !std::is_same<merge_functor_type, reduce_functor_type>::value;
+        };
+
+        // Partial results of the blocks of a reduction, reused for all the
+        // elements computed by a stepper. Copies start empty, so that the
+        // copies of the stepper made by the tasks do not duplicate it. Booleans
+        // are stored as bytes, so that the blocks can be written concurrently.
+        template <class T>
+        class reducer_partials
+        {
+        public:
+
+            using storage_type = std::conditional_t<std::is_same<T, bool>::value, std::uint8_t, T>;
+
+            reducer_partials() = default;
+
+            reducer_partials(const reducer_partials&)
+            {
+            }
+
+            reducer_partials& operator=(const reducer_partials&)
+            {
+                return *this;
+            }
+
+            std::vector<storage_type>& get(std::size_t size)
+            {
+                if (m_data.size() < size)
+                {
+                    m_data.resize(size);
+                }
+                return m_data;
+            }
+
+        private:
+
+            std::vector<storage_type> m_data;
+        };
+
+        // The lazy reducer loads SIMD batches along its innermost reduced
+        // axis when the reducing function provides simd_apply, no init
+        // function is applied and the expression holds contiguous values
+        // of the reducer's value_type.
+        template <class R, class E>
+        struct reducer_simd_traits
+        {
+            using value_type = typename R::value_type;
+            static constexpr bool value = xsimd::simd_traits<value_type>::size > 1 &&
+                std::is_same<typename E::value_type, value_type>::value &&
+                has_simd_apply<typename R::reduce_functor_type>::value &&
+                std::is_same<typename R::init_functor_type, xtl::identity>::value &&
+                E::contiguous_layout &&
+                (E::static_layout == layout_type::row_major || E::static_layout == layout_type::column_major) &&
+                has_simd_interface<E>::value;
+        };
+    }
+
     template <class F, class CT, class X>
     struct xiterable_inner_types<xreducer<F, CT, X>>
     {
@@ -396,6 +785,7 @@ namespace xt
 
         static constexpr layout_type static_layout = layout_type::dynamic;
         static constexpr bool contiguous_layout = false;
+        static constexpr bool simd_reduce = detail::reducer_simd_traits<self_type, xexpression_type>::value;
 
         template <class Func, class CTA, class AX>
         xreducer(Func&& func, CTA&& e, AX&& axes);
@@ -429,8 +819,18 @@ namespace xt
         template <class S>
         const_stepper stepper_end(const S& shape, layout_type) const noexcept;
 
+        const xexpression_type& expression() const noexcept;
+        const axes_type& axes() const noexcept;
+
     private:
 
+        using strides_type = typename xexpression_type::shape_type;
+
+        template <class E>
+        bool assign_to(E& e, std::true_type) const;
+        template <class E>
+        bool assign_to(E& e, std::false_type) const noexcept;
+
         CT m_e;
         reduce_functor_type m_reduce;
         init_functor_type m_init;
@@ -438,8 +838,15 @@ namespace xt
         axes_type m_axes;
         inner_shape_type m_shape;
         shape_type m_dim_mapping;
+        strides_type m_strides;
+        bool m_simd;
+        size_type m_block_extent;
+        size_type m_nb_blocks;
 
         friend class xreducer_stepper<F, CT, X>;
+
+        template <class E1, class F2, class CT2, class X2>
+        friend bool detail::assign_reducer(E1&, const xreducer<F2, CT2, X2>&);
     };
 
     /*************************
@@ -548,16 +955,40 @@ namespace xt
 
     private:
 
+        using simd_reduce = std::integral_constant<bool, xreducer_type::simd_reduce>;
+        using summation_policy = detail::reduce_summation_t<typename xreducer_type::reduce_functor_type,
+                                                            typename xreducer_type::init_functor_type,
+                                                            value_type>;
+
         reference aggregate(size_type dim) const;
+        reference aggregate(std::true_type) const;
+        reference aggregate(std::false_type) const;
+        reference aggregate_blocks() const;
+        reference aggregate_block(size_type first, size_type last, std::true_type) const;
+        reference aggregate_block(size_type first, size_type last, std::false_type) const;
+        reference aggregate_simd(size_type dim, size_type index) const;
+        reference reduce_axis(size_type ax, size_type size) const;
+        reference reduce_axis(size_type ax, size_type size, summation::naive) const;
+        template <class P>
+        reference reduce_axis(size_type ax, size_type size, P) const;
+        reference reduce_simd(size_type index, size_type size) const;
+        reference reduce_simd(size_type index, size_type size, summation::naive) const;
+        template <class P>
+        reference reduce_simd(size_type index, size_type size, P) const;
 
         substepper_type get_substepper_begin() const;
         size_type get_dim(size_type dim) const noexcept;
         size_type shape(size_type i) const noexcept;
         size_type axis(size_type i) const noexcept;
+        size_type stride(size_type i) const noexcept;
 
         const xreducer_type& m_reducer;
         size_type m_offset;
         mutable substepper_type m_stepper;
+        // Linear index of m_stepper in the expression, only
+        // maintained when the reducer can use SIMD instructions.
+        size_type m_index;
+        mutable detail::reducer_partials<value_type> m_partials;
     };
 
     template <class F, class CT, class X>
@@ -642,6 +1073,10 @@ namespace xt
         , m_axes(std::forward<AX>(axes))
         , m_shape(xtl::make_sequence<inner_shape_type>(m_e.dimension() - m_axes.size(), 0))
         , m_dim_mapping(xtl::make_sequence<shape_type>(m_e.dimension() - m_axes.size(), 0))
+        , m_strides()
+        , m_simd(false)
+        , m_block_extent(0)
+        , m_nb_blocks(1)
     {
         if (!std::is_sorted(m_axes.cbegin(), m_axes.cend()))
         {
@@ -650,6 +1085,29 @@ namespace xt
         detail::excluding_copy(m_e.shape().cbegin(), m_e.shape().cend(),
                                m_axes.cbegin(), m_axes.cend(),
                                m_shape.begin(), m_dim_mapping.begin());
+        if (simd_reduce)
+        {
+            m_strides = xtl::make_sequence<strides_type>(m_e.dimension(), 0);
+            compute_strides(m_e.shape(), xexpression_type::static_layout, m_strides);
+            m_simd = m_axes.size() != 0 && m_e.is_trivial_broadcast(m_strides) && m_strides[m_axes[m_axes.size() - 1]] == 1;
+        }
+
+        // Reductions of more than XTENSOR_REDUCE_BLOCK_SIZE elements are split
+        // into blocks of slices along the first reduced axis. The blocks only
+        // depend on the shape, so that the result does not depend on the
+        // number of threads reducing them. Reductions whose partial results
+        // cannot be merged are never split.
+        if (detail::reducer_block_split<self_type>::value && m_axes.size() != 0)
+        {
+            size_type extent = m_e.shape()[m_axes[0]];
+            size_type inner_size = 1;
+            for (size_type i = 1; i < m_axes.size(); ++i)
+            {
+                inner_size *= m_e.shape()[m_axes[i]];
+            }
+            m_block_extent = std::max(size_type(XTENSOR_REDUCE_BLOCK_SIZE) / std::max(inner_size, size_type(1)), size_type(1));
+            m_nb_blocks = std::max((extent + m_block_extent - 1) / m_block_extent, size_type(1));
+        }
     }
     //@}
 
@@ -820,6 +1278,167 @@ namespace xt
         return const_stepper(*this, offset, true, l);
     }
 
+    template <class F, class CT, class X>
+    inline auto xreducer<F, CT, X>::expression() const noexcept -> const xexpression_type&
+    {
+        return m_e;
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer<F, CT, X>::axes() const noexcept -> const axes_type&
+    {
+        return m_axes;
+    }
+
+    template <class F, class CT, class X>
+    template <class E>
+    inline bool xreducer<F, CT, X>::assign_to(E& e, std::true_type) const
+    {
+        constexpr layout_type layout = xexpression_type::static_layout;
+        size_type dim = m_e.dimension();
+        size_type fastest_dim = layout == layout_type::row_major ? dim - 1 : 0;
+        if (m_axes.size() == 0 || m_axes.size() == dim || e.dimension() != dimension() ||
+            std::find(m_axes.cbegin(), m_axes.cend(), fastest_dim) != m_axes.cend())
+        {
+            return false;
+        }
+
+        inner_shape_type res_strides = xtl::make_sequence<inner_shape_type>(dimension(), 0);
+        compute_strides(m_shape, layout, res_strides);
+        strides_type e_strides = xtl::make_sequence<strides_type>(dim, 0);
+        compute_strides(m_e.shape(), layout, e_strides);
+        if (!e.is_trivial_broadcast(res_strides) || !m_e.is_trivial_broadcast(e_strides))
+        {
+            return false;
+        }
+
+        // Dimensions are walked from the slowest to the fastest varying one;
+        // the trailing non reduced dimensions form contiguous blocks of both
+        // the expression and the result, accumulated into the result one
+        // after the other while the input is read in memory order.
+        auto traversal_dim = [layout, dim](size_type k) {
+            return layout == layout_type::row_major ? k : dim - 1 - k;
+        };
+        std::vector<bool> reduced(dim, false);
+        for (auto it = m_axes.cbegin(); it != m_axes.cend(); ++it)
+        {
+            reduced[static_cast<size_type>(*it)] = true;
+        }
+        std::vector<size_type> res_dim(dim, 0);
+        for (size_type d = 0, rd = 0; d < dim; ++d)
+        {
+            res_dim[d] = rd;
+            rd += reduced[d] ? size_type(0) : size_type(1);
+        }
+
+        size_type nb_outer = dim;
+        size_type block_size = 1;
+        while (!reduced[traversal_dim(nb_outer - 1)])
+        {
+            --nb_outer;
+            block_size *= m_e.shape()[traversal_dim(nb_outer)];
+        }
+
+        std::vector<size_type> extents(nb_outer), out_strides(nb_outer);
+        for (size_type k = 0; k < nb_outer; ++k)
+        {
+            size_type d = traversal_dim(k);
+            extents[k] = m_e.shape()[d];
+            out_strides[k] = reduced[d] ? 0 : res_strides[res_dim[d]];
+        }
+
+        // Accumulates the columns [first, last) of the blocks. Every element
+        // of the result is reduced in the same order, whatever the columns
+        // are split across threads.
+        size_type size = compute_size(m_e.shape());
+        auto accumulate_columns = [&](size_type first, size_type last) {
+            std::vector<size_type> index(nb_outer, 0);
+            size_type nb_columns = last - first;
+            size_type out_index = first;
+            bool first_block = true;
+            for (size_type in_index = first; in_index < size; in_index += block_size)
+            {
+                if (first_block)
+                {
+                    for (size_type i = 0; i != nb_columns; ++i)
+                    {
+                        e.data_element(out_index + i) = m_init(m_e.data_element(in_index + i));
+                    }
+                }
+                else
+                {
+                    detail::reduce_block(m_reduce, e, out_index, m_e, in_index, nb_columns);
+                }
+
+                for (size_type k = nb_outer; k != 0; --k)
+                {
+                    if (++index[k - 1] != extents[k - 1])
+                    {
+                        out_index += out_strides[k - 1];
+                        break;
+                    }
+                    out_index -= (extents[k - 1] - 1) * out_strides[k - 1];
+                    index[k - 1] = 0;
+                }
+
+                first_block = true;
+                for (size_type k = 0; k < nb_outer; ++k)
+                {
+                    first_block = first_block && (!reduced[traversal_dim(k)] || index[k] == 0);
+                }
+            }
+        };
+        parallel_for(block_size, detail::assign_grain(block_size, size / block_size), accumulate_columns);
+        return true;
+    }
+
+    template <class F, class CT, class X>
+    template <class E>
+    inline bool xreducer<F, CT, X>::assign_to(E&, std::false_type) const noexcept
+    {
+        return false;
+    }
+
+    namespace detail
+    {
+        // Compensated sums are not accumulated row by row, which would
+        // require one compensation per element of the result.
+        template <class E1, class R>
+        struct output_major_assign
+        {
+            using xexpression_type = typename R::xexpression_type;
+            using summation_policy = reduce_summation_t<typename R::reduce_functor_type,
+                                                        typename R::init_functor_type,
+                                                        typename R::value_type>;
+            static constexpr layout_type layout = xexpression_type::static_layout;
+            static constexpr bool value = !std::is_same<summation_policy, summation::kahan>::value &&
+                E1::contiguous_layout && xexpression_type::contiguous_layout &&
+                (layout == layout_type::row_major || layout == layout_type::column_major) &&
+                std::is_same<typename E1::value_type, typename R::value_type>::value &&
+                std::is_lvalue_reference<typename E1::reference>::value &&
+                has_data_element<E1>::value && has_data_element<xexpression_type>::value;
+        };
+
+        // Assigns a reducer whose reduced axes do not include the fastest
+        // varying dimension of its (contiguous) expression by accumulating
+        // whole rows of the expression into the result, instead of computing
+        // each element of the result independently.
+        template <class E1, class F, class CT, class X>
+        inline bool assign_reducer(E1& e1, const xreducer<F, CT, X>& e2)
+        {
+            using tag = std::integral_constant<bool, output_major_assign<E1, xreducer<F, CT, X>>::value>;
+            return e2.assign_to(e1, tag());
+        }
+
+        template <class F, class CT, class X>
+        inline std::size_t element_cost(const xreducer<F, CT, X>& e) noexcept
+        {
+            std::size_t size = std::max(std::size_t(e.size()), std::size_t(1));
+            std::size_t reduced_size = std::max(std::size_t(e.expression().size()) / size, std::size_t(1));
+            return reduced_size * element_cost(e.expression());
+        }
+    }
+
     /***********************************
      * xreducer_stepper implementation *
      ***********************************/
@@ -827,7 +1446,7 @@ namespace xt
     template <class F, class CT, class X>
     inline xreducer_stepper<F, CT, X>::xreducer_stepper(const xreducer_type& red, size_type offset, bool end, layout_type l)
         : m_reducer(red), m_offset(offset),
-          m_stepper(get_substepper_begin())
+          m_stepper(get_substepper_begin()), m_index(0)
     {
         if (end)
         {
@@ -838,7 +1457,7 @@ namespace xt
     template <class F, class CT, class X>
     inline auto xreducer_stepper<F, CT, X>::operator*() const -> reference
     {
-        reference r = aggregate(0);
+        reference r = m_reducer.m_nb_blocks > 1 ? aggregate_blocks() : aggregate(simd_reduce());
         return r;
     }
 
@@ -848,6 +1467,10 @@ namespace xt
         if (dim >= m_offset)
         {
             m_stepper.step(get_dim(dim), n);
+            if (simd_reduce::value)
+            {
+                m_index += n * stride(get_dim(dim));
+            }
         }
     }
 
@@ -857,6 +1480,10 @@ namespace xt
         if (dim >= m_offset)
         {
             m_stepper.step_back(get_dim(dim), n);
+            if (simd_reduce::value)
+            {
+                m_index -= n * stride(get_dim(dim));
+            }
         }
     }
 
@@ -866,6 +1493,10 @@ namespace xt
         if (dim >= m_offset)
         {
             m_stepper.reset(get_dim(dim));
+            if (simd_reduce::value)
+            {
+                m_index -= (shape(get_dim(dim)) - 1) * stride(get_dim(dim));
+            }
         }
     }
 
@@ -875,6 +1506,10 @@ namespace xt
         if (dim >= m_offset)
         {
             m_stepper.reset_back(get_dim(dim));
+            if (simd_reduce::value)
+            {
+                m_index += (shape(get_dim(dim)) - 1) * stride(get_dim(dim));
+            }
         }
     }
 
@@ -882,12 +1517,19 @@ namespace xt
     inline void xreducer_stepper<F, CT, X>::to_begin()
     {
         m_stepper.to_begin();
+        m_index = 0;
     }
 
     template <class F, class CT, class X>
     inline void xreducer_stepper<F, CT, X>::to_end(layout_type l)
     {
         m_stepper.to_end(l);
+        if (simd_reduce::value && m_reducer.m_strides.size() != 0)
+        {
+            const auto& strides = m_reducer.m_strides;
+            size_type leading_stride = l == layout_type::row_major ? strides.back() : strides.front();
+            m_index = compute_size(m_reducer.m_e.shape()) + std::max(leading_stride, size_type(1)) - 1;
+        }
     }
 
     template <class F, class CT, class X>
@@ -913,17 +1555,235 @@ namespace xt
         }
         else
         {
-            res = m_reducer.m_init(*m_stepper);
-            for (size_type i = 1; i != size; ++i)
+            res = reduce_axis(index, size);
+        }
+        m_stepper.reset(index);
+        return res;
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::aggregate(std::true_type) const -> reference
+    {
+        return m_reducer.m_simd ? aggregate_simd(0, m_index) : aggregate(0);
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::aggregate(std::false_type) const -> reference
+    {
+        return aggregate(0);
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::aggregate_blocks() const -> reference
+    {
+        size_type nb_blocks = m_reducer.m_nb_blocks;
+        size_type block_extent = m_reducer.m_block_extent;
+        size_type extent = shape(axis(0));
+        auto& partial = m_partials.get(nb_blocks);
+        size_type grain = detail::is_splittable<xexpression_type>::value ? size_type(1) : nb_blocks + 1;
+        parallel_for(nb_blocks, grain, [this, &partial, block_extent, extent](size_type first, size_type last) {
+            // each task reduces its blocks with its own sub-stepper
+            self_type stepper(*this);
+            for (size_type i = first; i != last; ++i)
+            {
+                size_type block_last = std::min((i + 1) * block_extent, extent);
+                partial[i] = stepper.aggregate_block(i * block_extent, block_last, simd_reduce());
+            }
+        });
+        reference res = static_cast<value_type>(partial[0]);
+        for (size_type i = 1; i != nb_blocks; ++i)
+        {
+            res = m_reducer.m_merge(res, static_cast<value_type>(partial[i]));
+        }
+        return res;
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::aggregate_block(size_type first, size_type last, std::true_type) const -> reference
+    {
+        if (!m_reducer.m_simd)
+        {
+            return aggregate_block(first, last, std::false_type());
+        }
+        size_type index = axis(0);
+        size_type data_index = m_index + first * stride(index);
+        if (m_reducer.m_axes.size() == 1)
+        {
+            return reduce_simd(data_index, last - first);
+        }
+        reference res = aggregate_simd(1, data_index);
+        for (size_type i = first + 1; i != last; ++i)
+        {
+            data_index += stride(index);
+            res = m_reducer.m_merge(res, aggregate_simd(1, data_index));
+        }
+        return res;
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::aggregate_block(size_type first, size_type last, std::false_type) const -> reference
+    {
+        size_type index = axis(0);
+        m_stepper.step(index, first);
+        reference res;
+        if (m_reducer.m_axes.size() == 1)
+        {
+            res = reduce_axis(index, last - first);
+        }
+        else
+        {
+            res = aggregate(1);
+            for (size_type i = first + 1; i != last; ++i)
             {
                 m_stepper.step(index);
-                res = m_reducer.m_reduce(res, *m_stepper);
+                res = m_reducer.m_merge(res, aggregate(1));
             }
         }
-        m_stepper.reset(index);
+        m_stepper.step_back(index, last - 1);
         return res;
     }
 
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::aggregate_simd(size_type dim, size_type index) const -> reference
+    {
+        size_type ax = axis(dim);
+        size_type size = shape(ax);
+        if (dim != m_reducer.m_axes.size() - 1)
+        {
+            size_type ax_stride = stride(ax);
+            reference res = aggregate_simd(dim + 1, index);
+            for (size_type i = 1; i != size; ++i)
+            {
+                index += ax_stride;
+                res = m_reducer.m_merge(res, aggregate_simd(dim + 1, index));
+            }
+            return res;
+        }
+        else
+        {
+            return reduce_simd(index, size);
+        }
+    }
+
+    // Reduces the size elements read from the current position of the
+    // substepper along the axis ax, leaving the substepper on the last one.
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::reduce_axis(size_type ax, size_type size) const -> reference
+    {
+        return reduce_axis(ax, size, summation_policy());
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::reduce_axis(size_type ax, size_type size, summation::naive) const -> reference
+    {
+        reference res = m_reducer.m_init(*m_stepper);
+        for (size_type i = 1; i != size; ++i)
+        {
+            m_stepper.step(ax);
+            res = m_reducer.m_reduce(res, *m_stepper);
+        }
+        return res;
+    }
+
+    template <class F, class CT, class X>
+    template <class P>
+    inline auto xreducer_stepper<F, CT, X>::reduce_axis(size_type ax, size_type size, P) const -> reference
+    {
+        detail::sum_accumulator<value_type, P> acc(m_reducer.m_init(*m_stepper));
+        for (size_type i = 1; i != size; ++i)
+        {
+            m_stepper.step(ax);
+            acc.add(static_cast<value_type>(*m_stepper));
+        }
+        return acc.result();
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::reduce_simd(size_type index, size_type size) const -> reference
+    {
+        return reduce_simd(index, size, summation_policy());
+    }
+
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::reduce_simd(size_type index, size_type size, summation::naive) const -> reference
+    {
+        using simd_type = xsimd::simd_type<value_type>;
+        constexpr size_type simd_size = xsimd::simd_traits<value_type>::size;
+        const auto& e = m_reducer.m_e;
+        const auto& reduce_func = m_reducer.m_reduce;
+
+        size_type last = index + size;
+        size_type i = index;
+        value_type res;
+        if (size < simd_size)
+        {
+            res = e.data_element(i++);
+        }
+        else
+        {
+            size_type simd_last = index + (size & ~(simd_size - 1));
+            simd_type batch = e.template load_simd<unaligned_mode, simd_type>(i);
+            for (i += simd_size; i != simd_last; i += simd_size)
+            {
+                batch = reduce_func.simd_apply(batch, e.template load_simd<unaligned_mode, simd_type>(i));
+            }
+            std::array<value_type, simd_size> buffer;
+            xsimd::store_simd<value_type, value_type>(buffer.data(), batch, unaligned_mode());
+            res = buffer[0];
+            for (size_type j = 1; j != simd_size; ++j)
+            {
+                res = reduce_func(res, buffer[j]);
+            }
+        }
+        for (; i != last; ++i)
+        {
+            res = reduce_func(res, e.data_element(i));
+        }
+        return res;
+    }
+
+    // Each lane of the SIMD batches sums its values with the policy P, then
+    // the lanes and the remaining values are summed with the same policy.
+    template <class F, class CT, class X>
+    template <class P>
+    inline auto xreducer_stepper<F, CT, X>::reduce_simd(size_type index, size_type size, P) const -> reference
+    {
+        using simd_type = xsimd::simd_type<value_type>;
+        constexpr size_type simd_size = xsimd::simd_traits<value_type>::size;
+        const auto& e = m_reducer.m_e;
+
+        size_type last = index + size;
+        size_type i = index;
+        if (size < simd_size)
+        {
+            detail::sum_accumulator<value_type, P> acc(e.data_element(i++));
+            for (; i != last; ++i)
+            {
+                acc.add(e.data_element(i));
+            }
+            return acc.result();
+        }
+
+        size_type simd_last = index + (size & ~(simd_size - 1));
+        detail::sum_accumulator<simd_type, P> batch_acc(e.template load_simd<unaligned_mode, simd_type>(i));
+        for (i += simd_size; i != simd_last; i += simd_size)
+        {
+            batch_acc.add(e.template load_simd<unaligned_mode, simd_type>(i));
+        }
+        std::array<value_type, simd_size> buffer;
+        xsimd::store_simd<value_type, value_type>(buffer.data(), batch_acc.result(), unaligned_mode());
+        detail::sum_accumulator<value_type, P> acc(buffer[0]);
+        for (size_type j = 1; j != simd_size; ++j)
+        {
+            acc.add(buffer[j]);
+        }
+        for (; i != last; ++i)
+        {
+            acc.add(e.data_element(i));
+        }
+        return acc.result();
+    }
+
     template <class F, class CT, class X>
     inline auto xreducer_stepper<F, CT, X>::get_substepper_begin() const -> substepper_type
     {
@@ -948,6 +1808,12 @@ namespace xt
         return m_reducer.m_axes[i];
     }
 
+    template <class F, class CT, class X>
+    inline auto xreducer_stepper<F, CT, X>::stride(size_type i) const noexcept -> size_type
+    {
+        return m_reducer.m_strides[i];
+    }
+
     template <class F, class CT, class X>
     inline bool operator==(const xreducer_stepper<F, CT, X>& lhs,
                            const xreducer_stepper<F, CT, X>& rhs)
@@ -0,0 +1,823 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille, Sylvain Corlay and Wolf Vollprecht    *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XTENSOR_SORT_HPP
+#define XTENSOR_SORT_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "xarray.hpp"
+#include "xassign.hpp"
+#include "xexpression.hpp"
+#include "xparallel.hpp"
+#include "xtensor.hpp"
+#include "xutils.hpp"
+
+namespace xt
+{
+    /**
+     * @enum sorting_method
+     * Algorithm used by argsort to order equal elements.
+     */
+    enum class sorting_method
+    {
+        /// equal elements may be reordered
+        quick,
+        /// equal elements keep their relative order
+        stable
+    };
+
+    namespace detail
+    {
+        /************************
+         * sorting result types *
+         ************************/
+
+        template <class S, class R>
+        struct sort_return_type
+        {
+            using type = xarray<R>;
+        };
+
+        template <class I, std::size_t N, class R>
+        struct sort_return_type<std::array<I, N>, R>
+        {
+            using type = xtensor<R, N>;
+        };
+
+        template <class E, class R>
+        using sort_return_type_t = typename sort_return_type<std::decay_t<typename E::shape_type>, R>::type;
+
+        inline std::size_t sort_axis(std::ptrdiff_t axis, std::size_t dimension)
+        {
+            std::ptrdiff_t res = axis < 0 ? axis + static_cast<std::ptrdiff_t>(dimension) : axis;
+            if (res < 0 || res >= static_cast<std::ptrdiff_t>(dimension))
+            {
+                throw std::runtime_error("Axis larger than expression dimension in sort.");
+            }
+            return static_cast<std::size_t>(res);
+        }
+
+        /********************
+         * comparison sorts *
+         ********************/
+
+        // NaNs compare greater than any other value, so that they are sorted
+        // at the end as in NumPy.
+        template <class T, class = void>
+        struct sort_less
+        {
+            bool operator()(const T& lhs, const T& rhs) const
+            {
+                return lhs < rhs;
+            }
+        };
+
+        template <class T>
+        struct sort_less<T, std::enable_if_t<std::is_floating_point<T>::value>>
+        {
+            bool operator()(T lhs, T rhs) const noexcept
+            {
+                return lhs < rhs || (rhs != rhs && lhs == lhs);
+            }
+        };
+
+        /**************
+         * radix sort *
+         **************/
+
+        // Lines of arithmetic values longer than this number of elements per
+        // byte of their keys are sorted with an LSD radix sort, shorter ones
+        // with std::sort.
+        constexpr std::size_t sort_radix_threshold = 64;
+
+        // Unsigned keys whose order is the order of the values. The keys of
+        // floating point values map all NaNs after +inf, and -0 to +0, so
+        // that the radix sort is stable with respect to sort_less.
+        template <class T, class = void>
+        struct radix_key : std::false_type
+        {
+        };
+
+        template <class T>
+        struct radix_key<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+            : std::true_type
+        {
+            using type = std::make_unsigned_t<T>;
+
+            static type get(T value) noexcept
+            {
+                constexpr type sign = std::is_signed<T>::value ? type(type(1) << (8 * sizeof(T) - 1)) : type(0);
+                return static_cast<type>(static_cast<type>(value) ^ sign);
+            }
+        };
+
+        template <class T, class U>
+        struct radix_float_key : std::true_type
+        {
+            using type = U;
+
+            static type get(T value) noexcept
+            {
+                constexpr type sign = type(1) << (8 * sizeof(T) - 1);
+                if (value != value)
+                {
+                    return ~type(0);
+                }
+                if (value == T(0))
+                {
+                    return sign;
+                }
+                type bits;
+                std::memcpy(&bits, &value, sizeof(T));
+                return (bits & sign) != 0 ? type(~bits) : type(bits | sign);
+            }
+        };
+
+        template <>
+        struct radix_key<float> : radix_float_key<float, std::uint32_t>
+        {
+        };
+
+        template <>
+        struct radix_key<double> : radix_float_key<double, std::uint64_t>
+        {
+        };
+
+        // Sorts the n items of data by 8-bit digits of their keys, from the
+        // least significant one, using buffer as the destination of every
+        // other pass. The digits shared by all the keys are skipped.
+        template <class T, class K>
+        inline void radix_sort(T* data, T* buffer, std::size_t n, K key)
+        {
+            using key_type = decltype(key(*data));
+            constexpr std::size_t nb_digits = sizeof(key_type);
+            std::array<std::array<std::size_t, 256>, nb_digits> counts;
+            for (auto& count : counts)
+            {
+                count.fill(0);
+            }
+            for (std::size_t i = 0; i != n; ++i)
+            {
+                key_type k = key(data[i]);
+                for (std::size_t d = 0; d != nb_digits; ++d)
+                {
+                    ++counts[d][(k >> (8 * d)) & 0xFF];
+                }
+            }
+            T* from = data;
+            T* to = buffer;
+            for (std::size_t d = 0; d != nb_digits; ++d)
+            {
+                auto& count = counts[d];
+                if (count[(key(from[0]) >> (8 * d)) & 0xFF] == n)
+                {
+                    continue;
+                }
+                std::size_t total = 0;
+                for (auto& c : count)
+                {
+                    std::size_t tmp = c;
+                    c = total;
+                    total += tmp;
+                }
+                for (std::size_t i = 0; i != n; ++i)
+                {
+                    to[count[(key(from[i]) >> (8 * d)) & 0xFF]++] = from[i];
+                }
+                std::swap(from, to);
+            }
+            if (from != data)
+            {
+                std::copy(from, from + n, data);
+            }
+        }
+
+        template <class K>
+        struct radix_item
+        {
+            K key;
+            std::size_t index;
+        };
+
+        /****************
+         * line sorters *
+         ****************/
+
+        // Sorts lines, keeping its buffers from one line to the next. The
+        // lines that are not contiguous are gathered in m_values, and their
+        // indices in m_indices.
+        template <class T>
+        class sort_line_buffer
+        {
+        public:
+
+            void sort(T* first, std::size_t n)
+            {
+                sort(first, n, radix_key<T>());
+            }
+
+            void argsort(const T* values, std::size_t* out, std::size_t n, sorting_method method)
+            {
+                argsort(values, out, n, method, radix_key<T>());
+            }
+
+            std::vector<T> m_values;
+            std::vector<std::size_t> m_indices;
+
+        private:
+
+            using key_type = typename std::conditional_t<radix_key<T>::value, radix_key<T>, radix_key<std::size_t>>::type;
+            using item_type = radix_item<key_type>;
+
+            void sort(T* first, std::size_t n, std::true_type)
+            {
+                if (n < sort_radix_threshold * sizeof(key_type))
+                {
+                    sort(first, n, std::false_type());
+                    return;
+                }
+                m_buffer.resize(n);
+                radix_sort(first, m_buffer.data(), n, &radix_key<T>::get);
+            }
+
+            void sort(T* first, std::size_t n, std::false_type)
+            {
+                std::sort(first, first + n, sort_less<T>());
+            }
+
+            template <class R>
+            void argsort(const T* values, std::size_t* out, std::size_t n, sorting_method method, R)
+            {
+                if (!R::value || n < sort_radix_threshold * sizeof(key_type))
+                {
+                    std::iota(out, out + n, std::size_t(0));
+                    auto comp = [values](std::size_t i, std::size_t j) { return sort_less<T>()(values[i], values[j]); };
+                    if (method == sorting_method::stable)
+                    {
+                        std::stable_sort(out, out + n, comp);
+                    }
+                    else
+                    {
+                        std::sort(out, out + n, comp);
+                    }
+                    return;
+                }
+                radix_argsort(values, out, n, std::integral_constant<bool, R::value>());
+            }
+
+            void radix_argsort(const T*, std::size_t*, std::size_t, std::false_type)
+            {
+            }
+
+            void radix_argsort(const T* values, std::size_t* out, std::size_t n, std::true_type)
+            {
+                m_items.resize(2 * n);
+                item_type* items = m_items.data();
+                for (std::size_t i = 0; i != n; ++i)
+                {
+                    items[i] = item_type{radix_key<T>::get(values[i]), i};
+                }
+                radix_sort(items, items + n, n, [](const item_type& item) { return item.key; });
+                for (std::size_t i = 0; i != n; ++i)
+                {
+                    out[i] = items[i].index;
+                }
+            }
+
+            std::vector<T> m_buffer;
+            std::vector<item_type> m_items;
+        };
+
+        // Calls f(src, dst, buffer) on every line of the given shape along
+        // axis, where src and dst are the offsets of the first element of the
+        // line in two buffers of the given strides. The lines are split across
+        // threads, each chunk of lines reusing the same sort_line_buffer.
+        template <class T, class S, class SS, class DS, class F>
+        inline void for_each_sort_line(const S& shape, std::size_t axis, const SS& src_strides,
+                                       const DS& dst_strides, F f)
+        {
+            std::size_t dimension = shape.size();
+            std::size_t extent = shape[axis];
+            std::size_t size = std::accumulate(shape.cbegin(), shape.cend(), std::size_t(1), std::multiplies<std::size_t>());
+            if (size == 0)
+            {
+                return;
+            }
+            std::size_t nb_lines = size / extent;
+            parallel_for(nb_lines, assign_grain(nb_lines, extent), [&](std::size_t first, std::size_t last) {
+                sort_line_buffer<T> buffer;
+                for (std::size_t line = first; line != last; ++line)
+                {
+                    std::size_t src = 0, dst = 0, rem = line;
+                    for (std::size_t d = dimension; d-- != 0;)
+                    {
+                        if (d != axis)
+                        {
+                            std::size_t i = rem % shape[d];
+                            rem /= shape[d];
+                            src += i * static_cast<std::size_t>(src_strides[d]);
+                            dst += i * static_cast<std::size_t>(dst_strides[d]);
+                        }
+                    }
+                    f(src, dst, buffer);
+                }
+            });
+        }
+
+        // Calls f(line, n, buffer) on every line of the container res along
+        // axis, the lines that are not contiguous being gathered in the
+        // buffer and scattered back.
+        template <class R, class F>
+        inline void apply_lines(R& res, std::size_t axis, F f)
+        {
+            using value_type = typename R::value_type;
+            std::size_t extent = res.shape()[axis];
+            std::size_t stride = static_cast<std::size_t>(res.strides()[axis]);
+            value_type* data = res.raw_data() + res.raw_data_offset();
+            for_each_sort_line<value_type>(res.shape(), axis, res.strides(), res.strides(),
+                                           [&](std::size_t src, std::size_t, sort_line_buffer<value_type>& buffer) {
+                value_type* line = data + src;
+                if (stride == 1)
+                {
+                    f(line, extent, buffer);
+                    return;
+                }
+                buffer.m_values.resize(extent);
+                for (std::size_t k = 0; k != extent; ++k)
+                {
+                    buffer.m_values[k] = line[k * stride];
+                }
+                f(buffer.m_values.data(), extent, buffer);
+                for (std::size_t k = 0; k != extent; ++k)
+                {
+                    line[k * stride] = buffer.m_values[k];
+                }
+            });
+        }
+
+        // Returns a container of indices of the shape of e, whose lines
+        // along axis are computed by f(values, out, n, buffer) from the
+        // lines of values of e.
+        template <class E, class F>
+        inline auto index_lines(const E& e, std::size_t axis, F f, std::true_type)
+        {
+            using value_type = typename E::value_type;
+            using result_type = sort_return_type_t<E, std::size_t>;
+            result_type res = result_type::from_shape(e.shape());
+            std::size_t extent = e.shape()[axis];
+            std::size_t src_stride = static_cast<std::size_t>(e.strides()[axis]);
+            std::size_t dst_stride = static_cast<std::size_t>(res.strides()[axis]);
+            const value_type* data = e.raw_data() + e.raw_data_offset();
+            std::size_t* out = res.raw_data();
+            for_each_sort_line<value_type>(e.shape(), axis, e.strides(), res.strides(),
+                                           [&](std::size_t src, std::size_t dst, sort_line_buffer<value_type>& buffer) {
+                const value_type* values = data + src;
+                if (src_stride != 1)
+                {
+                    buffer.m_values.resize(extent);
+                    for (std::size_t k = 0; k != extent; ++k)
+                    {
+                        buffer.m_values[k] = values[k * src_stride];
+                    }
+                    values = buffer.m_values.data();
+                }
+                if (dst_stride == 1)
+                {
+                    f(values, out + dst, extent, buffer);
+                }
+                else
+                {
+                    buffer.m_indices.resize(extent);
+                    f(values, buffer.m_indices.data(), extent, buffer);
+                    for (std::size_t k = 0; k != extent; ++k)
+                    {
+                        out[dst + k * dst_stride] = buffer.m_indices[k];
+                    }
+                }
+            });
+            return res;
+        }
+
+        template <class E, class F>
+        inline auto index_lines(const E& e, std::size_t axis, F f, std::false_type)
+        {
+            sort_return_type_t<E, typename E::value_type> tmp = e;
+            return index_lines(tmp, axis, f, std::true_type());
+        }
+
+        template <class E, class F>
+        inline auto index_lines(const E& e, std::size_t axis, F f)
+        {
+            using direct = std::integral_constant<bool, E::contiguous_layout && has_raw_data_interface<E>::value>;
+            return index_lines(e, axis, f, direct());
+        }
+
+        inline void check_kth(std::size_t kth, std::size_t extent)
+        {
+            if (kth >= extent)
+            {
+                throw std::runtime_error("kth larger than the extent of the axis in partition.");
+            }
+        }
+    }
+
+    /**
+     * Returns a sorted copy of the expression @p e, whose lines along
+     * @p axis are sorted in ascending order. NaNs are sorted at the end.
+     *
+     * The lines are sorted in parallel. Long lines of arithmetic values are
+     * sorted with a radix sort, the other ones with \c std::sort; the lines
+     * of the result are sorted in place when they are contiguous.
+     *
+     * @param e the expression to sort
+     * @param axis the axis along which the expression is sorted, negative
+     *        values counting from the last axis
+     * @return a container of the shape of @p e
+     */
+    template <class E>
+    inline auto sort(const xexpression<E>& e, std::ptrdiff_t axis = -1)
+    {
+        using value_type = typename E::value_type;
+        using result_type = detail::sort_return_type_t<E, value_type>;
+        const auto& de = e.derived_cast();
+        std::size_t ax = detail::sort_axis(axis, de.dimension());
+        result_type res = de;
+        detail::apply_lines(res, ax, [](value_type* line, std::size_t n, detail::sort_line_buffer<value_type>& buffer) {
+            buffer.sort(line, n);
+        });
+        return res;
+    }
+
+    /**
+     * Returns the indices that sort the lines of the expression @p e along
+     * @p axis in ascending order. NaNs are sorted at the end.
+     *
+     * The values of contiguous containers are read in place, other
+     * expressions are evaluated first. The lines are sorted in parallel.
+     *
+     * @param e the expression to sort
+     * @param axis the axis along which the expression is sorted, negative
+     *        values counting from the last axis
+     * @param method whether equal elements keep their relative order
+     * @return a container of indices of the shape of @p e
+     */
+    template <class E>
+    inline auto argsort(const xexpression<E>& e, std::ptrdiff_t axis = -1,
+                        sorting_method method = sorting_method::quick)
+    {
+        using value_type = typename E::value_type;
+        const auto& de = e.derived_cast();
+        std::size_t ax = detail::sort_axis(axis, de.dimension());
+        return detail::index_lines(de, ax, [method](const value_type* values, std::size_t* out, std::size_t n,
+                                                    detail::sort_line_buffer<value_type>& buffer) {
+            buffer.argsort(values, out, n, method);
+        });
+    }
+
+    /**
+     * Returns a copy of the expression @p e whose lines along @p axis are
+     * partitioned around their @p kth element: this element is the one
+     * that would be at this position in the sorted line, the elements
+     * before it are not greater and the elements after it are not smaller.
+     *
+     * The lines are partitioned in parallel with \c std::nth_element, in
+     * linear time on average.
+     *
+     * @param e the expression to partition
+     * @param kth the position of the element partitioning the lines
+     * @param axis the axis along which the expression is partitioned,
+     *        negative values counting from the last axis
+     * @return a container of the shape of @p e
+     */
+    template <class E>
+    inline auto partition(const xexpression<E>& e, std::size_t kth, std::ptrdiff_t axis = -1)
+    {
+        using value_type = typename E::value_type;
+        using result_type = detail::sort_return_type_t<E, value_type>;
+        const auto& de = e.derived_cast();
+        std::size_t ax = detail::sort_axis(axis, de.dimension());
+        detail::check_kth(kth, de.shape()[ax]);
+        result_type res = de;
+        detail::apply_lines(res, ax, [kth](value_type* line, std::size_t n, detail::sort_line_buffer<value_type>&) {
+            std::nth_element(line, line + kth, line + n, detail::sort_less<value_type>());
+        });
+        return res;
+    }
+
+    /**
+     * Returns the indices that partition the lines of the expression @p e
+     * along @p axis around their @p kth element.
+     *
+     * @param e the expression to partition
+     * @param kth the position of the element partitioning the lines
+     * @param axis the axis along which the expression is partitioned,
+     *        negative values counting from the last axis
+     * @return a container of indices of the shape of @p e
+     * @sa partition
+     */
+    template <class E>
+    inline auto argpartition(const xexpression<E>& e, std::size_t kth, std::ptrdiff_t axis = -1)
+    {
+        using value_type = typename E::value_type;
+        const auto& de = e.derived_cast();
+        std::size_t ax = detail::sort_axis(axis, de.dimension());
+        detail::check_kth(kth, de.shape()[ax]);
+        return detail::index_lines(de, ax, [kth](const value_type* values, std::size_t* out, std::size_t n,
+                                                 detail::sort_line_buffer<value_type>&) {
+            std::iota(out, out + n, std::size_t(0));
+            std::nth_element(out, out + kth, out + n, [values](std::size_t i, std::size_t j) {
+                return detail::sort_less<value_type>()(values[i], values[j]);
+            });
+        });
+    }
+
+    namespace detail
+    {
+        /********************
+         * order statistics *
+         ********************/
+
+        template <class T>
+        using quantile_value_type_t = std::conditional_t<std::is_floating_point<T>::value, T, double>;
+
+        template <class X>
+        inline std::vector<std::size_t> quantile_axes(const X& axes, std::size_t dimension)
+        {
+            std::vector<std::size_t> res;
+            for (auto axis : axes)
+            {
+                std::ptrdiff_t a = static_cast<std::ptrdiff_t>(axis);
+                std::ptrdiff_t d = static_cast<std::ptrdiff_t>(dimension);
+                if (a < -d || a >= d)
+                {
+                    throw std::runtime_error("Axis larger than expression dimension in quantile.");
+                }
+                res.push_back(static_cast<std::size_t>(a < 0 ? a + d : a));
+            }
+            std::sort(res.begin(), res.end());
+            if (std::adjacent_find(res.begin(), res.end()) != res.end())
+            {
+                throw std::runtime_error("Duplicate axis in quantile.");
+            }
+            return res;
+        }
+
+        inline void check_quantile(double q)
+        {
+            if (!(q >= 0. && q <= 1.))
+            {
+                throw std::runtime_error("Quantile must be in [0, 1].");
+            }
+        }
+
+        // Returns the element of rank k of values[0, n) for fractions t = 0
+        // and its linear interpolation with the element of rank k + 1 for
+        // other fractions, as in NumPy. The values are reordered.
+        template <class R>
+        inline R select_quantile(R* values, std::size_t n, std::size_t k, R t)
+        {
+            std::nth_element(values, values + k, values + n);
+            R lo = values[k];
+            if (t == R(0) || k + 1 == n)
+            {
+                return lo;
+            }
+            R hi = *std::min_element(values + k + 1, values + n);
+            R diff = hi - lo;
+            return t < R(0.5) ? lo + diff * t : hi - diff * (R(1) - t);
+        }
+
+        template <class R>
+        inline R select_median(R* values, std::size_t n)
+        {
+            std::size_t mid = n / 2;
+            std::nth_element(values, values + mid, values + n);
+            R hi = values[mid];
+            if (n % 2 != 0)
+            {
+                return hi;
+            }
+            R lo = *std::max_element(values, values + mid);
+            return (lo + hi) / R(2);
+        }
+
+        // Returns the container of the results of f(values, n) over the
+        // slices of e along the given axes, where values is a scratch buffer
+        // holding the n elements of a slice. The slices are split across
+        // threads, each chunk of slices reusing the same buffer. Slices that
+        // are empty or contain a NaN give a NaN.
+        template <class R, class E, class F>
+        inline xarray<R> reduce_slices(const E& e, const std::vector<std::size_t>& axes, F f, std::true_type)
+        {
+            using value_type = typename E::value_type;
+            std::size_t dimension = e.dimension();
+            std::vector<std::size_t> kept;
+            for (std::size_t d = 0; d != dimension; ++d)
+            {
+                if (!std::binary_search(axes.cbegin(), axes.cend(), d))
+                {
+                    kept.push_back(d);
+                }
+            }
+            std::vector<std::size_t> shape(kept.size());
+            std::size_t slice_size = 1;
+            for (std::size_t d = 0; d != kept.size(); ++d)
+            {
+                shape[d] = e.shape()[kept[d]];
+            }
+            for (std::size_t axis : axes)
+            {
+                slice_size *= e.shape()[axis];
+            }
+            xarray<R> res = xarray<R>::from_shape(shape);
+            std::size_t nb_slices = res.size();
+            const value_type* data = e.raw_data() + e.raw_data_offset();
+            R* out = res.raw_data();
+            parallel_for(nb_slices, assign_grain(nb_slices, slice_size), [&](std::size_t first, std::size_t last) {
+                std::vector<R> buffer(slice_size);
+                std::vector<std::size_t> index(axes.size());
+                for (std::size_t slice = first; slice != last; ++slice)
+                {
+                    std::size_t offset = 0, rem = slice;
+                    for (std::size_t d = kept.size(); d-- != 0;)
+                    {
+                        offset += (rem % shape[d]) * static_cast<std::size_t>(e.strides()[kept[d]]);
+                        rem /= shape[d];
+                    }
+                    bool has_nan = slice_size == 0;
+                    std::fill(index.begin(), index.end(), std::size_t(0));
+                    for (std::size_t k = 0; k != slice_size; ++k)
+                    {
+                        R value = static_cast<R>(data[offset]);
+                        has_nan = has_nan || value != value;
+                        buffer[k] = value;
+                        for (std::size_t d = axes.size(); d-- != 0;)
+                        {
+                            std::size_t stride = static_cast<std::size_t>(e.strides()[axes[d]]);
+                            offset += stride;
+                            if (++index[d] != e.shape()[axes[d]] || d == 0)
+                            {
+                                break;
+                            }
+                            offset -= index[d] * stride;
+                            index[d] = 0;
+                        }
+                    }
+                    out[slice] = has_nan ? std::numeric_limits<R>::quiet_NaN() : f(buffer.data(), slice_size);
+                }
+            });
+            return res;
+        }
+
+        template <class R, class E, class F>
+        inline xarray<R> reduce_slices(const E& e, const std::vector<std::size_t>& axes, F f, std::false_type)
+        {
+            sort_return_type_t<E, typename E::value_type> tmp = e;
+            return reduce_slices<R>(tmp, axes, f, std::true_type());
+        }
+
+        template <class R, class E, class F>
+        inline xarray<R> reduce_slices(const E& e, const std::vector<std::size_t>& axes, F f)
+        {
+            using direct = std::integral_constant<bool, E::contiguous_layout && has_raw_data_interface<E>::value>;
+            return reduce_slices<R>(e, axes, f, direct());
+        }
+
+        template <class E>
+        inline std::vector<std::size_t> all_axes(const E& e)
+        {
+            std::vector<std::size_t> res(e.dimension());
+            std::iota(res.begin(), res.end(), std::size_t(0));
+            return res;
+        }
+
+        template <class E, class X>
+        inline auto quantile_impl(const E& e, double q, const X& axes)
+        {
+            using value_type = quantile_value_type_t<typename E::value_type>;
+            check_quantile(q);
+            return reduce_slices<value_type>(e, quantile_axes(axes, e.dimension()), [q](value_type* values, std::size_t n) {
+                double h = q * static_cast<double>(n - 1);
+                std::size_t k = static_cast<std::size_t>(h);
+                return select_quantile(values, n, k, static_cast<value_type>(h - static_cast<double>(k)));
+            });
+        }
+
+        template <class E, class X>
+        inline auto median_impl(const E& e, const X& axes)
+        {
+            using value_type = quantile_value_type_t<typename E::value_type>;
+            return reduce_slices<value_type>(e, quantile_axes(axes, e.dimension()), [](value_type* values, std::size_t n) {
+                return select_median(values, n);
+            });
+        }
+    }
+
+    /**
+     * Returns the medians of the expression @p e over the given @p axes.
+     * The median of slices of even size is the mean of their two middle
+     * elements; slices that are empty or contain a NaN give a NaN.
+     *
+     * Each slice is copied in a scratch buffer reused by the slices that
+     * the same thread reduces, and partially ordered with
+     * \c std::nth_element, in linear time on average. The slices are
+     * reduced in parallel.
+     *
+     * @param e the expression to reduce
+     * @param axes the axes along which the medians are computed, negative
+     *        values counting from the last axis; all the axes if omitted
+     * @return an \ref xarray over the remaining axes, of floating point
+     *         values of type \c double for integral expressions, or the
+     *         median of all the elements if @p axes is omitted
+     */
+    template <class E, class X>
+    inline auto median(const xexpression<E>& e, const X& axes)
+    {
+        return detail::median_impl(e.derived_cast(), axes);
+    }
+
+    template <class E>
+    inline auto median(const xexpression<E>& e)
+    {
+        const auto& de = e.derived_cast();
+        return detail::median_impl(de, detail::all_axes(de)).data_element(0);
+    }
+
+#ifdef X_OLD_CLANG
+    template <class E, class I>
+    inline auto median(const xexpression<E>& e, std::initializer_list<I> axes)
+    {
+        return detail::median_impl(e.derived_cast(), axes);
+    }
+#else
+    template <class E, class I, std::size_t N>
+    inline auto median(const xexpression<E>& e, const I (&axes)[N])
+    {
+        return detail::median_impl(e.derived_cast(), axes);
+    }
+#endif
+
+    /**
+     * Returns the @p q quantiles of the expression @p e over the given
+     * @p axes, linearly interpolated between the elements of the sorted
+     * slices as in NumPy's default method. Slices that are empty or contain
+     * a NaN give a NaN.
+     *
+     * Each slice is copied in a scratch buffer reused by the slices that
+     * the same thread reduces, and partially ordered with
+     * \c std::nth_element, in linear time on average. The slices are
+     * reduced in parallel.
+     *
+     * @param e the expression to reduce
+     * @param q the quantile to compute, in [0, 1]
+     * @param axes the axes along which the quantiles are computed, negative
+     *        values counting from the last axis; all the axes if omitted
+     * @return an \ref xarray over the remaining axes, of floating point
+     *         values of type \c double for integral expressions, or the
+     *         quantile of all the elements if @p axes is omitted
+     */
+    template <class E, class X>
+    inline auto quantile(const xexpression<E>& e, double q, const X& axes)
+    {
+        return detail::quantile_impl(e.derived_cast(), q, axes);
+    }
+
+    template <class E>
+    inline auto quantile(const xexpression<E>& e, double q)
+    {
+        const auto& de = e.derived_cast();
+        return detail::quantile_impl(de, q, detail::all_axes(de)).data_element(0);
+    }
+
+#ifdef X_OLD_CLANG
+    template <class E, class I>
+    inline auto quantile(const xexpression<E>& e, double q, std::initializer_list<I> axes)
+    {
+        return detail::quantile_impl(e.derived_cast(), q, axes);
+    }
+#else
+    template <class E, class I, std::size_t N>
+    inline auto quantile(const xexpression<E>& e, double q, const I (&axes)[N])
+    {
+        return detail::quantile_impl(e.derived_cast(), q, axes);
+    }
+#endif
+}
+
+#endif
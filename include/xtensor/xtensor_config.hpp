@@ -46,4 +46,12 @@
 #define DEFAULT_LAYOUT layout_type::row_major
 #endif
 
+#ifndef XTENSOR_PARALLEL_ASSIGN_THRESHOLD
+#define XTENSOR_PARALLEL_ASSIGN_THRESHOLD 65536
+#endif
+
+#ifndef XTENSOR_REDUCE_BLOCK_SIZE
+#define XTENSOR_REDUCE_BLOCK_SIZE 32768
+#endif
+
 #endif
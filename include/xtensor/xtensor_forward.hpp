@@ -134,6 +134,18 @@ namespace xt
     template <class CT, class... S>
     class xview;
 
+    template <class F, class R, class... CT>
+    class xfunction;
+
+    template <class F, class CT, class X>
+    class xreducer;
+
+    template <class F, class CT, class S>
+    class xaccumulator;
+
+    template <class F, class R, class S>
+    class xgenerator;
+
     namespace check_policy
     {
         struct none
@@ -161,6 +173,22 @@ namespace xt
         };
         */
     }
+
+    namespace summation
+    {
+        struct base
+        {
+        };
+        struct naive : base
+        {
+        };
+        struct pairwise : base
+        {
+        };
+        struct kahan : base
+        {
+        };
+    }
 }
 
 #endif
@@ -13,6 +13,8 @@
 #include "xtensor/xbuilder.hpp"
 #include "xtensor/xmath.hpp"
 #include "xtensor/xio.hpp"
+#include "xtensor/xnoalias.hpp"
+#include "xtensor/xview.hpp"
 
 namespace xt
 {
@@ -189,4 +191,131 @@ namespace xt
                                    {  9, 90, 990}};
         EXPECT_TRUE(allclose(expected_1, res_1));
     }
-}
\ No newline at end of file
+
+    TEST(xaccumulator, lazy)
+    {
+        xarray<double> a = arange<double>(2. * 3. * 4.);
+        a.reshape({2, 3, 4});
+        xarray<double, layout_type::column_major> ca = a;
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            xarray<double> expected = cumsum(a, axis);
+            auto acc = cumsum(a, axis, evaluation_strategy::lazy());
+            EXPECT_EQ(expected.shape(), acc.shape());
+            // accessing the end of the lines first
+            for (std::size_t i = 0; i < 2; ++i)
+            {
+                EXPECT_EQ(expected(1, 2, 3), acc(1, 2, 3));
+                EXPECT_EQ(expected(0, 0, 0), acc(0, 0, 0));
+            }
+            xarray<double> res = acc;
+            EXPECT_EQ(expected, res);
+            xarray<double> cres = cumsum(ca, axis, evaluation_strategy::lazy());
+            EXPECT_EQ(expected, cres);
+            xarray<double> fres = cumsum(a + 1., axis, evaluation_strategy::lazy()) - 1.;
+            EXPECT_TRUE(allclose(cumsum(a + 1., axis) - 1., fres));
+            EXPECT_TRUE(all(equal(expected, acc)));
+        }
+
+        auto flat = cumsum(a, evaluation_strategy::lazy());
+        xtensor<double, 1> flat_expected = cumsum(a);
+        EXPECT_EQ(flat_expected(23), flat(23));
+        EXPECT_EQ(flat_expected(7), flat(7));
+        xtensor<double, 1> flat_res = flat;
+        EXPECT_EQ(flat_expected, flat_res);
+        EXPECT_EQ(flat_expected(11), cumsum(a + 0., evaluation_strategy::lazy())[{11}]);
+
+        // copies start with an empty cache
+        auto acc = cumprod(a + 1., 2, evaluation_strategy::lazy());
+        EXPECT_EQ(24., acc(0, 0, 3));
+        auto acc_copy = acc;
+        EXPECT_EQ(24., acc_copy(0, 0, 3));
+        EXPECT_THROW(cumsum(a, 3, evaluation_strategy::lazy()), std::runtime_error);
+    }
+
+    TEST(xaccumulator, lazy_view)
+    {
+        xarray<double> a = arange<double>(50. * 40.);
+        a.reshape({50, 40});
+        xarray<double> expected = cumsum(a, 1);
+        xarray<double> res = view(cumsum(a, 1, evaluation_strategy::lazy()), all(), range(0, 10));
+        EXPECT_EQ(view(expected, all(), range(0, 10)), res);
+        xarray<double> rows = view(cumsum(a, 0, evaluation_strategy::lazy()), range(20, 25), all());
+        xarray<double> expected_rows = view(cumsum(a, 0), range(20, 25), all());
+        EXPECT_EQ(expected_rows, rows);
+
+        xtensor<double, 2> t = a;
+        xtensor<double, 2> tres = cumsum(t, 0, evaluation_strategy::lazy());
+        EXPECT_EQ(cumsum(t, 0), tres);
+    }
+
+    struct smoothing
+    {
+        using result_type = double;
+
+        double operator()(double x, double y) const
+        {
+            return 0.5 * x + y;
+        }
+    };
+
+    TEST(xaccumulator, scan)
+    {
+        xarray<int> a = arange<int>(4 * 7 * 5);
+        a.reshape({4, 7, 5});
+        xarray<int, layout_type::column_major> ca = a;
+        for (std::size_t axis = 0; axis < 3; ++axis)
+        {
+            xarray<long long> expected = a;
+            xindex index = {0, 0, 0};
+            for (index[0] = 0; index[0] < 4; ++index[0])
+            {
+                for (index[1] = 0; index[1] < 7; ++index[1])
+                {
+                    for (index[2] = 0; index[2] < 5; ++index[2])
+                    {
+                        if (index[axis] != 0)
+                        {
+                            xindex prev = index;
+                            --prev[axis];
+                            expected[index] += expected[prev];
+                        }
+                    }
+                }
+            }
+            EXPECT_EQ(expected, cumsum(a, axis));
+            EXPECT_EQ(expected, cumsum(ca, axis));
+            xarray<long long> res = cumsum(a, axis, evaluation_strategy::lazy());
+            EXPECT_EQ(expected, res);
+            xarray<long long, layout_type::column_major> cres = cumsum(a, axis, evaluation_strategy::lazy());
+            EXPECT_EQ(expected, cres);
+        }
+
+        // in place
+        xarray<double> d = a;
+        xarray<double> d_expected = cumsum(d, 1);
+        noalias(d) = cumsum(d, 1, evaluation_strategy::lazy());
+        EXPECT_EQ(d_expected, d);
+
+        // long lines are scanned by blocks
+        std::size_t size = 3 * XTENSOR_REDUCE_BLOCK_SIZE + 17;
+        xtensor<double, 1> ones = xt::ones<double>({size});
+        xtensor<double, 1> line = cumsum(ones, evaluation_strategy::lazy());
+        xtensor<double, 1> line_axis = cumsum(ones, 0);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            EXPECT_EQ(double(i + 1), line(i));
+            EXPECT_EQ(double(i + 1), line_axis(i));
+        }
+
+        // other functions are applied in sequence
+        smoothing smooth;
+        xtensor<double, 1> smoothed = accumulate(smooth, ones);
+        double expected = 1.;
+        for (std::size_t i = 1; i < size; ++i)
+        {
+            expected = smooth(expected, 1.);
+            EXPECT_EQ(expected, smoothed(i));
+        }
+    }
+}
@@ -8,12 +8,21 @@
 
 #include "gtest/gtest.h"
 
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
 #include <sstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "xtensor/xcsv.hpp"
 #include "xtensor/xmath.hpp" 
 #include "xtensor/xio.hpp" 
+#include "xtensor/xview.hpp"
 
 namespace xt
 {
@@ -34,6 +43,301 @@ namespace xt
         ASSERT_TRUE(all(equal(res, exp)));
     }
 
+    TEST(xcsv, load_exact)
+    {
+        // cells parsed by the fast paths and by the standard library
+        std::vector<std::string> cells = {
+            "1.7976931348623157e308", "2.2250738585072014e-308", "0", "-0.0", "1", "+2.5", "  3.25", "-4e3",
+            "5E-3", "0.1", "123456789012345678", "1234567890123456789012", "9007199254740993",
+            "1e22", "1e23", "3e37", "0.000001234", ".5", "7.", "1e", "2e+", "3.5\r", "0x1p3", "inf", "-nan",
+            "12abc", "1.00000000000000000000000001", "3.14159265358979323846", "6.02214076e23", "1e-22", "8e-23"};
+        std::string source;
+        for (const auto& cell : cells)
+        {
+            source += cell + "," + cell + "\n";
+        }
+        std::stringstream source_stream(source);
+        xtensor<double, 2> res = load_csv<double>(source_stream);
+        ASSERT_EQ(cells.size(), res.shape()[0]);
+        for (std::size_t i = 0; i < cells.size(); ++i)
+        {
+            double expected = std::stod(cells[i]);
+            if (std::isnan(expected))
+            {
+                EXPECT_TRUE(std::isnan(res(i, 0)));
+            }
+            else
+            {
+                EXPECT_EQ(0, std::memcmp(&expected, &res(i, 0), sizeof(double))) << cells[i];
+            }
+        }
+
+        // cells in the range of float
+        std::vector<std::string> float_cells(cells.begin() + 2, cells.end());
+        std::string float_source;
+        for (const auto& cell : float_cells)
+        {
+            float_source += cell + "\n";
+        }
+        std::stringstream float_stream(float_source);
+        xtensor<float, 2> fres = load_csv<float>(float_stream);
+        for (std::size_t i = 0; i < float_cells.size(); ++i)
+        {
+            float expected = std::stof(float_cells[i]);
+            if (!std::isnan(expected))
+            {
+                EXPECT_EQ(0, std::memcmp(&expected, &fres(i, 0), sizeof(float))) << float_cells[i];
+            }
+        }
+
+        // random numbers with various formats
+        std::mt19937_64 generator(42);
+        std::uniform_real_distribution<double> distribution(-1e6, 1e6);
+        std::vector<double> expected;
+        std::string random_source;
+        char formatted[64];
+        for (std::size_t i = 0; i < 3000; ++i)
+        {
+            double value = distribution(generator) * std::pow(10., double(i % 40) - 20.);
+            const char* format = i % 3 == 0 ? "%.17g" : (i % 3 == 1 ? "%.6f" : "%.9e");
+            std::snprintf(formatted, sizeof(formatted), format, value);
+            expected.push_back(std::stod(formatted));
+            random_source += formatted;
+            random_source += i % 4 == 3 ? "\n" : ",";
+        }
+        std::stringstream random_stream(random_source);
+        xtensor<double, 2> rres = load_csv<double>(random_stream);
+        ASSERT_EQ(750u, rres.shape()[0]);
+        EXPECT_EQ(0, std::memcmp(expected.data(), rres.raw_data(), expected.size() * sizeof(double)));
+    }
+
+    TEST(xcsv, load_integers)
+    {
+        std::string source = "1, -2, +3,  4\r\n-0,12abc,007,2147483647\n";
+        std::stringstream int_stream(source);
+        xtensor<int, 2> res = load_csv<int>(int_stream);
+        xtensor<int, 2> expected = {{1, -2, 3, 4}, {0, 12, 7, 2147483647}};
+        EXPECT_EQ(expected, res);
+
+        std::stringstream unsigned_stream("-1,4294967296\n");
+        xtensor<unsigned int, 2> ures = load_csv<unsigned int>(unsigned_stream);
+        EXPECT_EQ(static_cast<unsigned int>(std::stoul("-1")), ures(0, 0));
+        EXPECT_EQ(static_cast<unsigned int>(std::stoul("4294967296")), ures(0, 1));
+
+        std::stringstream ll_stream("-9223372036854775808,9223372036854775807\n");
+        xtensor<long long, 2> llres = load_csv<long long>(ll_stream);
+        EXPECT_EQ(std::numeric_limits<long long>::min(), llres(0, 0));
+        EXPECT_EQ(std::numeric_limits<long long>::max(), llres(0, 1));
+
+        std::stringstream short_stream("1,2\n3,4\n");
+        xtensor<short, 2> sres = load_csv<short>(short_stream);
+        EXPECT_EQ(4, sres(1, 1));
+
+        std::stringstream overflow_stream("1,2147483648\n");
+        EXPECT_THROW(load_csv<int>(overflow_stream), std::out_of_range);
+        std::stringstream invalid_stream("1,,2\n");
+        EXPECT_THROW(load_csv<double>(invalid_stream), std::invalid_argument);
+        std::stringstream sign_stream("1,-\n");
+        EXPECT_THROW(load_csv<long>(sign_stream), std::invalid_argument);
+        std::stringstream range_stream("1e400\n");
+        EXPECT_THROW(load_csv<double>(range_stream), std::out_of_range);
+    }
+
+    TEST(xcsv, load_shape)
+    {
+        std::stringstream trailing("1,2,\n3,4,\n");
+        xtensor<double, 2> res = load_csv<double>(trailing);
+        xtensor<double, 2> expected = {{1., 2.}, {3., 4.}};
+        EXPECT_EQ(expected, res);
+
+        std::stringstream empty("");
+        xtensor<double, 2> eres = load_csv<double>(empty);
+        EXPECT_EQ(0u, eres.size());
+
+        std::stringstream inconsistent("1,2\n3,4,5\n6\n");
+        try
+        {
+            load_csv<double>(inconsistent);
+            FAIL() << "inconsistent rows not detected";
+        }
+        catch (std::runtime_error& e)
+        {
+            EXPECT_EQ(std::string("Inconsistent row lengths in CSV: line 2 has 3 cells, expected 2"), e.what());
+        }
+        std::stringstream empty_line("1,2\n\n3,4\n");
+        EXPECT_THROW(load_csv<double>(empty_line), std::runtime_error);
+    }
+
+    TEST(xcsv, load_parallel)
+    {
+        std::string filename = std::tmpnam(nullptr);
+        auto write_file = [&filename](const std::string& content) {
+            std::ofstream out(filename, std::ios::binary);
+            out << content;
+        };
+
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> dist(-1e6, 1e6);
+        std::ostringstream source;
+        source.precision(17);
+        for (std::size_t i = 0; i < 20000; ++i)
+        {
+            for (std::size_t j = 0; j < 7; ++j)
+            {
+                source << dist(gen) << ',';
+            }
+            source << dist(gen) << '\n';
+        }
+        std::string content = source.str();
+        std::stringstream stream(content);
+        xtensor<double, 2> expected = load_csv<double>(stream);
+        ASSERT_GT(content.size(), 8 * detail::csv_chunk_size);
+
+        write_file(content);
+        xtensor<double, 2> res = load_csv_parallel<double>(filename);
+        EXPECT_EQ(expected.shape(), res.shape());
+        EXPECT_EQ(expected, res);
+
+#ifdef XTENSOR_USE_THREADS
+        xthread_pool pool(4);
+        set_executor(&pool);
+        res = load_csv_parallel<double>(filename);
+        set_executor(nullptr);
+        EXPECT_EQ(expected, res);
+#endif
+
+        // last line without newline
+        write_file(content.substr(0, content.size() - 1));
+        res = load_csv_parallel<double>(filename);
+        EXPECT_EQ(expected, res);
+
+        // the first inconsistent row is reported, whatever its chunk
+        std::string inconsistent = content;
+        std::size_t pos = 0;
+        for (std::size_t i = 0; i < 15000; ++i)
+        {
+            pos = inconsistent.find('\n', pos) + 1;
+        }
+        inconsistent.insert(pos, "1,2\n");
+        inconsistent += "3\n";
+        write_file(inconsistent);
+        try
+        {
+            load_csv_parallel<double>(filename);
+            FAIL() << "inconsistent rows not detected";
+        }
+        catch (std::runtime_error& e)
+        {
+            EXPECT_EQ(std::string("Inconsistent row lengths in CSV: line 15001 has 2 cells, expected 8"), e.what());
+        }
+
+        write_file("");
+        xtensor<double, 2> eres = load_csv_parallel<double>(filename);
+        EXPECT_EQ(0u, eres.size());
+
+        write_file("1,2\n3,4");
+        xtensor<int, 2> ires = load_csv_parallel<int>(filename);
+        xtensor<int, 2> iexpected = {{1, 2}, {3, 4}};
+        EXPECT_EQ(iexpected, ires);
+
+        std::remove(filename.c_str());
+        EXPECT_THROW(load_csv_parallel<double>(filename), std::runtime_error);
+    }
+
+    TEST(xcsv, reader)
+    {
+        std::stringstream source("a;b;c\n1;2;3\n4;5;6\n7;8;9\n10;11;12\n13;14;15");
+        csv_reader<double> reader(source, 2, ';', 1, {2, 0, 2});
+
+        ASSERT_TRUE(reader.next());
+        xtensor<double, 2> expected = {{3., 1., 3.}, {6., 4., 6.}};
+        EXPECT_EQ(expected, reader.batch());
+        const double* data = reader.batch().raw_data();
+
+        ASSERT_TRUE(reader.next());
+        expected = {{9., 7., 9.}, {12., 10., 12.}};
+        EXPECT_EQ(expected, reader.batch());
+        EXPECT_EQ(data, reader.batch().raw_data());
+        EXPECT_EQ(5u, reader.line());
+
+        ASSERT_TRUE(reader.next());
+        expected = {{15., 13., 15.}};
+        EXPECT_EQ(expected, reader.batch());
+
+        EXPECT_FALSE(reader.next());
+        EXPECT_EQ(0u, reader.batch().shape()[0]);
+        EXPECT_FALSE(reader.next());
+
+        std::stringstream empty("header\n");
+        csv_reader<double> empty_reader(empty, 10, ',', 2);
+        EXPECT_FALSE(empty_reader.next());
+
+        // the cells of the columns which are not selected are not parsed
+        std::stringstream text("x,1\ny,2\n");
+        csv_reader<int> text_reader(text, 10, ',', 0, {1});
+        ASSERT_TRUE(text_reader.next());
+        xtensor<int, 2> iexpected = {{1}, {2}};
+        EXPECT_EQ(iexpected, text_reader.batch());
+
+        std::stringstream range("1,2\n");
+        csv_reader<int> range_reader(range, 10, ',', 0, {2});
+        EXPECT_THROW(range_reader.next(), std::out_of_range);
+
+        std::stringstream inconsistent("h\n1,2\n3,4\n5\n");
+        csv_reader<int> inconsistent_reader(inconsistent, 2, ',', 1, {0});
+        ASSERT_TRUE(inconsistent_reader.next());
+        try
+        {
+            inconsistent_reader.next();
+            FAIL() << "inconsistent rows not detected";
+        }
+        catch (std::runtime_error& e)
+        {
+            EXPECT_EQ(std::string("Inconsistent row lengths in CSV: line 4 has 1 cells, expected 2"), e.what());
+        }
+
+        std::stringstream zero("1\n");
+        auto make_reader = [&zero]() { csv_reader<int> zero_reader(zero, 0); };
+        EXPECT_THROW(make_reader(), std::invalid_argument);
+    }
+
+    TEST(xcsv, reader_blocks)
+    {
+        // rows across the blocks read from the stream, and a long line
+        std::ostringstream source;
+        source.precision(17);
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> dist(-1e6, 1e6);
+        for (std::size_t i = 0; i < 50000; ++i)
+        {
+            for (std::size_t j = 0; j < 3; ++j)
+            {
+                source << dist(gen) << ',';
+            }
+            source << (i == 20000 ? std::string(3000000, ' ') : std::string()) << dist(gen) << '\n';
+        }
+        std::stringstream stream(source.str());
+        xtensor<double, 2> expected = load_csv<double>(stream);
+
+        std::stringstream rstream(source.str());
+        csv_reader<double> reader(rstream, 1000);
+        std::size_t nb_rows = 0;
+        while (reader.next())
+        {
+            const auto& batch = reader.batch();
+            ASSERT_EQ(4u, batch.shape()[1]);
+            for (std::size_t i = 0; i < batch.shape()[0]; ++i)
+            {
+                for (std::size_t j = 0; j < 4; ++j)
+                {
+                    ASSERT_EQ(expected(nb_rows + i, j), batch(i, j));
+                }
+            }
+            nb_rows += batch.shape()[0];
+        }
+        EXPECT_EQ(50000u, nb_rows);
+    }
+
     TEST(xcsv, dump_double)
     {
         xtensor<double, 2> data
@@ -45,4 +349,62 @@ namespace xt
         dump_csv(res, data);
         ASSERT_EQ("1,2,3,4\n10,12,15,18\n", res.str());
     }
+
+    TEST(xcsv, dump_shortest)
+    {
+        xtensor<double, 2> data = {{0.1, 1e-5, 1e16, 123456.}, {-0., 2.5, 1e-4, 1.7976931348623157e308}};
+        std::stringstream res;
+        dump_csv(res, data);
+        EXPECT_EQ("0.1,1e-05,1e+16,123456\n-0,2.5,0.0001,1.7976931348623157e+308\n", res.str());
+
+        xtensor<float, 2> fdata = {{0.1f, 16777216.f, 3.4028235e38f}};
+        std::stringstream fres;
+        dump_csv(fres, fdata);
+        EXPECT_EQ("0.1,16777216,3.4028235e+38\n", fres.str());
+
+        xtensor<long long, 2> idata = {{std::numeric_limits<long long>::min(), 0}, {-12, 1234567}};
+        std::stringstream ires;
+        dump_csv(ires, idata);
+        EXPECT_EQ("-9223372036854775808,0\n-12,1234567\n", ires.str());
+
+        xtensor<bool, 2> bdata = {{true, false}};
+        std::stringstream bres;
+        bres << std::boolalpha;
+        dump_csv(bres, bdata);
+        EXPECT_EQ("true,false\n", bres.str());
+    }
+
+    TEST(xcsv, dump_round_trip)
+    {
+        std::mt19937_64 gen(42);
+        xtensor<double, 2>::shape_type shape = {700, 130};
+        xtensor<double, 2> data(shape);
+        for (auto& d : data)
+        {
+            std::uint64_t bits = gen();
+            std::memcpy(&d, &bits, sizeof(d));
+            // std::stod fails on subnormal values
+            if (!std::isnormal(d))
+            {
+                d = double(bits % 1000) / 7.;
+            }
+        }
+
+        std::stringstream stream;
+        dump_csv(stream, data);
+        xtensor<double, 2> res = load_csv<double>(stream);
+        ASSERT_EQ(data.shape(), res.shape());
+        EXPECT_EQ(0, std::memcmp(data.raw_data(), res.raw_data(), data.size() * sizeof(double)));
+
+        // expressions and column-major containers are walked with steppers
+        xtensor<double, 2, layout_type::column_major> cdata = data;
+        std::stringstream cstream;
+        dump_csv(cstream, cdata);
+        EXPECT_EQ(stream.str(), cstream.str());
+
+        std::stringstream vstream;
+        dump_csv(vstream, view(data, range(1, 700), all()) + 0.);
+        std::string expected = stream.str();
+        EXPECT_EQ(expected.substr(expected.find('\n') + 1), vstream.str());
+    }
 }
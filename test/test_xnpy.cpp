@@ -10,7 +10,12 @@
 
 #include "xtensor/xnpy.hpp"
 #include "xtensor/xarray.hpp"
+#include "xtensor/xbuilder.hpp"
+#include "xtensor/xmath.hpp"
+#include "xtensor/xview.hpp"
 
+#include <cmath>
+#include <complex>
 #include <fstream>
 #include <cstdint>
 
@@ -68,6 +73,24 @@ namespace xt
         return filename;
     }
 
+    // Writes the elements of a row-major array in the opposite byte order,
+    // swapping the bytes of words of the given size
+    template <class T>
+    void dump_swapped_npy(const std::string& filename, const std::string& descr, const xarray<T>& a,
+                          std::size_t word_size = sizeof(T))
+    {
+        std::ofstream stream(filename, std::ofstream::binary);
+        detail::write_header(stream, descr, false, a.shape());
+        const char* bytes = reinterpret_cast<const char*>(a.raw_data());
+        for (std::size_t word = 0; word < a.size() * sizeof(T); word += word_size)
+        {
+            for (std::size_t i = word_size; i != 0; --i)
+            {
+                stream.put(bytes[word + i - 1]);
+            }
+        }
+    }
+
     TEST(xnpy, dump)
     {
         std::string filename = get_filename();
@@ -107,4 +130,331 @@ namespace xt
         EXPECT_TRUE(compare_binary_files(filename, compare_name));
         std::remove(filename.c_str());
     }
-}
\ No newline at end of file
+
+    TEST(xnpy, dump_expression)
+    {
+        xarray<double> a = arange<double>(7 * 5 * 3);
+        a.reshape({7, 5, 3});
+        xarray<double> b = arange<double>(3);
+        xarray<double> expected = exp(a / 100.) * b;
+
+        std::string expected_name = get_filename();
+        dump_npy(expected_name, expected);
+
+        // chunks of one, two and all the slices along the first axis
+        for (std::size_t chunk_size : {std::size_t(1), 2 * 15 * sizeof(double), std::size_t(1) << 20})
+        {
+            std::string filename = get_filename();
+            dump_npy(filename, exp(a / 100.) * b, chunk_size);
+            EXPECT_TRUE(compare_binary_files(filename, expected_name));
+            std::remove(filename.c_str());
+        }
+        std::remove(expected_name.c_str());
+
+        std::string filename = get_filename();
+        dump_npy(filename, view(a, range(1, 6), 2, all()), 32);
+        auto loaded = load_npy<double>(filename);
+        xarray<double> expected_view = view(a, range(1, 6), 2, all());
+        EXPECT_EQ(expected_view.shape(), loaded.shape());
+        EXPECT_TRUE(all(equal(expected_view, loaded)));
+        std::remove(filename.c_str());
+
+        xarray<double, layout_type::column_major> ca = a;
+        filename = get_filename();
+        dump_npy(filename, ca + 0.);
+        auto rloaded = load_npy<double>(filename);
+        EXPECT_TRUE(all(equal(a, rloaded)));
+        std::remove(filename.c_str());
+
+        xarray<double> s = xarray<double>::from_shape({});
+        s() = 3.;
+        filename = get_filename();
+        dump_npy(filename, s * 2.);
+        auto sloaded = load_npy<double>(filename);
+        EXPECT_EQ(0u, sloaded.dimension());
+        EXPECT_EQ(6., sloaded());
+        std::remove(filename.c_str());
+    }
+
+    TEST(xnpy, load_convert)
+    {
+        std::string swapped_endian = detail::big_endian ? "<" : ">";
+        std::string filename = get_filename();
+
+        // several chunks of byte-swapped data
+        xarray<double> d = arange<double>(100000) / 7.;
+        d.reshape({400, 250});
+        dump_swapped_npy(filename, swapped_endian + "f8", d);
+        auto dloaded = load_npy<double>(filename);
+        EXPECT_EQ(d.shape(), dloaded.shape());
+        EXPECT_TRUE(all(equal(d, dloaded)));
+
+        xarray<float> f = d;
+        dump_swapped_npy(filename, swapped_endian + "f4", f);
+        auto fdloaded = load_npy<double>(filename);
+        xarray<double> fd = f;
+        EXPECT_TRUE(all(equal(fd, fdloaded)));
+
+        xarray<std::int16_t> s = {{-3, 300}, {7, -32000}};
+        dump_swapped_npy(filename, swapped_endian + "i2", s);
+        auto sloaded = load_npy<int>(filename);
+        xarray<int> si = s;
+        EXPECT_TRUE(all(equal(si, sloaded)));
+
+        // widening and narrowing conversions in native byte order
+        dump_npy(filename, f);
+        auto floaded = load_npy<double>(filename);
+        EXPECT_TRUE(all(equal(fd, floaded)));
+
+        xarray<long long> l = {1, -2, 1ll << 40};
+        dump_npy(filename, l);
+        auto lloaded = load_npy<double>(filename);
+        EXPECT_EQ(std::pow(2., 40.), lloaded(2));
+        EXPECT_EQ(-2., lloaded(1));
+
+        xarray<double> n = {0.5, 2.75, -3.};
+        dump_npy(filename, n);
+        auto nloaded = load_npy<int>(filename);
+        xarray<int> nexpected = {0, 2, -3};
+        EXPECT_TRUE(all(equal(nexpected, nloaded)));
+
+        xarray<bool> barr = load_npy<bool>("files/xnpy_files/bool.npy");
+        auto bloaded = load_npy<unsigned char>("files/xnpy_files/bool.npy");
+        xarray<unsigned char> bexpected = barr;
+        EXPECT_TRUE(all(equal(bexpected, bloaded)));
+
+        xarray<double> darr = load_npy<double>("files/xnpy_files/double.npy");
+        auto fortran = load_npy<float, layout_type::column_major>("files/xnpy_files/double_fortran.npy");
+        xarray<float> fexpected = darr;
+        EXPECT_TRUE(all(equal(fexpected, fortran)));
+
+        xarray<std::complex<float>> c = xarray<std::complex<float>>::from_shape({2});
+        c(0) = std::complex<float>(1.f, 2.f);
+        c(1) = std::complex<float>(-3.f, 0.5f);
+        dump_npy(filename, c);
+        auto cloaded = load_npy<std::complex<double>>(filename);
+        EXPECT_EQ(std::complex<double>(-3., 0.5), cloaded(1));
+        EXPECT_THROW(load_npy<double>(filename), std::runtime_error);
+
+        dump_swapped_npy(filename, swapped_endian + "c8", c, sizeof(float));
+        auto csloaded = load_npy<std::complex<float>>(filename);
+        EXPECT_EQ(c(0), csloaded(0));
+        EXPECT_EQ(c(1), csloaded(1));
+
+        dump_swapped_npy(filename, swapped_endian + "f2", s);
+        EXPECT_THROW(load_npy<float>(filename), std::runtime_error);
+        std::remove(filename.c_str());
+    }
+
+    TEST(xnpy, load_slice)
+    {
+        xarray<double> darr = load_npy<double>("files/xnpy_files/double.npy");
+
+        xarray<double> rows = load_npy_slice<double>("files/xnpy_files/double.npy", range(1, 3));
+        EXPECT_EQ(xarray<double>(view(darr, range(1, 3))), rows);
+
+        xarray<double> col = load_npy_slice<double>("files/xnpy_files/double.npy", all(), 1, range(0, 3, 2));
+        EXPECT_EQ(xarray<double>(view(darr, all(), 1, range(0, 3, 2))), col);
+
+        xarray<double> elem = load_npy_slice<double>("files/xnpy_files/double.npy", 2, 0, 1);
+        EXPECT_EQ(0u, elem.dimension());
+        EXPECT_EQ(darr(2, 0, 1), elem());
+
+        auto fortran = load_npy_slice<double>("files/xnpy_files/double_fortran.npy", range(0, 2), newaxis(), 2);
+        EXPECT_EQ(layout_type::column_major, fortran.layout());
+        EXPECT_EQ(xarray<double>(view(darr, range(0, 2), newaxis(), 2)), fortran);
+
+        // empty ranges keep their axis, including at the end of the axis
+        xarray<double> empty = load_npy_slice<double>("files/xnpy_files/double.npy", range(1, 1));
+        EXPECT_EQ(darr.dimension(), empty.dimension());
+        EXPECT_EQ(0u, empty.size());
+        EXPECT_EQ(darr.shape()[1], empty.shape()[1]);
+        std::size_t n = darr.shape()[1];
+        xarray<double> empty_end = load_npy_slice<double>("files/xnpy_files/double.npy", 0, range(n, n));
+        EXPECT_EQ(darr.dimension() - 1, empty_end.dimension());
+        EXPECT_EQ(0u, empty_end.shape()[0]);
+
+        EXPECT_THROW(load_npy_slice<double>("files/xnpy_files/double.npy", 3), std::out_of_range);
+        EXPECT_THROW(load_npy_slice<double>("files/xnpy_files/double.npy", range(1, 4)), std::out_of_range);
+        EXPECT_THROW(load_npy_slice<float>("files/xnpy_files/double.npy", 0), std::runtime_error);
+
+        // runs separated by small or large gaps
+        xarray<int> a = arange<int>(40 * 30 * 2000);
+        a.reshape({40, 30, 2000});
+        std::string filename = get_filename();
+        dump_npy(filename, a);
+        xarray<int> small_gaps = load_npy_slice<int>(filename, range(3, 7), range(0, 30, 2), range(10, 20));
+        EXPECT_EQ(xarray<int>(view(a, range(3, 7), range(0, 30, 2), range(10, 20))), small_gaps);
+        xarray<int> large_gaps = load_npy_slice<int>(filename, range(0, 40, 13), all(), range(1000, 1003));
+        EXPECT_EQ(xarray<int>(view(a, range(0, 40, 13), all(), range(1000, 1003))), large_gaps);
+        xarray<int> reversed = load_npy_slice<int>(filename, range(5, 1, -2), 3, range(7, 0, -3));
+        EXPECT_EQ(xarray<int>(view(a, range(5, 1, -2), 3, range(7, 0, -3))), reversed);
+        std::remove(filename.c_str());
+    }
+
+    TEST(xnpy, append)
+    {
+        xarray<double> a = arange<double>(10 * 4 * 3);
+        a.reshape({10, 4, 3});
+        std::string filename = get_filename();
+        {
+            xnpy_appender<double> appender(filename, std::vector<std::size_t>({4, 3}), 40);
+            EXPECT_EQ(0u, appender.size());
+            appender.flush();
+            auto empty = load_npy<double>(filename);
+            EXPECT_EQ(std::vector<std::size_t>({0, 4, 3}), empty.shape());
+
+            appender.append(view(a, 0));
+            appender.append(view(a, range(1, 4)) + 0.);
+            xarray<int> ia = view(a, range(4, 9));
+            appender.append(ia);
+            EXPECT_EQ(9u, appender.size());
+            appender.flush();
+            auto partial = load_npy<double>(filename);
+            EXPECT_TRUE(all(equal(view(a, range(0, 9)), partial)));
+
+            appender.append(view(a, 9));
+            EXPECT_THROW(appender.append(view(a, 0, 0)), std::runtime_error);
+            EXPECT_THROW(appender.append(view(a, all(), 0)), std::runtime_error);
+            EXPECT_EQ(std::vector<std::size_t>({10, 4, 3}), appender.shape());
+        }
+        auto loaded = load_npy<double>(filename);
+        EXPECT_EQ(a.shape(), loaded.shape());
+        EXPECT_TRUE(all(equal(a, loaded)));
+        std::remove(filename.c_str());
+
+        // a header longer than 64 KiB is written in the version 2.0 format
+        std::vector<std::size_t> row_shape(22000, 1);
+        row_shape[0] = 2;
+        {
+            xnpy_appender<int> appender(filename, row_shape);
+            xarray<int> row = arange<int>(2);
+            row.reshape(row_shape);
+            appender.append(row);
+            appender.append(row + 2);
+            appender.close();
+        }
+        std::ifstream stream(filename, std::ios::binary);
+        stream.seekg(6);
+        EXPECT_EQ(2, stream.get());
+        stream.close();
+        auto long_loaded = load_npy<int>(filename);
+        EXPECT_EQ(22001u, long_loaded.dimension());
+        EXPECT_EQ(4u, long_loaded.size());
+        EXPECT_TRUE(std::equal(long_loaded.cbegin(), long_loaded.cend(), arange<int>(4).cbegin()));
+        std::remove(filename.c_str());
+    }
+
+    TEST(xnpy, load_npz)
+    {
+        xarray<double> darr = load_npy<double>("files/xnpy_files/double.npy");
+        xarray<unsigned long> ularr = load_npy<unsigned long>("files/xnpy_files/unsignedlong.npy");
+
+        xnpz_file npz = load_npz("files/xnpy_files/arrays.npz");
+        EXPECT_EQ(std::vector<std::string>({"double", "unsignedlong", "bool"}), npz.names());
+        EXPECT_TRUE(npz.contains("double"));
+        EXPECT_FALSE(npz.contains("double.npy"));
+
+        auto dloaded = npz.load<double>("double");
+        EXPECT_TRUE(all(equal(darr, dloaded)));
+        auto ulloaded = npz.load<unsigned long>("unsignedlong");
+        EXPECT_TRUE(all(equal(ularr, ulloaded)));
+
+        EXPECT_THROW(npz.load<double>("missing"), std::out_of_range);
+        auto floaded = npz.load<float>("double");
+        xarray<float> fexpected = darr;
+        EXPECT_TRUE(all(equal(fexpected, floaded)));
+        // compressed member
+        EXPECT_THROW(npz.load<bool>("bool"), std::runtime_error);
+        EXPECT_THROW(load_npz("files/xnpy_files/double.npy"), std::runtime_error);
+
+#ifdef XTENSOR_NPY_MMAP
+        auto dmapped = npz.load_mmap<double>("double");
+        EXPECT_TRUE(all(equal(darr, dmapped)));
+        // data not aligned in the file
+        EXPECT_THROW(npz.load_mmap<unsigned long>("unsignedlong"), std::runtime_error);
+#endif
+    }
+
+    TEST(xnpy, dump_npz)
+    {
+        xarray<double> a = arange<double>(7 * 5 * 3);
+        a.reshape({7, 5, 3});
+        xarray<int, layout_type::column_major> b = {{1, 2, 3}, {4, 5, 6}};
+        xarray<double> expected = exp(a / 100.);
+
+        std::string filename = get_filename();
+        dump_npz(filename, "a", a, "expr", exp(a / 100.), "b", b);
+
+        xnpz_file npz = load_npz(filename);
+        EXPECT_EQ(std::vector<std::string>({"a", "expr", "b"}), npz.names());
+        auto aloaded = npz.load<double>("a");
+        EXPECT_EQ(a.shape(), aloaded.shape());
+        EXPECT_TRUE(all(equal(a, aloaded)));
+        auto eloaded = npz.load<double>("expr");
+        EXPECT_TRUE(all(equal(expected, eloaded)));
+        auto bloaded = npz.load<int, layout_type::column_major>("b");
+        EXPECT_TRUE(all(equal(b, bloaded)));
+
+#ifdef XTENSOR_NPY_MMAP
+        auto amapped = npz.load_mmap<double>("a");
+        EXPECT_TRUE(all(equal(a, amapped)));
+        auto emapped = npz.load_mmap<double>("expr", mmap_mode::read_only);
+        EXPECT_TRUE(all(equal(expected, emapped)));
+        auto bmapped = npz.load_mmap<int, layout_type::column_major>("b");
+        EXPECT_TRUE(all(equal(b, bmapped)));
+#endif
+        std::remove(filename.c_str());
+
+        // members written by chunks
+        {
+            xnpz_writer writer(filename, 64);
+            writer.add("expr", exp(a / 100.));
+            xarray<double> s = xarray<double>::from_shape({});
+            s() = 2.;
+            writer.add("scalar", s);
+            writer.close();
+            EXPECT_THROW(writer.add("a", a), std::runtime_error);
+        }
+        xnpz_file chunked = load_npz(filename);
+        auto cloaded = chunked.load<double>("expr");
+        EXPECT_TRUE(all(equal(expected, cloaded)));
+        auto sloaded = chunked.load<double>("scalar");
+        EXPECT_EQ(0u, sloaded.dimension());
+        EXPECT_EQ(2., sloaded());
+        std::remove(filename.c_str());
+    }
+
+#ifdef XTENSOR_NPY_MMAP
+    TEST(xnpy, load_mmap)
+    {
+        xarray<double> darr = load_npy<double>("files/xnpy_files/double.npy");
+
+        auto mapped = load_npy_mmap<double>("files/xnpy_files/double.npy");
+        EXPECT_EQ(darr.shape(), mapped.shape());
+        EXPECT_TRUE(all(equal(darr, mapped)));
+
+        // changes are not written to the file
+        mapped(0, 1, 2) = 42.;
+        EXPECT_EQ(42., mapped(0, 1, 2));
+        auto read_only = load_npy_mmap<double>("files/xnpy_files/double.npy", mmap_mode::read_only);
+        EXPECT_TRUE(all(equal(darr, read_only)));
+
+        // the mapping lives as long as the adaptor
+        auto moved = std::move(read_only);
+        EXPECT_EQ(darr(2, 2, 2), moved(2, 2, 2));
+
+        auto fortran = load_npy_mmap<double, layout_type::column_major>("files/xnpy_files/double_fortran.npy");
+        EXPECT_TRUE(all(equal(darr, fortran)));
+
+        xarray<bool> barr = load_npy<bool>("files/xnpy_files/bool.npy");
+        auto bmapped = load_npy_mmap<bool>("files/xnpy_files/bool.npy");
+        EXPECT_TRUE(all(equal(barr, bmapped)));
+
+        EXPECT_THROW(load_npy_mmap<float>("files/xnpy_files/double.npy"), std::runtime_error);
+        auto load_row_major = []() { return load_npy_mmap<double, layout_type::row_major>("files/xnpy_files/double_fortran.npy"); };
+        EXPECT_THROW(load_row_major(), std::runtime_error);
+        EXPECT_THROW(load_npy_mmap<double>("files/xnpy_files/missing.npy"), std::runtime_error);
+    }
+#endif
+}
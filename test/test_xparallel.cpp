@@ -0,0 +1,300 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille, Sylvain Corlay and Wolf Vollprecht    *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <atomic>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "xtensor/xaccumulator.hpp"
+#include "xtensor/xarray.hpp"
+#include "xtensor/xbuilder.hpp"
+#include "xtensor/xnoalias.hpp"
+#include "xtensor/xmath.hpp"
+#include "xtensor/xparallel.hpp"
+#include "xtensor/xtensor.hpp"
+#include "xtensor/xview.hpp"
+
+namespace xt
+{
+    TEST(xparallel, parallel_for)
+    {
+        std::vector<int> count(1000, 0);
+        parallel_for(count.size(), 10, [&count](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i != last; ++i)
+            {
+                ++count[i];
+            }
+        });
+        for (std::size_t i = 0; i < count.size(); ++i)
+        {
+            EXPECT_EQ(1, count[i]);
+        }
+
+        bool called = false;
+        parallel_for(0, 10, [&called](std::size_t first, std::size_t last) {
+            called = true;
+            EXPECT_EQ(first, last);
+        });
+        EXPECT_TRUE(called);
+    }
+
+    TEST(xparallel, parallel_for_exception)
+    {
+        auto f = [](std::size_t, std::size_t last) {
+            if (last == 1000)
+            {
+                throw std::runtime_error("last chunk");
+            }
+        };
+        EXPECT_THROW(parallel_for(1000, 1, f), std::runtime_error);
+    }
+
+#ifdef XTENSOR_USE_THREADS
+    TEST(xparallel, thread_pool)
+    {
+        xthread_pool pool(4);
+        EXPECT_EQ(4u, pool.concurrency());
+
+        std::vector<std::atomic<int>> count(100);
+        for (auto& c : count)
+        {
+            c = 0;
+        }
+        pool.run(count.size(), [&count](std::size_t i) { ++count[i]; });
+        for (std::size_t i = 0; i < count.size(); ++i)
+        {
+            EXPECT_EQ(1, count[i].load());
+        }
+
+        auto f = [](std::size_t i) {
+            if (i == 50)
+            {
+                throw std::runtime_error("task 50");
+            }
+        };
+        EXPECT_THROW(pool.run(100, f), std::runtime_error);
+
+        xthread_pool single(1);
+        EXPECT_EQ(1u, single.concurrency());
+        int sum = 0;
+        single.run(10, [&sum](std::size_t i) { sum += int(i); });
+        EXPECT_EQ(45, sum);
+    }
+
+    class counting_executor : public xexecutor
+    {
+    public:
+
+        std::size_t concurrency() const noexcept override
+        {
+            return 4;
+        }
+
+        void run(std::size_t nb_tasks, const task_type& task) override
+        {
+            ++m_nb_batches;
+            for (std::size_t i = 0; i < nb_tasks; ++i)
+            {
+                task(i);
+            }
+        }
+
+        std::size_t m_nb_batches = 0;
+    };
+
+    TEST(xparallel, executor)
+    {
+        counting_executor executor;
+        set_executor(&executor);
+        EXPECT_EQ(&executor, &get_executor());
+        EXPECT_EQ(4u, parallel_concurrency());
+
+        std::size_t nb_chunks = 0;
+        std::size_t nb_nested_chunks = 0;
+        parallel_for(1000, 1, [&](std::size_t, std::size_t) {
+            ++nb_chunks;
+            EXPECT_EQ(1u, parallel_concurrency());
+            parallel_for(1000, 1, [&](std::size_t first, std::size_t last) {
+                ++nb_nested_chunks;
+                EXPECT_EQ(0u, first);
+                EXPECT_EQ(1000u, last);
+            });
+        });
+        EXPECT_EQ(1u, executor.m_nb_batches);
+        EXPECT_EQ(4u, nb_chunks);
+        EXPECT_EQ(4u, nb_nested_chunks);
+
+        set_executor(nullptr);
+        EXPECT_NE(&executor, &get_executor());
+    }
+
+    TEST(xparallel, nested_parallel_for)
+    {
+        std::atomic<std::size_t> total(0);
+        parallel_for(64, 1, [&total](std::size_t first, std::size_t last) {
+            for (std::size_t i = first; i != last; ++i)
+            {
+                parallel_for(100, 1, [&total](std::size_t f, std::size_t l) { total += l - f; });
+            }
+        });
+        EXPECT_EQ(6400u, total.load());
+    }
+
+    TEST(xparallel, deterministic_reduction)
+    {
+        xtensor<double, 2>::shape_type shape = {700, 500};
+        xtensor<double, 2> a(shape);
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            a.data_element(i) = 1. / double(i + 1);
+        }
+
+        auto compute = [&a](std::size_t nb_threads) {
+            xthread_pool pool(nb_threads);
+            set_executor(&pool);
+            std::vector<xarray<double>> res;
+            res.push_back(sum(a));
+            res.push_back(sum(a, {0}));
+            res.push_back(mean(a, {1}));
+            res.push_back(amax(a, {0}));
+            xarray<double> lazy = sum(a * 3., {0, 1});
+            res.push_back(lazy);
+            set_executor(nullptr);
+            return res;
+        };
+
+        std::vector<xarray<double>> expected = compute(1);
+        for (std::size_t nb_threads : {2u, 4u})
+        {
+            std::vector<xarray<double>> res = compute(nb_threads);
+            for (std::size_t i = 0; i < res.size(); ++i)
+            {
+                ASSERT_EQ(expected[i].shape(), res[i].shape());
+                for (std::size_t j = 0; j < res[i].size(); ++j)
+                {
+                    EXPECT_EQ(expected[i].data_element(j), res[i].data_element(j));
+                }
+            }
+        }
+    }
+
+    TEST(xparallel, deterministic_scan)
+    {
+        xtensor<double, 1>::shape_type shape = {5 * XTENSOR_REDUCE_BLOCK_SIZE + 3};
+        xtensor<double, 1> a(shape);
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            a(i) = 1. / double(i + 1);
+        }
+        xtensor<double, 2>::shape_type bshape = {3072, 64};
+        xtensor<double, 2> b(bshape);
+        std::copy(a.cbegin(), a.cbegin() + std::ptrdiff_t(b.size()), b.begin());
+
+        auto compute = [&a, &b](std::size_t nb_threads) {
+            xthread_pool pool(nb_threads);
+            set_executor(&pool);
+            std::vector<xarray<double>> res;
+            res.push_back(cumsum(a, evaluation_strategy::lazy()));
+            res.push_back(cumprod(a + 1., 0));
+            res.push_back(cumsum(b, 0, evaluation_strategy::lazy()));
+            res.push_back(cumsum(b, 1));
+            set_executor(nullptr);
+            return res;
+        };
+
+        std::vector<xarray<double>> expected = compute(1);
+        for (std::size_t nb_threads : {2u, 4u})
+        {
+            std::vector<xarray<double>> res = compute(nb_threads);
+            for (std::size_t i = 0; i < res.size(); ++i)
+            {
+                ASSERT_EQ(expected[i].shape(), res[i].shape());
+                for (std::size_t j = 0; j < res[i].size(); ++j)
+                {
+                    EXPECT_EQ(expected[i].data_element(j), res[i].data_element(j));
+                }
+            }
+        }
+    }
+#endif
+
+    TEST(xparallel, trivial_assign)
+    {
+        xtensor<double, 2>::shape_type shape = {400, 300};
+        xtensor<double, 2> a(shape);
+        std::iota(a.begin(), a.end(), 0.);
+        xtensor<double, 2> b = 2. * a;
+        xtensor<double, 2> res(a.shape());
+        noalias(res) = a + b;
+        for (std::size_t i = 0; i < a.size(); ++i)
+        {
+            EXPECT_EQ(3. * a.data_element(i), res.data_element(i));
+        }
+
+        xtensor<int, 2> ires(a.shape());
+        noalias(ires) = a;
+        EXPECT_EQ(119999, ires(399, 299));
+    }
+
+    TEST(xparallel, stepper_assign)
+    {
+        xarray<double> a = arange<double>(400 * 300);
+        a.reshape({400, 300});
+        xarray<double> row = arange<double>(300);
+        xarray<double> col = arange<double>(400);
+        col.reshape({400, 1});
+
+        xarray<double> res = a + row + col;
+        xarray<double, layout_type::column_major> cres = a + row + col;
+        for (std::size_t i = 0; i < 400; ++i)
+        {
+            for (std::size_t j = 0; j < 300; ++j)
+            {
+                double expected = a(i, j) + double(i) + double(j);
+                EXPECT_EQ(expected, res(i, j));
+                EXPECT_EQ(expected, cres(i, j));
+            }
+        }
+
+        xarray<double> b = zeros<double>({400, 300});
+        auto v = view(b, range(1, 400), all());
+        v = view(a, range(1, 400), all());
+        EXPECT_EQ(0., b(0, 0));
+        EXPECT_EQ(a(1, 0), b(1, 0));
+        EXPECT_EQ(a(399, 299), b(399, 299));
+    }
+
+    TEST(xparallel, empty_assign)
+    {
+        xarray<double>::shape_type shape = {0, 3};
+        xarray<double> a(shape);
+        xarray<double> b = {1., 2., 3.};
+        xarray<double> res = a + b;
+        EXPECT_EQ(0u, res.size());
+        EXPECT_EQ(a.shape(), res.shape());
+        xarray<double, layout_type::column_major> cres = a + b;
+        EXPECT_EQ(0u, cres.size());
+    }
+
+    TEST(xparallel, accumulator_assign)
+    {
+        xarray<double> a = arange<double>(400 * 300);
+        a.reshape({400, 300});
+        for (std::size_t axis = 0; axis < 2; ++axis)
+        {
+            xarray<double> expected = cumsum(a, axis);
+            xarray<double> res = cumsum(a, axis, evaluation_strategy::lazy());
+            EXPECT_EQ(expected, res);
+            // element-wise assignment through the cache of the accumulator
+            xarray<double> fres = cumsum(a, axis, evaluation_strategy::lazy()) + 0.;
+            EXPECT_EQ(expected, fres);
+        }
+    }
+}
@@ -6,9 +6,20 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "xtensor/xrandom.hpp"
 #include "xtensor/xarray.hpp"
+#include "xtensor/xbroadcast.hpp"
+#include "xtensor/xbuilder.hpp"
+#include "xtensor/xparallel.hpp"
+#include "xtensor/xstrided_view.hpp"
+#include "xtensor/xtensor.hpp"
+#include "xtensor/xview.hpp"
 
 namespace xt
 {
@@ -58,5 +69,408 @@ namespace xt
         auto ac3 = xt::random::choice(a, 5);
         EXPECT_EQ(ac1, ac3);
         EXPECT_NE(ac1, ac2);
+
+        // engine without the replace flag
+        std::mt19937 engine(7);
+        auto ac4 = xt::random::choice(a, 5, engine);
+        engine.seed(7);
+        auto ac5 = xt::random::choice(a, 5, false, engine);
+        EXPECT_EQ(ac4, ac5);
+        auto ac6 = xt::random::choice(a, 5, true);
+        EXPECT_EQ(5u, ac6.size());
+    }
+
+    TEST(xrandom, choice_sparse)
+    {
+        xarray<int> a = arange<int>(100000);
+        random::seed(3);
+        auto c = random::choice(a, 10);
+        ASSERT_EQ(10u, c.size());
+        std::vector<int> sorted(c.cbegin(), c.cend());
+        std::sort(sorted.begin(), sorted.end());
+        EXPECT_TRUE(std::adjacent_find(sorted.cbegin(), sorted.cend()) == sorted.cend());
+
+        // every element is picked at the same rate
+        xarray<int> b = arange<int>(10);
+        std::vector<std::size_t> count(10, 0);
+        for (std::size_t i = 0; i < 20000; ++i)
+        {
+            for (int v : random::choice(b, 3))
+            {
+                ++count[std::size_t(v)];
+            }
+            ++count[std::size_t(random::choice(b, 10)(0))];
+        }
+        for (std::size_t v : count)
+        {
+            EXPECT_NEAR(8000., double(v), 400.);
+        }
+
+        auto all = random::choice(b, 10);
+        std::vector<int> sorted_all(all.cbegin(), all.cend());
+        std::sort(sorted_all.begin(), sorted_all.end());
+        EXPECT_TRUE(std::equal(sorted_all.cbegin(), sorted_all.cend(), b.cbegin()));
+        EXPECT_EQ(0u, random::choice(b, 0).size());
+    }
+
+    TEST(xrandom, choice_replace)
+    {
+        xarray<int> a = {4, 5, 6};
+        random::philox_engine engine(5);
+        auto c = random::choice(a, 30000, true, engine);
+        std::vector<std::size_t> count(3, 0);
+        for (int v : c)
+        {
+            ++count[std::size_t(v - 4)];
+        }
+        for (std::size_t v : count)
+        {
+            EXPECT_NEAR(10000., double(v), 500.);
+        }
+
+        // with weights, drawn from an alias table
+        xarray<double> w = {1., 0., 3.};
+        auto wc = random::choice(a, 40000, w, true, engine);
+        std::fill(count.begin(), count.end(), 0);
+        for (int v : wc)
+        {
+            ++count[std::size_t(v - 4)];
+        }
+        EXPECT_EQ(0u, count[1]);
+        EXPECT_NEAR(10000., double(count[0]), 500.);
+        EXPECT_NEAR(30000., double(count[2]), 500.);
+    }
+
+    TEST(xrandom, choice_weights)
+    {
+        xarray<int> a = {0, 1, 2, 3};
+        xarray<double> w = {1., 2., 0., 5.};
+        std::vector<std::size_t> first(4, 0);
+        for (std::size_t i = 0; i < 16000; ++i)
+        {
+            auto c = random::choice(a, 3, w);
+            EXPECT_NE(c(0), c(1));
+            EXPECT_NE(c(1), c(2));
+            EXPECT_NE(c(0), c(2));
+            EXPECT_TRUE(std::find(c.cbegin(), c.cend(), 2) == c.cend());
+            ++first[std::size_t(c(0))];
+        }
+        EXPECT_NEAR(2000., double(first[0]), 200.);
+        EXPECT_NEAR(4000., double(first[1]), 200.);
+        EXPECT_NEAR(10000., double(first[3]), 200.);
+    }
+
+    TEST(xrandom, choice_axis)
+    {
+        xarray<double> a = arange<double>(24);
+        a.reshape({2, 3, 4});
+        random::seed(8);
+        xarray<double> c = random::choice(a, 6, true, 1);
+        std::vector<std::size_t> expected_shape = {2, 6, 4};
+        EXPECT_TRUE(std::equal(expected_shape.cbegin(), expected_shape.cend(), c.shape().cbegin()));
+        for (std::size_t j = 0; j < 6; ++j)
+        {
+            double row = c(0, j, 0) / 4.;
+            for (std::size_t i = 0; i < 2; ++i)
+            {
+                for (std::size_t k = 0; k < 4; ++k)
+                {
+                    EXPECT_EQ(a(i, std::size_t(row), k), c(i, j, k));
+                }
+            }
+        }
+
+        xarray<double> w = {0., 1., 1., 0.};
+        std::size_t axis = 2;
+        xarray<double> d = random::choice(a, 2, w, false, axis);
+        std::vector<std::size_t> expected_dshape = {2, 3, 2};
+        EXPECT_TRUE(std::equal(expected_dshape.cbegin(), expected_dshape.cend(), d.shape().cbegin()));
+        EXPECT_NE(d(0, 0, 0), d(0, 0, 1));
+        EXPECT_EQ(a(1, 2, std::size_t(d(0, 0, 1))), d(1, 2, 1));
+
+        auto e = random::choice(view(a, 1, 2, all()), 4);
+        std::vector<double> sorted(e.cbegin(), e.cend());
+        std::sort(sorted.begin(), sorted.end());
+        EXPECT_EQ(20., sorted[0]);
+        EXPECT_EQ(23., sorted[3]);
+    }
+
+    TEST(xrandom, shuffle)
+    {
+        xarray<int> a = arange<int>(20);
+        random::seed(4);
+        random::shuffle(a);
+        std::vector<int> sorted(a.cbegin(), a.cend());
+        std::sort(sorted.begin(), sorted.end());
+        xarray<int> expected = arange<int>(20);
+        EXPECT_TRUE(std::equal(sorted.cbegin(), sorted.cend(), expected.cbegin()));
+        EXPECT_NE(expected, a);
+
+        // the slices along the axis are moved as a whole
+        xarray<int> b = arange<int>(60);
+        b.reshape({3, 4, 5});
+        xarray<int> c = b;
+        random::shuffle(c, 1);
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            std::size_t row = std::size_t(c(0, j, 0)) / 5;
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                for (std::size_t k = 0; k < 5; ++k)
+                {
+                    EXPECT_EQ(b(i, row, k), c(i, j, k));
+                }
+            }
+        }
+
+        random::philox_engine engine(9);
+        xtensor<int, 3> d = b;
+        random::shuffle(d, 2, engine);
+        xarray<int, layout_type::column_major> e = b;
+        random::philox_engine replay(9);
+        random::shuffle(e, 2, replay);
+        EXPECT_EQ(d, e);
+
+        auto v = view(c, 1, all(), all());
+        random::shuffle(v, engine);
+        std::vector<int> col(4);
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            col[j] = c(1, j, 0);
+            EXPECT_EQ(col[j] + 4, c(1, j, 4));
+        }
+        std::sort(col.begin(), col.end());
+        std::vector<int> expected_col = {20, 25, 30, 35};
+        EXPECT_EQ(expected_col, col);
+    }
+
+    TEST(xrandom, permutation)
+    {
+        // large enough to be scattered to several buckets
+        std::size_t n = 200000;
+        random::philox_engine engine(1);
+        xtensor<std::size_t, 1> p = random::permutation(n, engine);
+        std::vector<bool> seen(n, false);
+        double mean = 0.;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            ASSERT_LT(p(i), n);
+            EXPECT_FALSE(seen[p(i)]);
+            seen[p(i)] = true;
+            mean += i < 1000 ? double(p(i)) / 1000. : 0.;
+        }
+        EXPECT_NEAR(double(n) / 2., mean, double(n) / 20.);
+
+        random::philox_engine replay(1);
+        xtensor<double, 1> values = arange<double>(double(n));
+        random::shuffle(values, replay);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            EXPECT_EQ(double(p(i)), values(i));
+        }
+        EXPECT_EQ(engine.position(), replay.position());
+
+        // every position receives every value at the same rate
+        std::vector<std::size_t> count(25, 0);
+        for (std::size_t i = 0; i < 20000; ++i)
+        {
+            auto q = random::permutation(5, engine);
+            ++count[std::size_t(q(0) * 5 + q(3))];
+        }
+        for (std::size_t i = 0; i < 5; ++i)
+        {
+            for (std::size_t j = 0; j < 5; ++j)
+            {
+                EXPECT_NEAR(i == j ? 0. : 1000., double(count[i * 5 + j]), 150.);
+            }
+        }
+
+        xarray<int> a = arange<int>(12);
+        a.reshape({3, 4});
+        xarray<int> pa = random::permutation(a, 1);
+        EXPECT_EQ(a.shape(), pa.shape());
+        EXPECT_EQ(pa(0, 2) + 4, pa(1, 2));
+    }
+
+    TEST(xrandom, philox_engine)
+    {
+        // known answers of the reference implementation
+        random::philox_engine zero(0);
+        random::philox_engine::block_type expected = {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}};
+        EXPECT_EQ(expected, zero.block(0));
+        expected = {{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}};
+        EXPECT_EQ(expected, detail::philox4x32_10({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}}, {{0xa4093822, 0x299f31d0}}));
+
+        random::philox_engine engine(42);
+        random::philox_engine other(42);
+        for (std::uint64_t i = 0; i < 3; ++i)
+        {
+            auto b = other.block(i);
+            for (std::size_t j = 0; j < 4; ++j)
+            {
+                EXPECT_EQ(b[j], engine());
+            }
+        }
+        EXPECT_EQ(3u, engine.position());
+
+        engine.seed(42);
+        engine();
+        other.seed(42);
+        other();
+        engine.discard(9);
+        for (int i = 0; i < 9; ++i)
+        {
+            other();
+        }
+        EXPECT_EQ(other, engine);
+        EXPECT_EQ(other(), engine());
+
+        std::uniform_int_distribution<int> dist(0, 9);
+        int value = dist(engine);
+        EXPECT_TRUE(value >= 0 && value <= 9);
+    }
+
+    TEST(xrandom, counter_based)
+    {
+        random::philox_engine engine(7);
+        auto r = random::rand<double>({40, 30}, -1., 1., engine);
+        EXPECT_EQ(1200u, engine.position());
+
+        xtensor<double, 2> a = r;
+        xtensor<double, 2> b = r;
+        EXPECT_EQ(a, b);
+        EXPECT_TRUE(std::all_of(a.cbegin(), a.cend(), [](double d) { return d >= -1. && d < 1.; }));
+
+        // the values only depend on the seed and the index
+        random::philox_engine replay(7);
+        xtensor<double, 2> c = random::rand<double>({40, 30}, -1., 1., replay);
+        EXPECT_EQ(a, c);
+        xtensor<double, 2> part = view(r, range(10, 20), range(5, 30));
+        xtensor<double, 2> expected_part = view(a, range(10, 20), range(5, 30));
+        EXPECT_EQ(expected_part, part);
+        EXPECT_EQ(a(12, 7), r(12, 7));
+        EXPECT_EQ(a(12, 7), r(3, 12, 7));
+
+        xtensor<double, 2> d = random::rand<double>({40, 30}, -1., 1., engine);
+        EXPECT_NE(a, d);
+
+        xtensor<int, 1> i = random::randint<int>({1000}, -3, 4, engine);
+        EXPECT_EQ(-3, *std::min_element(i.cbegin(), i.cend()));
+        EXPECT_EQ(3, *std::max_element(i.cbegin(), i.cend()));
+        xtensor<std::uint64_t, 1> u = random::randint<std::uint64_t>({1000}, 0, std::numeric_limits<std::uint64_t>::max(), engine);
+        EXPECT_GT(*std::max_element(u.cbegin(), u.cend()), std::numeric_limits<std::uint64_t>::max() / 2);
+
+        xtensor<double, 1> n = random::randn<double>({100000}, 2., 3., engine);
+        double mean = 0.;
+        for (double v : n)
+        {
+            mean += v;
+        }
+        mean /= double(n.size());
+        double var = 0.;
+        for (double v : n)
+        {
+            var += (v - mean) * (v - mean);
+        }
+        var /= double(n.size());
+        EXPECT_NEAR(2., mean, 0.05);
+        EXPECT_NEAR(9., var, 0.2);
+
+        xtensor<float, 1> f = random::rand<float>({1000}, 0.f, 1.f, engine);
+        EXPECT_TRUE(std::all_of(f.cbegin(), f.cend(), [](float v) { return v >= 0.f && v < 1.f; }));
+    }
+
+    TEST(xrandom, bulk_fill)
+    {
+        random::philox_engine engine(11);
+        auto u = random::rand<double>({37, 29}, 0., 1., engine);
+        auto i = random::randint<int>({37, 29}, -100, 100, engine);
+        auto n = random::randn<float>({37, 29}, 0.f, 1.f, engine);
+
+        // contiguous row-major containers are filled in bulk, the other ones
+        // through the element access of the generator
+        xtensor<double, 2> ut = u;
+        xarray<int> ia = i;
+        xarray<float> na = n;
+        xarray<double, layout_type::column_major> uc = u;
+        xarray<float, layout_type::column_major> nc = n;
+        for (std::size_t k = 0; k < 37; ++k)
+        {
+            for (std::size_t l = 0; l < 29; ++l)
+            {
+                EXPECT_EQ(u(k, l), ut(k, l));
+                EXPECT_EQ(u(k, l), uc(k, l));
+                EXPECT_EQ(i(k, l), ia(k, l));
+                EXPECT_EQ(n(k, l), na(k, l));
+                EXPECT_EQ(n(k, l), nc(k, l));
+            }
+        }
+
+        // the generators of the standard engines are filled in bulk as well
+        random::seed(0);
+        xarray<double> a = random::randn<double>({20, 30});
+        random::seed(0);
+        auto g = random::randn<double>({20, 30});
+        xarray<double, layout_type::column_major> b = g;
+        for (std::size_t k = 0; k < a.size(); ++k)
+        {
+            EXPECT_EQ(a.data_element(k), b.data_element(k));
+        }
+    }
+
+#ifdef XTENSOR_USE_THREADS
+    TEST(xrandom, counter_based_parallel)
+    {
+        random::philox_engine engine(3);
+        auto r = random::randn<double>({1000, 500}, 0., 1., engine);
+        xtensor<double, 2> serial = r;
+        xthread_pool pool(4);
+        set_executor(&pool);
+        xtensor<double, 2> parallel = r;
+        xarray<double> shared = random::rand<double>({1000, 500});
+        set_executor(nullptr);
+        EXPECT_EQ(serial, parallel);
+        EXPECT_TRUE(std::all_of(shared.cbegin(), shared.cend(), [](double d) { return d >= 0. && d < 1.; }));
+    }
+
+    TEST(xrandom, shared_engine_parallel)
+    {
+        // expressions drawing from a standard engine are assigned in order
+        auto compute = [](std::size_t nb_threads) {
+            std::mt19937 engine(42);
+            xthread_pool pool(nb_threads);
+            set_executor(&pool);
+            xarray<double, layout_type::column_major> res = 2. * random::rand<double>({1000, 500}, 0., 1., engine);
+            set_executor(nullptr);
+            return res;
+        };
+        EXPECT_EQ(compute(1), compute(4));
+
+        // through views and broadcasts
+        auto compute_views = [](std::size_t nb_threads) {
+            std::mt19937 engine(42);
+            xthread_pool pool(nb_threads);
+            set_executor(&pool);
+            std::vector<xarray<double>> res;
+            res.push_back(broadcast(random::rand<double>({3}, 0., 1., engine), {100000, 3}));
+            auto r = random::rand<double>({1000, 500}, 0., 1., engine);
+            res.push_back(dynamic_view(r, slice_vector(r, range(0, 1000), range(100, 500))));
+            set_executor(nullptr);
+            return res;
+        };
+        EXPECT_EQ(compute_views(1), compute_views(4));
+    }
+
+    TEST(xrandom, permutation_parallel)
+    {
+        random::philox_engine engine(6);
+        xtensor<std::uint32_t, 1> serial = random::permutation(std::uint32_t(1000000), engine);
+        xthread_pool pool(4);
+        set_executor(&pool);
+        engine.seed(6);
+        xtensor<std::uint32_t, 1> parallel = random::permutation(std::uint32_t(1000000), engine);
+        set_executor(nullptr);
+        EXPECT_EQ(serial, parallel);
     }
+#endif
 }
@@ -6,12 +6,17 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <numeric>
+
 #include "gtest/gtest.h"
 #include "xtensor/xarray.hpp"
 #include "xtensor/xtensor.hpp"
+#include "xtensor/xbroadcast.hpp"
 #include "xtensor/xbuilder.hpp"
 #include "xtensor/xmath.hpp"
+#include "xtensor/xnorm.hpp"
 #include "xtensor/xreducer.hpp"
+#include "xtensor/xview.hpp"
 
 namespace xt
 {
@@ -240,4 +245,274 @@ namespace xt
         a_gd = sum(a, {1, 2, 3}, evaluation_strategy::immediate());
         EXPECT_EQ(a_lz, a_gd);
     }
+
+    TEST(xreducer, immediate_expression)
+    {
+        xarray<double> a = xt::arange(4 * 3 * 6 * 5);
+        a.reshape({4, 3, 6, 5});
+        xarray<double> b = 2. * a;
+        xarray<double> c = xt::arange(5);
+
+        xarray<double> a_lz = sum(a * b - c, {1});
+        xarray<double> a_gd = sum(a * b - c, {1}, evaluation_strategy::immediate());
+        EXPECT_EQ(a_lz, a_gd);
+
+        a_lz = sum(a * b - c, {1, 3});
+        a_gd = sum(a * b - c, {1, 3}, evaluation_strategy::immediate());
+        EXPECT_EQ(a_lz, a_gd);
+
+        a_lz = sum(a * b - c, {0, 2, 3});
+        a_gd = sum(a * b - c, {0, 2, 3}, evaluation_strategy::immediate());
+        EXPECT_EQ(a_lz, a_gd);
+
+        double all_gd = sum(a - c, evaluation_strategy::immediate())();
+        EXPECT_EQ(sum(a - c)(), all_gd);
+
+        auto v = view(a, all(), 1, range(1, 5));
+        a_lz = sum(v, {0});
+        a_gd = sum(v, {0}, evaluation_strategy::immediate());
+        EXPECT_EQ(a_lz, a_gd);
+
+        auto bc = broadcast(c, {3, 4, 5});
+        a_lz = amax(bc, {1});
+        a_gd = amax(bc, {1}, evaluation_strategy::immediate());
+        EXPECT_EQ(a_lz, a_gd);
+
+        xarray<double, layout_type::column_major> ca = a;
+        xarray<double, layout_type::column_major> ca_lz = sum(ca + ca, {0, 3});
+        auto ca_gd = sum(ca + ca, {0, 3}, evaluation_strategy::immediate());
+        EXPECT_EQ(layout_type::column_major, ca_gd.layout());
+        EXPECT_EQ(ca_lz, ca_gd);
+
+        xtensor<double, 2> t = view(a, 0, 0, all(), all());
+        xarray<double> t_lz = sum(t, {0});
+        auto t_gd = sum(t, {0}, evaluation_strategy::immediate());
+        EXPECT_EQ(t_lz, t_gd);
+
+        // extent-1 reduced axis
+        xarray<double> o = ones<double>({3, 1});
+        xarray<double> o_gd = sum(o, {1}, evaluation_strategy::immediate());
+        EXPECT_EQ(ones<double>({3}), o_gd);
+    }
+
+    template <class E>
+    xarray<double> sum_last_axes(const E& e, std::size_t nb_axes)
+    {
+        std::size_t outer = 1;
+        for (std::size_t i = 0; i < e.dimension() - nb_axes; ++i)
+        {
+            outer *= e.shape()[i];
+        }
+        std::size_t inner = e.size() / outer;
+        xarray<double> a = e;
+        xarray<double> res = zeros<double>({outer});
+        for (std::size_t i = 0; i < outer; ++i)
+        {
+            for (std::size_t j = 0; j < inner; ++j)
+            {
+                res(i) += a.data_element(i * inner + j);
+            }
+        }
+        return res;
+    }
+
+    TEST(xreducer, simd_reduce)
+    {
+        xarray<double> a = xt::arange(5 * 3 * 19);
+        a.reshape({5, 3, 19});
+        xarray<double> b = 2. * a;
+
+        xarray<double> res = sum(a * b, {2});
+        xarray<double> expected = sum_last_axes(a * b, 1);
+        expected.reshape({5, 3});
+        EXPECT_EQ(expected, res);
+
+        res = sum(a + b, {1, 2});
+        expected = sum_last_axes(a + b, 2);
+        EXPECT_EQ(expected, res);
+
+        res = sum(a, {0, 2});
+        xarray<double> expected_02 = sum(a, {0, 2}, evaluation_strategy::immediate());
+        EXPECT_EQ(expected_02, res);
+
+        // Broadcasting expressions and non contiguous axes fall back to the scalar loop
+        xarray<double> row = xt::arange(19);
+        res = sum(a + row, {2});
+        expected = sum_last_axes(a + row, 1);
+        expected.reshape({5, 3});
+        EXPECT_EQ(expected, res);
+
+        res = sum(a, {1});
+        xarray<double> expected_1 = sum(a, {1}, evaluation_strategy::immediate());
+        EXPECT_EQ(expected_1, res);
+
+        xarray<double, layout_type::column_major> ca = a;
+        res = sum(ca, {0});
+        xarray<double> expected_0 = sum(a, {0}, evaluation_strategy::immediate());
+        EXPECT_EQ(expected_0, res);
+        res = sum(ca, {2});
+        xarray<double> expected_2 = sum(a, {2}, evaluation_strategy::immediate());
+        EXPECT_EQ(expected_2, res);
+
+        xtensor<double, 3> t = a;
+        auto red = amax(t - 1., {1, 2});
+        EXPECT_EQ(5u, red.shape()[0]);
+        for (std::size_t i = 0; i < 5; ++i)
+        {
+            EXPECT_EQ(a(i, 2, 18) - 1., red(i));
+        }
+
+        xarray<int64_t> ia = xt::arange<int64_t>(3 * 7);
+        ia.reshape({3, 7});
+        xarray<int64_t> ires = prod(ia + int64_t(1), {1});
+        EXPECT_EQ(5040, ires(0));
+        EXPECT_EQ(17297280, ires(1));
+
+        // Short inner axes are reduced with scalar code only
+        xarray<double> s = ones<double>({4, 2});
+        xarray<double> sres = sum(s, {1});
+        EXPECT_EQ(2., sres(3));
+    }
+
+    template <class R>
+    void check_element_wise(const R& red, const xarray<double>& res)
+    {
+        ASSERT_EQ(red.shape().size(), res.dimension());
+        xarray<double> expected = zeros<double>(res.shape());
+        auto it = expected.begin();
+        xindex index(res.dimension(), 0);
+        for (std::size_t i = 0; i < expected.size(); ++i, ++it)
+        {
+            *it = red.element(index.cbegin(), index.cend());
+            for (std::size_t k = index.size(); k != 0; --k)
+            {
+                if (++index[k - 1] != res.shape()[k - 1])
+                {
+                    break;
+                }
+                index[k - 1] = 0;
+            }
+        }
+        EXPECT_TRUE(allclose(expected, res));
+    }
+
+    TEST(xreducer, output_major)
+    {
+        xtensor<double, 2>::shape_type shape = {37, 21};
+        xtensor<double, 2> m(shape);
+        std::iota(m.begin(), m.end(), 0.);
+        xtensor<double, 1> col_sums = sum(m, {0});
+        xarray<double> am = m;
+        xarray<double> expected_col_sums = sum(am, {0}, evaluation_strategy::immediate());
+        EXPECT_EQ(expected_col_sums(20), col_sums(20));
+        check_element_wise(sum(m, {0}), col_sums);
+
+        xarray<double> a = xt::arange(4 * 5 * 6 * 7);
+        a.reshape({4, 5, 6, 7});
+        xarray<double> b = a - 100.;
+        xarray<double> res = sum(a * b, {0, 2});
+        check_element_wise(sum(a * b, {0, 2}), res);
+        res = sum(a, {1});
+        check_element_wise(sum(a, {1}), res);
+        res = amax(b, {0, 1, 2});
+        check_element_wise(amax(b, {0, 1, 2}), res);
+        res = prod(a / 100., {0, 1});
+        check_element_wise(prod(a / 100., {0, 1}), res);
+
+        xarray<double, layout_type::column_major> ca = a;
+        xarray<double, layout_type::column_major> cres = sum(ca, {1, 3});
+        check_element_wise(sum(ca, {1, 3}), cres);
+
+        // init function and result of another value type
+        xarray<double> la = norm_l1(b, {0});
+        check_element_wise(norm_l1(b, {0}), la);
+        xarray<int> ires = sum(a, {0});
+        EXPECT_EQ(int(a(0, 1, 2, 3) + a(1, 1, 2, 3) + a(2, 1, 2, 3) + a(3, 1, 2, 3)), ires(1, 2, 3));
+    }
+
+    TEST(xreducer, blocks)
+    {
+        // reductions of more than XTENSOR_REDUCE_BLOCK_SIZE elements are split into blocks
+        std::size_t n = 3 * XTENSOR_REDUCE_BLOCK_SIZE + 17;
+        xarray<int64_t> ia = xt::arange<int64_t>(int64_t(n));
+        int64_t expected = int64_t(n) * int64_t(n - 1) / 2;
+        EXPECT_EQ(expected, sum(ia)());
+        EXPECT_EQ(int64_t(n - 1), amax(ia)());
+        EXPECT_EQ(int64_t(0), amin(ia + int64_t(0))());
+
+        xarray<double> a = xt::arange<double>(double(n));
+        EXPECT_NEAR(double(expected), sum(a)(), 1e-6 * double(expected));
+        EXPECT_NEAR(double(n - 1) / 2., mean(a)(), 1e-9 * double(n));
+
+        xarray<double> b = xt::arange<double>(4. * 300. * 200.);
+        b.reshape({4, 300, 200});
+        xarray<double> b_lz = sum(b / 7., {0, 2});
+        xarray<double> b_gd = sum(b / 7., {0, 2}, evaluation_strategy::immediate());
+        EXPECT_TRUE(allclose(b_gd, b_lz));
+        xarray<double> bm_lz = amax(b, {1, 2});
+        EXPECT_EQ(b(2, 299, 199), bm_lz(2));
+        xarray<double> bn_lz = norm_l1(b - 1000., {0, 1, 2});
+        xarray<double> bn_gd = sum(abs(b - 1000.), {0, 1, 2}, evaluation_strategy::immediate());
+        EXPECT_TRUE(allclose(bn_gd, bn_lz));
+
+        // boolean partial results
+        xarray<bool> all_lz = reduce(make_xreducer_functor(std::logical_and<bool>()), ia >= int64_t(0));
+        EXPECT_TRUE(all_lz());
+
+        // functions without a merge functor are applied in sequence
+        auto smooth = [](double r, double v) { return 0.5 * r + v; };
+        double smoothed = a(0);
+        for (std::size_t i = 1; i < n; ++i)
+        {
+            smoothed = smooth(smoothed, a(i));
+        }
+        EXPECT_EQ(smoothed, reduce(make_xreducer_functor(smooth), a)());
+    }
+
+    TEST(xreducer, summation)
+    {
+        // 0.1 is not representable: the rounding errors of a naive sum add up
+        std::size_t n = 1000003;
+        xtensor<double, 1> a = xtensor<double, 1>::from_shape({n});
+        std::fill(a.begin(), a.end(), 0.1);
+        double expected = static_cast<double>(static_cast<long double>(0.1) * static_cast<long double>(n));
+
+        double naive = sum<summation::naive>(a)();
+        double pairwise = sum(a)();
+        double kahan = sum<summation::kahan>(a)();
+        EXPECT_GT(std::abs(naive - expected), 1e-8);
+        EXPECT_NEAR(expected, pairwise, 1e-9);
+        EXPECT_NEAR(expected, kahan, 1e-10);
+        EXPECT_NEAR(expected, sum(a, evaluation_strategy::immediate())(), 1e-9);
+        EXPECT_NEAR(expected, sum<summation::kahan>(a, evaluation_strategy::immediate())(), 1e-10);
+        EXPECT_NEAR(0.1, mean(a)(), 1e-15);
+        EXPECT_NEAR(0.1, mean<summation::kahan>(a)(), 1e-15);
+
+        // sums along an axis, through the stepper and through expressions
+        xtensor<double, 2> b = xtensor<double, 2>::from_shape({3, n / 3 + 1});
+        std::fill(b.begin(), b.end(), 0.1);
+        double row_expected = static_cast<double>(static_cast<long double>(0.1) * static_cast<long double>(n / 3 + 1));
+        xtensor<double, 1> rows = sum(b, {1});
+        xtensor<double, 1> krows = sum<summation::kahan>(b + 0., {1});
+        xtensor<double, 1> grows = sum(b + 0., {1}, evaluation_strategy::immediate());
+        xtensor<double, 1> means = mean<summation::pairwise>(b, {1});
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            EXPECT_NEAR(row_expected, rows(i), 1e-10);
+            EXPECT_NEAR(row_expected, krows(i), 1e-10);
+            EXPECT_NEAR(row_expected, grows(i), 1e-10);
+            EXPECT_NEAR(0.1, means(i), 1e-15);
+        }
+
+        // compensated sums of outer axes are computed element-wise
+        xtensor<double, 2> c = xtensor<double, 2>::from_shape({n / 3 + 1, 3});
+        std::fill(c.begin(), c.end(), 0.1);
+        xtensor<double, 1> cols = sum<summation::kahan>(c, {0});
+        EXPECT_NEAR(row_expected, cols(1), 1e-10);
+
+        // integral sums are exact with any policy
+        xtensor<int, 1> ia = arange<int>(1000);
+        EXPECT_EQ(499500, sum<summation::kahan>(ia)());
+        EXPECT_EQ(499500, sum(ia, evaluation_strategy::immediate())());
+    }
 }
@@ -0,0 +1,279 @@
+/***************************************************************************
+* Copyright (c) 2016, Johan Mabille, Sylvain Corlay and Wolf Vollprecht    *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "xtensor/xarray.hpp"
+#include "xtensor/xbuilder.hpp"
+#include "xtensor/xparallel.hpp"
+#include "xtensor/xsort.hpp"
+#include "xtensor/xtensor.hpp"
+#include "xtensor/xview.hpp"
+
+namespace xt
+{
+    TEST(xsort, sort)
+    {
+        xarray<double> a = {{5., 3., 1.}, {4., 4., 2.}};
+        xarray<double> expected_last = {{1., 3., 5.}, {2., 4., 4.}};
+        xarray<double> expected_first = {{4., 3., 1.}, {5., 4., 2.}};
+        EXPECT_EQ(expected_last, sort(a));
+        EXPECT_EQ(expected_last, sort(a, 1));
+        EXPECT_EQ(expected_first, sort(a, 0));
+        EXPECT_EQ(expected_first, sort(a, -2));
+        EXPECT_THROW(sort(a, 2), std::runtime_error);
+
+        xtensor<int, 2> t = {{3, -1}, {-2, 0}};
+        auto st = sort(t, 0);
+        bool is_xtensor = std::is_same<decltype(st), xtensor<int, 2>>::value;
+        EXPECT_TRUE(is_xtensor);
+        xtensor<int, 2> expected_t = {{-2, -1}, {3, 0}};
+        EXPECT_EQ(expected_t, st);
+
+        // expressions and column-major containers
+        xarray<double> expected_expr = {{2., 4., 6.}, {3., 5., 5.}};
+        EXPECT_EQ(expected_expr, sort(a + 1.));
+        xarray<double, layout_type::column_major> c = a;
+        xarray<double, layout_type::column_major> sc = sort(c);
+        EXPECT_EQ(expected_last, sc);
+        xarray<double> sv = sort(view(a, all(), range(0, 2)), 0);
+        xarray<double> expected_view = {{4., 3.}, {5., 4.}};
+        EXPECT_EQ(expected_view, sv);
+    }
+
+    TEST(xsort, argsort)
+    {
+        xarray<double> a = {{5., 3., 1.}, {4., 4., 2.}};
+        xarray<std::size_t> expected_last = {{2, 1, 0}, {2, 0, 1}};
+        xarray<std::size_t> expected_first = {{1, 0, 0}, {0, 1, 1}};
+        EXPECT_EQ(expected_last, argsort(a, -1, sorting_method::stable));
+        EXPECT_EQ(expected_first, argsort(a, 0));
+        EXPECT_EQ(expected_first, argsort(a * 2., 0));
+        xarray<double, layout_type::column_major> c = a;
+        EXPECT_EQ(expected_last, argsort(c, 1, sorting_method::stable));
+    }
+
+    TEST(xsort, nan)
+    {
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        double inf = std::numeric_limits<double>::infinity();
+        for (std::size_t n : {6u, 1000u})
+        {
+            xtensor<double, 1> a = xt::arange<double>(double(n)) * -1.;
+            a(1) = nan;
+            a(3) = -nan;
+            a(4) = -inf;
+            a(n - 1) = inf;
+            auto s = sort(a);
+            EXPECT_EQ(-inf, s(0));
+            EXPECT_EQ(inf, s(n - 3));
+            EXPECT_TRUE(std::isnan(s(n - 2)));
+            EXPECT_TRUE(std::isnan(s(n - 1)));
+            EXPECT_TRUE(std::is_sorted(s.cbegin(), s.cbegin() + std::ptrdiff_t(n - 2)));
+
+            auto i = argsort(a, 0, sorting_method::stable);
+            EXPECT_EQ(4u, i(0));
+            EXPECT_EQ(n - 1, i(n - 3));
+            EXPECT_EQ(1u, i(n - 2));
+            EXPECT_EQ(3u, i(n - 1));
+        }
+    }
+
+    template <class T>
+    void check_radix(std::size_t n)
+    {
+        std::mt19937 engine(n);
+        std::uniform_int_distribution<int> dist(-100, 100);
+        xtensor<T, 2> a = xtensor<T, 2>::from_shape({3, n});
+        std::generate(a.begin(), a.end(), [&]() { return static_cast<T>(dist(engine)); });
+        if (std::is_floating_point<T>::value)
+        {
+            a(0, 0) = T(-0.);
+            a(0, 1) = T(0.);
+        }
+        for (std::ptrdiff_t axis : {0, 1})
+        {
+            auto s = sort(a, axis);
+            auto i = argsort(a, axis, sorting_method::stable);
+            auto q = argsort(a, axis);
+            std::size_t extent = a.shape()[std::size_t(axis)];
+            std::size_t nb_lines = a.size() / extent;
+            for (std::size_t l = 0; l < nb_lines; ++l)
+            {
+                std::vector<T> line(extent);
+                for (std::size_t k = 0; k < extent; ++k)
+                {
+                    line[k] = axis == 0 ? a(k, l) : a(l, k);
+                }
+                std::vector<std::size_t> expected(extent);
+                std::iota(expected.begin(), expected.end(), std::size_t(0));
+                std::stable_sort(expected.begin(), expected.end(), [&line](std::size_t x, std::size_t y) { return line[x] < line[y]; });
+                for (std::size_t k = 0; k < extent; ++k)
+                {
+                    std::size_t si = axis == 0 ? i(k, l) : i(l, k);
+                    std::size_t qi = axis == 0 ? q(k, l) : q(l, k);
+                    T sv = axis == 0 ? s(k, l) : s(l, k);
+                    EXPECT_EQ(expected[k], si);
+                    EXPECT_EQ(line[expected[k]], line[qi]);
+                    EXPECT_EQ(line[expected[k]], sv);
+                }
+            }
+        }
+    }
+
+    TEST(xsort, radix)
+    {
+        check_radix<double>(3000);
+        check_radix<float>(3000);
+        check_radix<int>(3000);
+        check_radix<std::int8_t>(3000);
+        check_radix<std::uint16_t>(3000);
+        check_radix<std::int64_t>(3000);
+        check_radix<double>(30);
+    }
+
+    TEST(xsort, empty)
+    {
+        xarray<double> a = xarray<double>::from_shape({0, 3});
+        EXPECT_EQ(a.shape(), sort(a).shape());
+        EXPECT_EQ(a.shape(), argsort(a, 0).shape());
+    }
+
+    TEST(xsort, partition)
+    {
+        xarray<double> a = {{5., 3., 1., 4.}, {2., 8., 7., 2.}};
+        for (std::size_t kth = 0; kth < 4; ++kth)
+        {
+            xarray<double> p = partition(a, kth);
+            xarray<std::size_t> i = argpartition(a, kth);
+            xarray<double> s = sort(a);
+            for (std::size_t r = 0; r < 2; ++r)
+            {
+                EXPECT_EQ(s(r, kth), p(r, kth));
+                EXPECT_EQ(s(r, kth), a(r, i(r, kth)));
+                for (std::size_t k = 0; k < 4; ++k)
+                {
+                    EXPECT_EQ(k < kth, p(r, k) < p(r, kth) || (k < kth && p(r, k) == p(r, kth)));
+                    EXPECT_EQ(p(r, k) <= p(r, kth), a(r, i(r, k)) <= p(r, kth));
+                }
+            }
+        }
+        xarray<double> expected_first = {{2., 3., 1., 2.}, {5., 8., 7., 4.}};
+        EXPECT_EQ(expected_first, partition(a, 0, 0));
+        xarray<std::size_t> expected_indices = {{1, 0, 0, 1}, {0, 1, 1, 0}};
+        EXPECT_EQ(expected_indices, argpartition(a, 0, 0));
+        EXPECT_THROW(partition(a, 4), std::runtime_error);
+        EXPECT_THROW(argpartition(a, 2, 0), std::runtime_error);
+    }
+
+    TEST(xsort, median)
+    {
+        xarray<double> a = {{5., 3., 1., 4.}, {2., 8., 7., 2.}, {0., 1., 9., 6.}};
+        xarray<double> expected_0 = {2., 3., 7., 4.};
+        xarray<double> expected_1 = {3.5, 4.5, 3.5};
+        EXPECT_EQ(expected_0, median(a, {0}));
+        EXPECT_EQ(expected_1, median(a, {1}));
+        EXPECT_EQ(expected_1, median(a, {-1}));
+        EXPECT_EQ(expected_1, median(a, std::vector<std::size_t>({1})));
+        EXPECT_EQ(3.5, median(a));
+        EXPECT_EQ(3.5, median(a, {0, 1})());
+        EXPECT_EQ(expected_0, median(a * 1., {0}));
+        xarray<double, layout_type::column_major> c = a;
+        EXPECT_EQ(expected_1, median(c, {1}));
+
+        xtensor<int, 3> t = {{{1, 2}, {3, 4}}, {{5, 6}, {7, 8}}};
+        xarray<double> expected_t = {3.5, 5.5};
+        EXPECT_EQ(expected_t, median(t, {0, 2}));
+        bool is_double = std::is_same<decltype(median(t)), double>::value;
+        EXPECT_TRUE(is_double);
+        EXPECT_EQ(4.5, median(t));
+
+        EXPECT_THROW(median(a, {2}), std::runtime_error);
+        EXPECT_THROW(median(a, {1, -1}), std::runtime_error);
+    }
+
+    TEST(xsort, quantile)
+    {
+        std::mt19937 engine(0);
+        std::uniform_real_distribution<double> dist;
+        xtensor<double, 2> a = xtensor<double, 2>::from_shape({7, 30});
+        std::generate(a.begin(), a.end(), [&]() { return dist(engine); });
+        for (double q : {0., 0.1, 0.25, 0.5, 0.9, 1.})
+        {
+            xarray<double> res = quantile(a, q, {1});
+            ASSERT_EQ(std::vector<std::size_t>({7}), std::vector<std::size_t>(res.shape().cbegin(), res.shape().cend()));
+            for (std::size_t r = 0; r < 7; ++r)
+            {
+                std::vector<double> line(a.cbegin() + std::ptrdiff_t(r * 30), a.cbegin() + std::ptrdiff_t((r + 1) * 30));
+                std::sort(line.begin(), line.end());
+                double h = q * 29.;
+                std::size_t k = static_cast<std::size_t>(h);
+                double expected = k == 29 ? line[k] : line[k] + (h - double(k)) * (line[k + 1] - line[k]);
+                EXPECT_NEAR(expected, res(r), 1e-12);
+            }
+        }
+        xarray<int> b = {4, 1, 3, 2};
+        EXPECT_EQ(1., quantile(b, 0.));
+        EXPECT_EQ(4., quantile(b, 1.));
+        EXPECT_EQ(1.75, quantile(b, 0.25));
+        EXPECT_EQ(median(b), quantile(b, 0.5));
+        EXPECT_THROW(quantile(b, 1.5), std::runtime_error);
+        EXPECT_THROW(quantile(b, -0.1, {0}), std::runtime_error);
+    }
+
+    TEST(xsort, quantile_nan)
+    {
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        xarray<double> a = {{1., nan, 3.}, {4., 5., 6.}};
+        xarray<double> m = median(a, {1});
+        EXPECT_TRUE(std::isnan(m(0)));
+        EXPECT_EQ(5., m(1));
+        EXPECT_TRUE(std::isnan(quantile(a, 0.2)));
+        xarray<double> empty = xarray<double>::from_shape({0, 3});
+        xarray<double> e = median(empty, {0});
+        EXPECT_EQ(3u, e.size());
+        EXPECT_TRUE(std::isnan(e(1)));
+        EXPECT_TRUE(std::isnan(median(empty)));
+    }
+
+#ifdef XTENSOR_USE_THREADS
+    TEST(xsort, parallel)
+    {
+        xtensor<double, 2> a = xtensor<double, 2>::from_shape({500, 700});
+        std::mt19937 engine(0);
+        std::uniform_real_distribution<double> dist;
+        std::generate(a.begin(), a.end(), [&]() { return dist(engine); });
+        auto serial = sort(a, 0);
+        auto serial_indices = argsort(a);
+        auto serial_partition = partition(a, 300, 0);
+        xarray<double> serial_median = median(a, {0});
+        xarray<double> serial_quantile = quantile(a, 0.3, {1});
+        xthread_pool pool(4);
+        set_executor(&pool);
+        auto parallel = sort(a, 0);
+        auto parallel_indices = argsort(a);
+        auto parallel_partition = partition(a, 300, 0);
+        xarray<double> parallel_median = median(a, {0});
+        xarray<double> parallel_quantile = quantile(a, 0.3, {1});
+        set_executor(nullptr);
+        EXPECT_EQ(serial, parallel);
+        EXPECT_EQ(serial_indices, parallel_indices);
+        EXPECT_EQ(serial_partition, parallel_partition);
+        EXPECT_EQ(serial_median, parallel_median);
+        EXPECT_EQ(serial_quantile, parallel_quantile);
+    }
+#endif
+}